@@ -0,0 +1,236 @@
+#include <sys/time.h>
+#include <sys/file.h>
+
+#include <format.h>
+#include <string.h>
+#include <util.h>
+#include <main.h>
+
+#include "bench.h"
+
+ERRTAG("bench");
+
+/* Each case is repeated with the count doubling until a single run
+   takes at least MINTIME. Results from the last run get reported.
+   The first run doubles as the warm-up. */
+
+#define MINTIME 200*1000*1000 /* ns */
+
+/* Cases marked manual are skipped unless named on the command line,
+   these are the ones that take long or leave lots of files around. */
+
+static const struct bench {
+	char name[16];
+	void (*call)(CTX);
+	int manual;
+} benchmarks[] = {
+	{ "memcpy",      bench_memcpy      },
+	{ "strlen",      bench_strlen      },
+	{ "qsortx",      bench_qsortx      },
+	{ "bufout",      bench_bufout      },
+	{ "sha256",      bench_sha256      },
+	{ "hmac_sha1",   bench_hmac_sha1   },
+	{ "pbkdf2_sha1", bench_pbkdf2_sha1 },
+	{ "scrypt",      bench_scrypt      },
+	{ "lzma",        bench_lzma        },
+	{ "hexline",     bench_hexline     },
+	{ "textrun",     bench_textrun     },
+	{ "filecopy",    bench_filecopy, 1 }
+};
+
+static int64_t now(void)
+{
+	struct timespec ts;
+	int ret;
+
+	if((ret = sys_clock_gettime(CLOCK_MONOTONIC, &ts)) < 0)
+		fail("clock_gettime", NULL, ret);
+
+	return ts.sec*1000000000LL + ts.nsec;
+}
+
+static int64_t timed(CTX, bfunc op, long count)
+{
+	int64_t t0 = now();
+
+	for(long i = 0; i < count; i++)
+		op(ctx);
+
+	return now() - t0;
+}
+
+static void report_human(char* name, char* var, long size, long ops, int64_t ns)
+{
+	FMTBUF(p, e, buf, 200);
+	char* q;
+
+	q = fmtstr(p, e, name);
+	p = fmtpadr(p, e, 12, q);
+	p = fmtstr(p, e, " ");
+	q = fmtstr(p, e, var);
+	p = fmtpadr(p, e, 16, q);
+
+	q = fmti64(p, e, ns/ops);
+	p = fmtpad(p, e, 12, q);
+	p = fmtstr(p, e, " ns/op");
+
+	if(size > 0 && ns > 0) {
+		q = fmti64(p, e, (int64_t)size*ops*1000/ns);
+		p = fmtpad(p, e, 10, q);
+		p = fmtstr(p, e, " MB/s");
+	}
+
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+}
+
+static void report_machine(char* name, char* var, long size, long ops, int64_t ns)
+{
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtstr(p, e, name);
+	p = fmtstr(p, e, "\t");
+	p = fmtstr(p, e, var);
+	p = fmtstr(p, e, "\t");
+	p = fmtlong(p, e, size);
+	p = fmtstr(p, e, "\t");
+	p = fmtlong(p, e, ops);
+	p = fmtstr(p, e, "\t");
+	p = fmti64(p, e, ns);
+
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+}
+
+void run(CTX, char* name, char* var, long size, bfunc op)
+{
+	long count = 1;
+	int64_t ns;
+
+	ctx->size = size;
+
+	while((ns = timed(ctx, op, count)) < MINTIME)
+		count *= 2;
+
+	if(ctx->opts & OPT_m)
+		report_machine(name, var, size, count, ns);
+	else
+		report_human(name, var, size, count, ns);
+}
+
+void skip(CTX, char* name, char* why)
+{
+	if(ctx->opts & OPT_m)
+		return;
+
+	FMTBUF(p, e, buf, 200);
+	char* q;
+
+	q = fmtstr(p, e, name);
+	p = fmtpadr(p, e, 12, q);
+	p = fmtstr(p, e, " skipped: ");
+	p = fmtstr(p, e, why);
+
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+}
+
+/* Case labels for data sizes, exact unlike fmtsize. */
+
+void varsize(char* buf, int len, long size)
+{
+	FMTUSE(p, e, buf, len);
+
+	if(size >= 1024*1024 && !(size % (1024*1024))) {
+		p = fmtlong(p, e, size / (1024*1024));
+		p = fmtstr(p, e, "M");
+	} else if(size >= 1024 && !(size % 1024)) {
+		p = fmtlong(p, e, size / 1024);
+		p = fmtstr(p, e, "K");
+	} else {
+		p = fmtlong(p, e, size);
+	}
+
+	FMTEND(p, e);
+}
+
+/* Per-case data lives in the heap, which gets reset back after
+   each benchmark function. */
+
+void* alloc(CTX, long size)
+{
+	return halloc(&ctx->heap, (size + 15) & ~15);
+}
+
+void* alloc_random(CTX, long size)
+{
+	byte* buf = alloc(ctx, size);
+	uint32_t x = 0x12345678;
+
+	for(long i = 0; i < size; i++) {
+		x = x*1103515245 + 12345;
+		buf[i] = x >> 16;
+	}
+
+	return buf;
+}
+
+void release(CTX)
+{
+	ctx->heap.ptr = ctx->heap.brk;
+}
+
+static const struct bench* find_bench(char* name)
+{
+	const struct bench* bp;
+
+	for(bp = benchmarks; bp < ARRAY_END(benchmarks); bp++)
+		if(!strncmp(bp->name, name, sizeof(bp->name)))
+			return bp;
+
+	return NULL;
+}
+
+static void run_bench(CTX, const struct bench* bp)
+{
+	bp->call(ctx);
+
+	release(ctx);
+}
+
+int main(int argc, char** argv)
+{
+	struct top context, *ctx = &context;
+	const struct bench* bp;
+	int i = 1, n, any = 0;
+
+	memzero(ctx, sizeof(*ctx));
+
+	if(i < argc && argv[i][0] == '-')
+		ctx->opts = argbits(OPTS, argv[i++] + 1);
+
+	char* files[argc];
+
+	ctx->files = files;
+
+	for(n = i; n < argc; n++)
+		if(find_bench(argv[n]))
+			any = 1;
+		else
+			files[ctx->nfiles++] = argv[n];
+
+	hinit(&ctx->heap, PAGE);
+
+	for(bp = benchmarks; bp < ARRAY_END(benchmarks); bp++) {
+		if(!any && !bp->manual)
+			run_bench(ctx, bp);
+		else for(n = i; n < argc; n++)
+			if(find_bench(argv[n]) == bp)
+				run_bench(ctx, bp);
+	}
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+#include <bits/types.h>
+#include <heap.h>
+
+#define OPTS "m"
+#define OPT_m (1<<0)
+
+struct top {
+	int opts;
+
+	char** files;   /* lzip inputs for the lzma case */
+	int nfiles;
+
+	struct heap heap;
+
+	void* src;      /* working data for the current case */
+	void* dst;
+	long size;
+	long count;
+	void* data;
+};
+
+#define CTX struct top* ctx
+
+typedef void (*bfunc)(CTX);
+
+void run(CTX, char* name, char* var, long size, bfunc op);
+void skip(CTX, char* name, char* why);
+
+void varsize(char* buf, int len, long size);
+
+void* alloc(CTX, long size);
+void* alloc_random(CTX, long size);
+void release(CTX);
+
+void bench_memcpy(CTX);
+void bench_strlen(CTX);
+void bench_qsortx(CTX);
+void bench_bufout(CTX);
+void bench_sha256(CTX);
+void bench_hmac_sha1(CTX);
+void bench_pbkdf2_sha1(CTX);
+void bench_scrypt(CTX);
+void bench_lzma(CTX);
+void bench_hexline(CTX);
+void bench_textrun(CTX);
+void bench_filecopy(CTX);
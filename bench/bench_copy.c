@@ -0,0 +1,296 @@
+#include <sys/file.h>
+#include <sys/fpath.h>
+#include <sys/mman.h>
+#include <sys/splice.h>
+
+#include <format.h>
+#include <string.h>
+#include <uring.h>
+#include <util.h>
+
+#include "bench.h"
+
+/* Copying a flat directory of many small files, the way copy does it
+   without options (open, fstat, open, sendfile, close, close per file)
+   against the sequence copy -a uses. That one still opens and stats
+   synchronously, but the data moves as a linked read+write pair through
+   the ring, and both fds get closed through the ring once the pair is
+   done. Up to NCHUNKS files are in flight at once, and each new file
+   submits whatever has been queued without waiting, like ring_file()
+   does. The reported time is for the whole tree, the throughput is in
+   terms of file data.
+
+   The files get created in ./bench.tmp, so this case writes a lot to
+   the current directory and only runs when asked for explicitly. */
+
+#define NFILES 100000
+#define FSIZE 4096
+#define NCHUNKS 32
+#define RINGSIZE 256
+
+struct chunk {
+	int sfd;
+	int dfd;
+	int left;
+};
+
+struct fcbench {
+	int sdir;
+	int ddir;
+	char* buf;
+
+	struct uring ur;
+	int inflight;
+
+	int nfree;
+	int free[NCHUNKS];
+	struct chunk chunks[NCHUNKS];
+};
+
+static char* srcdir = "bench.tmp/src";
+static char* dstdir = "bench.tmp/dst";
+
+static void name(char* buf, int len, int i)
+{
+	FMTUSE(p, e, buf, len);
+
+	p = fmtstr(p, e, "f");
+	p = fmtint(p, e, i);
+
+	FMTEND(p, e);
+}
+
+static void open_pair(struct fcbench* fb, char* fn, int* sfd, int* dfd)
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	struct stat st;
+	int ret;
+
+	if((*sfd = sys_openat(fb->sdir, fn, O_RDONLY)) < 0)
+		fail(NULL, fn, *sfd);
+	if((ret = sys_fstat(*sfd, &st)) < 0)
+		fail("stat", fn, ret);
+	if((*dfd = sys_openat4(fb->ddir, fn, flags, 0644)) < 0)
+		fail(NULL, fn, *dfd);
+}
+
+static void op_sendfile(CTX)
+{
+	struct fcbench* fb = ctx->data;
+	int i, sfd, dfd;
+	long ret;
+	char fn[20];
+
+	for(i = 0; i < NFILES; i++) {
+		name(fn, sizeof(fn), i);
+		open_pair(fb, fn, &sfd, &dfd);
+
+		if((ret = sys_sendfile(dfd, sfd, NULL, FSIZE)) < 0)
+			fail("sendfile", fn, ret);
+
+		sys_close(sfd);
+		sys_close(dfd);
+	}
+}
+
+/* Tags are 0 for close, chunk index + 1 shifted left for the read,
+   with the low bit set for the write. */
+
+static struct io_uring_sqe* get_sqe(struct fcbench* fb)
+{
+	struct io_uring_sqe* sqe;
+	int ret;
+
+	while(!(sqe = uring_sqe(&fb->ur)))
+		if((ret = uring_enter(&fb->ur, 0)) < 0)
+			fail("io_uring_enter", NULL, ret);
+
+	fb->inflight++;
+
+	return sqe;
+}
+
+static void queue_close(struct fcbench* fb, int fd)
+{
+	struct io_uring_sqe* sqe = get_sqe(fb);
+
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	sqe->user_data = 0;
+}
+
+static void complete(struct fcbench* fb, struct io_uring_cqe* cqe)
+{
+	uint64_t tag = cqe->user_data;
+	struct chunk* ck;
+	int i;
+
+	fb->inflight--;
+
+	if(!tag)
+		return;
+	if(cqe->res != FSIZE)
+		fail((tag & 1) ? "write" : "read", NULL, cqe->res);
+
+	i = (tag >> 1) - 1;
+	ck = &fb->chunks[i];
+
+	if(--ck->left)
+		return;
+
+	queue_close(fb, ck->sfd);
+	queue_close(fb, ck->dfd);
+
+	fb->free[fb->nfree++] = i;
+}
+
+static void reap(struct fcbench* fb, int wait)
+{
+	struct io_uring_cqe* cqe;
+	int ret;
+
+	if((ret = uring_enter(&fb->ur, wait)) < 0)
+		fail("io_uring_enter", NULL, ret);
+
+	while((cqe = uring_cqe(&fb->ur))) {
+		complete(fb, cqe);
+		uring_seen(&fb->ur);
+	}
+}
+
+static void issue(struct fcbench* fb, int i)
+{
+	struct chunk* ck = &fb->chunks[i];
+	char* buf = fb->buf + i*FSIZE;
+	uint64_t tag = (i + 1) << 1;
+	struct io_uring_sqe* sqe;
+
+	ck->left = 2;
+
+	sqe = get_sqe(fb);
+	sqe->opcode = IORING_OP_READ;
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->fd = ck->sfd;
+	sqe->addr = (long)buf;
+	sqe->len = FSIZE;
+	sqe->off = 0;
+	sqe->user_data = tag;
+
+	sqe = get_sqe(fb);
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = ck->dfd;
+	sqe->addr = (long)buf;
+	sqe->len = FSIZE;
+	sqe->off = 0;
+	sqe->user_data = tag | 1;
+}
+
+static void op_uring(CTX)
+{
+	struct fcbench* fb = ctx->data;
+	char fn[20];
+	int i, k;
+
+	fb->nfree = NCHUNKS;
+
+	for(i = 0; i < NCHUNKS; i++)
+		fb->free[i] = i;
+
+	for(i = 0; i < NFILES; i++) {
+		name(fn, sizeof(fn), i);
+
+		while(!fb->nfree)
+			reap(fb, 1);
+
+		k = fb->free[--fb->nfree];
+
+		open_pair(fb, fn, &fb->chunks[k].sfd, &fb->chunks[k].dfd);
+		issue(fb, k);
+		reap(fb, 0);
+	}
+
+	while(fb->inflight)
+		reap(fb, 1);
+}
+
+static int opendir(char* path)
+{
+	int fd, ret;
+
+	if((ret = sys_mkdir(path, 0755)) < 0 && ret != -EEXIST)
+		fail("mkdir", path, ret);
+	if((fd = sys_open(path, O_DIRECTORY)) < 0)
+		fail(NULL, path, fd);
+
+	return fd;
+}
+
+static void make_files(struct fcbench* fb, char* data)
+{
+	char fn[20];
+	int i, fd;
+	long ret;
+
+	for(i = 0; i < NFILES; i++) {
+		name(fn, sizeof(fn), i);
+
+		if((fd = sys_openat4(fb->sdir, fn, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+			fail(NULL, fn, fd);
+		if((ret = writeall(fd, data, FSIZE)) < 0)
+			fail("write", fn, ret);
+
+		sys_close(fd);
+	}
+}
+
+static void remove_all(struct fcbench* fb)
+{
+	char fn[20];
+	int i;
+
+	for(i = 0; i < NFILES; i++) {
+		name(fn, sizeof(fn), i);
+		sys_unlinkat(fb->sdir, fn, 0);
+		sys_unlinkat(fb->ddir, fn, 0);
+	}
+
+	sys_close(fb->sdir);
+	sys_close(fb->ddir);
+
+	sys_rmdir(srcdir);
+	sys_rmdir(dstdir);
+	sys_rmdir("bench.tmp");
+}
+
+void bench_filecopy(CTX)
+{
+	struct fcbench* fb = alloc(ctx, sizeof(*fb));
+	char var[20];
+	int ret;
+
+	sys_mkdir("bench.tmp", 0755);
+
+	fb->sdir = opendir(srcdir);
+	fb->ddir = opendir(dstdir);
+	fb->buf = alloc(ctx, NCHUNKS*FSIZE);
+
+	make_files(fb, alloc_random(ctx, FSIZE));
+
+	ctx->data = fb;
+
+	FMTUSE(p, e, var, sizeof(var));
+	p = fmtint(p, e, NFILES/1000);
+	p = fmtstr(p, e, "k x 4K");
+	FMTEND(p, e);
+
+	run(ctx, "sendfile", var, NFILES*FSIZE, op_sendfile);
+
+	if((ret = uring_init(&fb->ur, RINGSIZE)) < 0)
+		skip(ctx, "io_uring", "not supported");
+	else
+		run(ctx, "io_uring", var, NFILES*FSIZE, op_uring);
+
+	uring_fini(&fb->ur);
+
+	remove_all(fb);
+}
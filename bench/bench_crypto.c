@@ -0,0 +1,166 @@
+#include <crypto/sha1.h>
+#include <crypto/sha256.h>
+#include <crypto/pbkdf2.h>
+#include <crypto/scrypt.h>
+#include <crypto/shahw.h>
+#include <format.h>
+#include <string.h>
+#include <util.h>
+
+#include "bench.h"
+
+/* sha256_proc is the part that matters, init and fini are trivial.
+   Both the hardware and the plain C block functions get measured
+   where the CPU has SHA extensions. */
+
+static void op_sha256(CTX)
+{
+	struct sha256* sh = ctx->data;
+	char* ptr = ctx->src;
+	char* end = ptr + ctx->size;
+
+	sha256_init(sh);
+
+	for(; ptr < end; ptr += 64)
+		sha256_proc(sh, ptr);
+}
+
+void bench_sha256(CTX)
+{
+	static const long sizes[] = { 64, 1024, 65536 };
+	char var[20];
+
+	ctx->data = alloc(ctx, sizeof(struct sha256));
+	ctx->src = alloc_random(ctx, sizes[ARRAY_SIZE(sizes)-1]);
+
+	if(sha_hwcaps() & SHA_HW_SHA256)
+		for(uint i = 0; i < ARRAY_SIZE(sizes); i++) {
+			varsize(var, sizeof(var), sizes[i]);
+			run(ctx, "sha256_proc/hw", var, sizes[i], op_sha256);
+		}
+
+	sha_hwmask(0);
+
+	for(uint i = 0; i < ARRAY_SIZE(sizes); i++) {
+		varsize(var, sizeof(var), sizes[i]);
+		run(ctx, "sha256_proc", var, sizes[i], op_sha256);
+	}
+
+	sha_hwmask(~0);
+}
+
+/* EAPOL frames are the typical input for the HMACs. */
+
+static void op_hmac_sha1(CTX)
+{
+	uint8_t out[20];
+
+	hmac_sha1(out, ctx->dst, 32, ctx->src, ctx->size);
+}
+
+void bench_hmac_sha1(CTX)
+{
+	static const long sizes[] = { 64, 256, 1500 };
+	char var[20];
+
+	ctx->dst = alloc_random(ctx, 32);
+	ctx->src = alloc_random(ctx, sizes[ARRAY_SIZE(sizes)-1]);
+
+	for(uint i = 0; i < ARRAY_SIZE(sizes); i++) {
+		varsize(var, sizeof(var), sizes[i]);
+		run(ctx, "hmac_sha1", var, sizes[i], op_hmac_sha1);
+	}
+}
+
+/* WPA2 PSK derivation, exactly as done in wsupp. */
+
+static void op_pbkdf2_sha1(CTX)
+{
+	char* pass = "passphrase";
+	char* ssid = "some-network";
+	uint8_t psk[32];
+
+	pbkdf2_sha1(psk, sizeof(psk), pass, strlen(pass),
+	            ssid, strlen(ssid), ctx->count);
+}
+
+void bench_pbkdf2_sha1(CTX)
+{
+	ctx->count = 4096;
+
+	if(sha_hwcaps() & SHA_HW_SHA1)
+		run(ctx, "pbkdf2_sha1/hw", "4096", 0, op_pbkdf2_sha1);
+
+	sha_hwmask(0);
+	run(ctx, "pbkdf2_sha1", "4096", 0, op_pbkdf2_sha1);
+	sha_hwmask(~0);
+}
+
+/* The last set of parameters is what dektool and passblk use.
+   For p > 1, the lanes also get run with one thread per lane. */
+
+static const struct scparam {
+	uint n;
+	uint r;
+	uint p;
+} scparams[] = {
+	{ 1024,    8, 1 },
+	{ 1024,    8, 4 },
+	{ 16384,   8, 1 },
+	{ 16384,   8, 4 },
+	{ 1 << 15, 8, 1 }
+};
+
+static void op_scrypt(CTX)
+{
+	struct scrypt* sc = ctx->data;
+	uint8_t dk[32];
+
+	scrypt_hash(sc, dk, sizeof(dk));
+}
+
+static void fmt_param(char* buf, int len, const struct scparam* sp)
+{
+	FMTUSE(p, e, buf, len);
+
+	p = fmtstr(p, e, "N=");
+	p = fmtuint(p, e, sp->n);
+	p = fmtstr(p, e, ",r=");
+	p = fmtuint(p, e, sp->r);
+	p = fmtstr(p, e, ",p=");
+	p = fmtuint(p, e, sp->p);
+
+	FMTEND(p, e);
+}
+
+void bench_scrypt(CTX)
+{
+	const struct scparam* sp;
+	struct scrypt* sc = alloc(ctx, sizeof(*sc));
+	char var[30];
+	void* brk = ctx->heap.ptr;
+
+	ctx->data = sc;
+
+	for(sp = scparams; sp < ARRAY_END(scparams); sp++) {
+		ulong size = scrypt_init(sc, sp->n, sp->r, sp->p);
+
+		ctx->heap.ptr = brk;
+
+		scrypt_temp(sc, alloc(ctx, size), size);
+		scrypt_data(sc, "password", 8, "NaCl", 4);
+
+		fmt_param(var, sizeof(var), sp);
+		run(ctx, "scrypt", var, 0, op_scrypt);
+
+		if(sp->p < 2)
+			continue;
+
+		size = scrypt_threads(sc, sp->p);
+
+		ctx->heap.ptr = brk;
+
+		scrypt_temp(sc, alloc(ctx, size), size);
+		run(ctx, "scrypt/mt", var, 0, op_scrypt);
+	}
+}
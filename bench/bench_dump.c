@@ -0,0 +1,81 @@
+#include <string.h>
+#include <format.h>
+#include <util.h>
+
+#include "bench.h"
+
+/* The inner loops of hexdump and strings, without the I/O. Throughput
+   is in terms of input bytes. The mixed data for textrun is meant to
+   look a bit like a binary: zero padding, random code-like bytes, and
+   every now and then a run of text. */
+
+#define SIZE (1024*1024)
+#define MINRUN 6
+
+static void op_hexline(CTX)
+{
+	char* src = ctx->src;
+	char* p = ctx->dst;
+	char* e = p + ctx->count;
+
+	for(long off = 0; off < ctx->size; off += 16)
+		p = fmthexline(p, e, off, src + off, 16);
+}
+
+static long count_runs(char* p, long size)
+{
+	char* e = p + size;
+	long runs = 0;
+
+	while((p = textfind(p, e, MINRUN)) < e) {
+		p = textend(p, e) + 1;
+		runs++;
+	}
+
+	return runs;
+}
+
+static void op_textrun(CTX)
+{
+	if(count_runs(ctx->src, ctx->size) != ctx->count)
+		fail("textrun mismatch", NULL, 0);
+}
+
+static char* make_mixed(CTX, long size)
+{
+	char* buf = alloc_random(ctx, size);
+	static const char text[] = "Lorem ipsum dolor sit amet, consectetur";
+
+	for(long off = 0; off + 64 <= size; off += 64) {
+		uint8_t r = buf[off];
+
+		if(r < 0x40)
+			memzero(buf + off, 64);
+		else if(r < 0x50)
+			memcpy(buf + off + 8, text, r & 0x1F);
+	}
+
+	return buf;
+}
+
+void bench_hexline(CTX)
+{
+	ctx->src = alloc_random(ctx, SIZE);
+	ctx->count = 5*SIZE;
+	ctx->dst = alloc(ctx, ctx->count);
+
+	run(ctx, "hexline", "1M", SIZE, op_hexline);
+}
+
+void bench_textrun(CTX)
+{
+	ctx->src = alloc_random(ctx, SIZE);
+	ctx->count = count_runs(ctx->src, SIZE);
+
+	run(ctx, "textrun", "random", SIZE, op_textrun);
+
+	ctx->src = make_mixed(ctx, SIZE);
+	ctx->count = count_runs(ctx->src, SIZE);
+
+	run(ctx, "textrun", "mixed", SIZE, op_textrun);
+}
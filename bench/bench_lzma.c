@@ -0,0 +1,111 @@
+#include <sys/file.h>
+#include <sys/mman.h>
+
+#include <string.h>
+#include <util.h>
+#include <lzma.h>
+
+#include "bench.h"
+
+/* Whole-file in-memory decoding, same way modprobe does it for .ko.lz
+   modules. See map_lunzip in src/kmod/common_zip.c. The reported
+   throughput is in terms of decompressed data. */
+
+struct lzbench {
+	byte* raw;
+	long rawlen;
+	byte* out;
+	long outlen;
+	byte state[LZMA_SIZE];
+};
+
+static uint64_t get_long_at(byte* at)
+{
+	uint64_t ret = 0;
+
+	for(int i = 7; i >= 0; i--)
+		ret = (ret << 8) | at[i];
+
+	return ret;
+}
+
+static void op_lzma(CTX)
+{
+	struct lzbench* lb = ctx->data;
+	struct lzma* lz;
+	int ret;
+
+	if(!(lz = lzma_create(lb->state, sizeof(lb->state))))
+		fail("LZMA buffer error", NULL, 0);
+
+	lz->srcbuf = lb->raw;
+	lz->srcptr = lb->raw + 7;
+	lz->srchwm = lb->raw + lb->rawlen - 20;
+	lz->srcend = lb->raw + lb->rawlen - 20;
+
+	lz->dstbuf = lb->out;
+	lz->dstptr = lb->out;
+	lz->dsthwm = lb->out + lb->outlen;
+	lz->dstend = lb->out + lb->outlen;
+
+	if((ret = lzma_inflate(lz)) != LZMA_STREAM_END)
+		fail("lzma_inflate", NULL, ret);
+}
+
+static int map_input(CTX, struct lzbench* lb, char* name)
+{
+	struct stat st;
+	int fd, ret;
+
+	if((fd = sys_open(name, O_RDONLY)) < 0)
+		fail(NULL, name, fd);
+	if((ret = sys_fstat(fd, &st)) < 0)
+		fail("stat", name, ret);
+	if(st.size < 6 + 20)
+		fail("file too short:", name, 0);
+
+	void* buf = sys_mmap(NULL, st.size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", name, ret);
+
+	sys_close(fd);
+
+	lb->raw = buf;
+	lb->rawlen = st.size;
+
+	if(memcmp(buf, "LZIP\x01", 5))
+		fail("not a lzip file:", name, 0);
+	if(get_long_at(lb->raw + st.size - 8) != (uint64_t)st.size)
+		fail("multi-member lzip files not supported:", name, 0);
+
+	lb->outlen = get_long_at(lb->raw + st.size - 16);
+	lb->out = alloc(ctx, lb->outlen);
+
+	return 0;
+}
+
+void bench_lzma(CTX)
+{
+	struct lzbench* lb = alloc(ctx, sizeof(*lb));
+	void* brk = ctx->heap.ptr;
+
+	if(!ctx->nfiles) {
+		skip(ctx, "lzma", "no .lz files given");
+		return;
+	}
+
+	ctx->data = lb;
+
+	for(int i = 0; i < ctx->nfiles; i++) {
+		char* name = ctx->files[i];
+
+		ctx->heap.ptr = brk;
+
+		map_input(ctx, lb, name);
+
+		run(ctx, "lzma_inflate", basename(name), lb->outlen, op_lzma);
+
+		sys_munmap(lb->raw, lb->rawlen);
+	}
+}
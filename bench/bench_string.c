@@ -0,0 +1,50 @@
+#include <string.h>
+#include <util.h>
+
+#include "bench.h"
+
+static const long sizes[] = { 16, 256, 4096, 65536, 1024*1024 };
+
+static void op_memcpy(CTX)
+{
+	memcpy(ctx->dst, ctx->src, ctx->size);
+}
+
+static void op_strlen(CTX)
+{
+	if(strlen(ctx->src) != (size_t)ctx->size)
+		fail("strlen mismatch", NULL, 0);
+}
+
+void bench_memcpy(CTX)
+{
+	char var[20];
+
+	ctx->src = alloc_random(ctx, sizes[ARRAY_SIZE(sizes)-1]);
+	ctx->dst = alloc(ctx, sizes[ARRAY_SIZE(sizes)-1]);
+
+	for(uint i = 0; i < ARRAY_SIZE(sizes); i++) {
+		varsize(var, sizeof(var), sizes[i]);
+		run(ctx, "memcpy", var, sizes[i], op_memcpy);
+	}
+}
+
+void bench_strlen(CTX)
+{
+	long max = sizes[ARRAY_SIZE(sizes)-1];
+	char* str = alloc(ctx, max + 1);
+	char var[20];
+
+	memset(str, 'x', max);
+
+	ctx->src = str;
+
+	for(uint i = 0; i < ARRAY_SIZE(sizes); i++) {
+		long size = sizes[i];
+
+		str[size] = '\0';
+		varsize(var, sizeof(var), size);
+		run(ctx, "strlen", var, size, op_strlen);
+		str[size] = 'x';
+	}
+}
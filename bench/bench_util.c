@@ -0,0 +1,126 @@
+#include <sys/file.h>
+
+#include <format.h>
+#include <output.h>
+#include <string.h>
+#include <util.h>
+
+#include "bench.h"
+
+/* qsortx is mostly used on directory listings, so the data here
+   is a bunch of random file names compared with strcmp. The same
+   names are also run through qsorts, which knows the keys and sorts
+   them by radix. */
+
+static const long counts[] = { 100, 1000, 10000, 100000 };
+
+static int cmp_names(void* a, void* b, long opts __unused)
+{
+	return strcmp(a, b);
+}
+
+static void op_qsortx(CTX)
+{
+	memcpy(ctx->dst, ctx->src, ctx->count*sizeof(void*));
+
+	qsortx(ctx->dst, ctx->count, cmp_names, 0);
+}
+
+static void op_qsorts(CTX)
+{
+	memcpy(ctx->dst, ctx->src, ctx->count*sizeof(void*));
+
+	qsorts(ctx->dst, ctx->count, 0);
+}
+
+static char** make_names(CTX, long n)
+{
+	char** idx = alloc(ctx, n*sizeof(char*));
+	byte* rnd = alloc_random(ctx, n*20);
+	char* names = alloc(ctx, n*20);
+
+	for(long i = 0; i < n; i++) {
+		byte* r = rnd + 20*i;
+		char* s = names + 20*i;
+		int len = 4 + r[0] % 15;
+
+		for(int k = 0; k < len; k++)
+			s[k] = 'a' + r[k+1] % 26;
+
+		s[len] = '\0';
+		idx[i] = s;
+	}
+
+	return idx;
+}
+
+void bench_qsortx(CTX)
+{
+	long max = counts[ARRAY_SIZE(counts)-1];
+	char var[20];
+
+	ctx->src = make_names(ctx, max);
+	ctx->dst = alloc(ctx, max*sizeof(void*));
+
+	for(uint i = 0; i < ARRAY_SIZE(counts); i++) {
+		FMTUSE(p, e, var, sizeof(var));
+		p = fmtlong(p, e, counts[i]);
+		FMTEND(p, e);
+
+		ctx->count = counts[i];
+		run(ctx, "qsortx", var, 0, op_qsortx);
+		run(ctx, "qsorts", var, 0, op_qsorts);
+	}
+}
+
+/* bufout is benchmarked with /dev/null as the sink, so it's mostly
+   the cost of the copying and the write calls. Each op writes TOTAL
+   bytes in chunks of the given size. */
+
+#define TOTAL 65536
+
+static const long chunks[] = { 1, 16, 100, 4096 };
+
+static void op_bufout(CTX)
+{
+	struct bufout* bo = ctx->data;
+	char* src = ctx->src;
+	long chunk = ctx->count;
+
+	for(long off = 0; off < TOTAL; off += chunk) {
+		long n = TOTAL - off < chunk ? TOTAL - off : chunk;
+		bufout(bo, src + off, n);
+	}
+
+	bufoutflush(bo);
+}
+
+void bench_bufout(CTX)
+{
+	struct bufout* bo = alloc(ctx, sizeof(*bo));
+	char* null = "/dev/null";
+	int fd, len = 4096;
+	char var[20];
+
+	if((fd = sys_open(null, O_WRONLY)) < 0) {
+		skip(ctx, "bufout", "cannot open /dev/null");
+		return;
+	}
+
+	bufoutset(bo, fd, alloc(ctx, len), len);
+
+	ctx->data = bo;
+	ctx->src = alloc_random(ctx, TOTAL);
+
+	for(uint i = 0; i < ARRAY_SIZE(chunks); i++) {
+		FMTUSE(p, e, var, sizeof(var));
+		p = fmtstr(p, e, "by ");
+		p = fmtlong(p, e, chunks[i]);
+		FMTEND(p, e);
+
+		ctx->count = chunks[i];
+		run(ctx, "bufout", var, TOTAL, op_bufout);
+	}
+
+	sys_close(fd);
+}
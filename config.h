@@ -0,0 +1,6 @@
+#define BASE_ETC "/root/repo/etc"
+#define BASE_VAR "/root/repo/var"
+#define INIT_ETC "/root/repo/etc"
+#define RUN_CTRL "/root/repo/var/run"
+
+#define HERE "/root/repo"
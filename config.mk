@@ -0,0 +1,18 @@
+ARCH = x86_64
+
+CC = $/mini-cc
+AR = ar
+LD = $(CC)
+AS = $(CC)
+STRIP = strip
+QEMU = 
+
+.SUFFIXES:
+
+%.o: %.c
+	$(CC) -c $<
+
+%.o: %.s
+	$(CC) -c $<
+
+MAKEFLAGS = -R
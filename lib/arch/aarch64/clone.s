@@ -0,0 +1,31 @@
+.equ NR_clone, 220
+.equ NR_exit, 93
+
+/* long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                     int (*fn)(void*), void* arg)
+
+   See x86_64/clone.s. Note the kernel takes tls before ctid here. */
+
+.text
+.align 4
+.globl thread_clone
+
+thread_clone:
+	and     x1, x1, -16
+	stp     x4, x5, [x1, -16]!      /* fn, arg */
+	mov     x4, x3                  /* ctid */
+	mov     x3, xzr                 /* tls */
+	mov     x8, NR_clone
+	svc     0
+	cbz     x0, 1f
+	ret
+1:
+	mov     x29, xzr
+	mov     x30, xzr
+	ldp     x1, x0, [sp], 16
+	blr     x1
+	mov     x8, NR_exit
+	svc     0
+
+.size thread_clone,.-thread_clone
+.type thread_clone,function
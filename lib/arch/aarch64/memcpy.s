@@ -0,0 +1,56 @@
+/* NEON memcpy. Blocks of 16 bytes go through q registers, the last block
+   is loaded upfront and stored at the very end, possibly overlapping
+   the one before it.
+
+   Copying goes strictly forward; memmove() relies on that. */
+
+.text
+.globl memcpy
+
+memcpy:
+	mov     x3, x0
+	cmp     x2, #16
+	b.lo    3f
+
+	add     x4, x1, x2
+	add     x5, x0, x2
+	ldr     q1, [x4, #-16]
+1:
+	ldr     q0, [x1], #16
+	str     q0, [x3], #16
+	sub     x2, x2, #16
+	cmp     x2, #16
+	b.hs    1b
+
+	str     q1, [x5, #-16]
+	ret
+3:
+	add     x4, x1, x2
+	add     x5, x0, x2
+	cmp     x2, #8
+	b.lo    4f
+	ldr     x6, [x1]
+	ldr     x7, [x4, #-8]
+	str     x6, [x0]
+	str     x7, [x5, #-8]
+	ret
+4:
+	cmp     x2, #4
+	b.lo    5f
+	ldr     w6, [x1]
+	ldr     w7, [x4, #-4]
+	str     w6, [x0]
+	str     w7, [x5, #-4]
+	ret
+5:
+	cbz     x2, 7f
+6:
+	ldrb    w6, [x1], #1
+	strb    w6, [x3], #1
+	subs    x2, x2, #1
+	b.ne    6b
+7:
+	ret
+
+.type memcpy,function
+.size memcpy,.-memcpy
@@ -0,0 +1,45 @@
+/* NEON memset, same layout as memcpy: the last 16 bytes are stored first,
+   the rest goes in 16-byte stores. */
+
+.text
+.globl memset
+
+memset:
+	dup     v0.16b, w1
+	mov     x3, x0
+	cmp     x2, #16
+	b.lo    3f
+
+	add     x4, x0, x2
+	str     q0, [x4, #-16]
+1:
+	str     q0, [x3], #16
+	sub     x2, x2, #16
+	cmp     x2, #16
+	b.hs    1b
+	ret
+3:
+	fmov    x5, d0
+	add     x4, x0, x2
+	cmp     x2, #8
+	b.lo    4f
+	str     x5, [x0]
+	str     x5, [x4, #-8]
+	ret
+4:
+	cmp     x2, #4
+	b.lo    5f
+	str     w5, [x0]
+	str     w5, [x4, #-4]
+	ret
+5:
+	cbz     x2, 7f
+6:
+	strb    w1, [x3], #1
+	subs    x2, x2, #1
+	b.ne    6b
+7:
+	ret
+
+.type memset,function
+.size memset,.-memset
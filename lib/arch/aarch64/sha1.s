@@ -0,0 +1,179 @@
+/* SHA-1 block function using the ARMv8 crypto extensions.
+
+   void sha1_hw_block(uint32_t H[5], char blk[64])
+
+   ABCD in v0, E in s1. Each group of four rounds takes E from the sha1h
+   of the previous group, alternating between s21 and s22. Message words
+   rotate through v4-v7, round constants are in v16-v19. */
+
+.arch armv8-a+crypto
+
+.text
+.align 4
+.globl sha1_hw_block
+
+sha1_hw_block:
+	ld1     {v0.4s}, [x0]
+	ldr     s1, [x0, 16]
+	ld1     {v4.16b, v5.16b, v6.16b, v7.16b}, [x1]
+	rev32   v4.16b, v4.16b
+	rev32   v5.16b, v5.16b
+	rev32   v6.16b, v6.16b
+	rev32   v7.16b, v7.16b
+
+	adrp    x2, K1
+	add     x2, x2, :lo12:K1
+	ld1     {v16.4s, v17.4s, v18.4s, v19.4s}, [x2]
+
+	mov     v2.16b, v0.16b
+	mov     v3.16b, v1.16b
+
+	/* rounds 0-3 */
+	add     v20.4s, v4.4s, v16.4s
+	sha1h   s21, s0
+	sha1c   q0, s1, v20.4s
+	sha1su0 v4.4s, v5.4s, v6.4s
+	sha1su1 v4.4s, v7.4s
+
+	/* rounds 4-7 */
+	add     v20.4s, v5.4s, v16.4s
+	sha1h   s22, s0
+	sha1c   q0, s21, v20.4s
+	sha1su0 v5.4s, v6.4s, v7.4s
+	sha1su1 v5.4s, v4.4s
+
+	/* rounds 8-11 */
+	add     v20.4s, v6.4s, v16.4s
+	sha1h   s21, s0
+	sha1c   q0, s22, v20.4s
+	sha1su0 v6.4s, v7.4s, v4.4s
+	sha1su1 v6.4s, v5.4s
+
+	/* rounds 12-15 */
+	add     v20.4s, v7.4s, v16.4s
+	sha1h   s22, s0
+	sha1c   q0, s21, v20.4s
+	sha1su0 v7.4s, v4.4s, v5.4s
+	sha1su1 v7.4s, v6.4s
+
+	/* rounds 16-19 */
+	add     v20.4s, v4.4s, v16.4s
+	sha1h   s21, s0
+	sha1c   q0, s22, v20.4s
+	sha1su0 v4.4s, v5.4s, v6.4s
+	sha1su1 v4.4s, v7.4s
+
+	/* rounds 20-23 */
+	add     v20.4s, v5.4s, v17.4s
+	sha1h   s22, s0
+	sha1p   q0, s21, v20.4s
+	sha1su0 v5.4s, v6.4s, v7.4s
+	sha1su1 v5.4s, v4.4s
+
+	/* rounds 24-27 */
+	add     v20.4s, v6.4s, v17.4s
+	sha1h   s21, s0
+	sha1p   q0, s22, v20.4s
+	sha1su0 v6.4s, v7.4s, v4.4s
+	sha1su1 v6.4s, v5.4s
+
+	/* rounds 28-31 */
+	add     v20.4s, v7.4s, v17.4s
+	sha1h   s22, s0
+	sha1p   q0, s21, v20.4s
+	sha1su0 v7.4s, v4.4s, v5.4s
+	sha1su1 v7.4s, v6.4s
+
+	/* rounds 32-35 */
+	add     v20.4s, v4.4s, v17.4s
+	sha1h   s21, s0
+	sha1p   q0, s22, v20.4s
+	sha1su0 v4.4s, v5.4s, v6.4s
+	sha1su1 v4.4s, v7.4s
+
+	/* rounds 36-39 */
+	add     v20.4s, v5.4s, v17.4s
+	sha1h   s22, s0
+	sha1p   q0, s21, v20.4s
+	sha1su0 v5.4s, v6.4s, v7.4s
+	sha1su1 v5.4s, v4.4s
+
+	/* rounds 40-43 */
+	add     v20.4s, v6.4s, v18.4s
+	sha1h   s21, s0
+	sha1m   q0, s22, v20.4s
+	sha1su0 v6.4s, v7.4s, v4.4s
+	sha1su1 v6.4s, v5.4s
+
+	/* rounds 44-47 */
+	add     v20.4s, v7.4s, v18.4s
+	sha1h   s22, s0
+	sha1m   q0, s21, v20.4s
+	sha1su0 v7.4s, v4.4s, v5.4s
+	sha1su1 v7.4s, v6.4s
+
+	/* rounds 48-51 */
+	add     v20.4s, v4.4s, v18.4s
+	sha1h   s21, s0
+	sha1m   q0, s22, v20.4s
+	sha1su0 v4.4s, v5.4s, v6.4s
+	sha1su1 v4.4s, v7.4s
+
+	/* rounds 52-55 */
+	add     v20.4s, v5.4s, v18.4s
+	sha1h   s22, s0
+	sha1m   q0, s21, v20.4s
+	sha1su0 v5.4s, v6.4s, v7.4s
+	sha1su1 v5.4s, v4.4s
+
+	/* rounds 56-59 */
+	add     v20.4s, v6.4s, v18.4s
+	sha1h   s21, s0
+	sha1m   q0, s22, v20.4s
+	sha1su0 v6.4s, v7.4s, v4.4s
+	sha1su1 v6.4s, v5.4s
+
+	/* rounds 60-63 */
+	add     v20.4s, v7.4s, v19.4s
+	sha1h   s22, s0
+	sha1p   q0, s21, v20.4s
+	sha1su0 v7.4s, v4.4s, v5.4s
+	sha1su1 v7.4s, v6.4s
+
+	/* rounds 64-67 */
+	add     v20.4s, v4.4s, v19.4s
+	sha1h   s21, s0
+	sha1p   q0, s22, v20.4s
+
+	/* rounds 68-71 */
+	add     v20.4s, v5.4s, v19.4s
+	sha1h   s22, s0
+	sha1p   q0, s21, v20.4s
+
+	/* rounds 72-75 */
+	add     v20.4s, v6.4s, v19.4s
+	sha1h   s21, s0
+	sha1p   q0, s22, v20.4s
+
+	/* rounds 76-79 */
+	add     v20.4s, v7.4s, v19.4s
+	sha1h   s22, s0
+	sha1p   q0, s21, v20.4s
+
+	add     v0.4s, v0.4s, v2.4s
+	add     v22.2s, v22.2s, v3.2s
+	st1     {v0.4s}, [x0]
+	str     s22, [x0, 16]
+	ret
+
+.size sha1_hw_block,.-sha1_hw_block
+.type sha1_hw_block,function
+
+.section .rodata
+.align 4
+
+K1:
+	.long   0x5a827999, 0x5a827999, 0x5a827999, 0x5a827999
+	.long   0x6ed9eba1, 0x6ed9eba1, 0x6ed9eba1, 0x6ed9eba1
+	.long   0x8f1bbcdc, 0x8f1bbcdc, 0x8f1bbcdc, 0x8f1bbcdc
+	.long   0xca62c1d6, 0xca62c1d6, 0xca62c1d6, 0xca62c1d6
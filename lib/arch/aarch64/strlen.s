@@ -0,0 +1,40 @@
+/* NEON strlen. Loads are always 16-byte aligned so they never cross
+   a page boundary. The comparison result gets narrowed into a 64-bit
+   mask with 4 bits per byte; the bytes preceding the string in the first
+   block are shifted out of it. */
+
+.text
+.globl strlen
+
+strlen:
+	bic     x1, x0, #15
+	and     x2, x0, #15
+	lsl     x2, x2, #2
+
+	ld1     {v0.16b}, [x1]
+	cmeq    v0.16b, v0.16b, #0
+	shrn    v0.8b, v0.8h, #4
+	fmov    x3, d0
+	lsr     x3, x3, x2
+	cbz     x3, 1f
+
+	rbit    x3, x3
+	clz     x3, x3
+	lsr     x0, x3, #2
+	ret
+1:
+	add     x1, x1, #16
+	ld1     {v0.16b}, [x1]
+	cmeq    v0.16b, v0.16b, #0
+	shrn    v0.8b, v0.8h, #4
+	fmov    x3, d0
+	cbz     x3, 1b
+
+	rbit    x3, x3
+	clz     x3, x3
+	add     x1, x1, x3, lsr #2
+	sub     x0, x1, x0
+	ret
+
+.type strlen,function
+.size strlen,.-strlen
@@ -361,5 +361,9 @@
 #define NR_copy_file_range            391
 #define NR_preadv2                    392
 #define NR_pwritev2                   393
+#define NR_statx                      397
+#define NR_io_uring_setup             425
+#define NR_io_uring_enter             426
+#define NR_io_uring_register          427
 
 #endif
@@ -0,0 +1,37 @@
+.equ NR_clone, 120
+.equ NR_exit, 1
+
+/* long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                     int (*fn)(void*), void* arg)
+
+   See x86_64/clone.s. The kernel takes tls before ctid, and fn/arg
+   arrive on the stack here. Note stmdb stores lower-numbered registers
+   at lower addresses, so arg (r4) ends up below fn (ip). */
+
+.text
+.align 4
+.global thread_clone
+
+thread_clone:
+	stmfd   sp!, {r4, r7}
+	ldr     ip, [sp, #8]       /* fn */
+	ldr     r4, [sp, #12]      /* arg */
+	bic     r1, r1, #7
+	stmdb   r1!, {r4, ip}
+	mov     r4, r3             /* ctid */
+	mov     r3, #0             /* tls */
+	mov     r7, #NR_clone
+	swi     #0
+	cmp     r0, #0
+	beq     1f
+	ldmfd   sp!, {r4, r7}
+	bx      lr
+1:
+	mov     fp, #0
+	ldmia   sp!, {r0, r1}      /* arg, fn */
+	blx     r1
+	mov     r7, #NR_exit
+	swi     #0
+
+.type thread_clone,function
+.size thread_clone,.-thread_clone
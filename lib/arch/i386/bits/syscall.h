@@ -381,5 +381,9 @@
 #define NR_pkey_mprotect      380
 #define NR_pkey_alloc         381
 #define NR_pkey_free          382
+#define NR_statx              383
+#define NR_io_uring_setup     425
+#define NR_io_uring_enter     426
+#define NR_io_uring_register  427
 
 #endif
@@ -0,0 +1,51 @@
+.equ NR_clone, 120
+.equ NR_exit, 1
+
+/* long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                     int (*fn)(void*), void* arg)
+
+   See x86_64/clone.s. The kernel wants flags, stack, ptid, tls, ctid
+   in %ebx, %ecx, %edx, %esi, %edi. The child frame is laid out so that
+   arg sits right at the aligned %esp when fn gets called. */
+
+.text
+.global thread_clone
+
+thread_clone:
+	pushl   %ebx
+	pushl   %esi
+	pushl   %edi
+
+	movl    20(%esp), %ecx          /* stack */
+	andl    $-16, %ecx
+	subl    $16, %ecx
+	movl    36(%esp), %eax          /* arg */
+	movl    %eax, 0(%ecx)
+	movl    32(%esp), %eax          /* fn */
+	movl    %eax, 4(%ecx)
+
+	movl    16(%esp), %ebx          /* flags */
+	movl    24(%esp), %edx          /* ptid */
+	xorl    %esi, %esi              /* tls */
+	movl    28(%esp), %edi          /* ctid */
+	movl    $NR_clone, %eax
+	int     $0x80
+
+	testl   %eax, %eax
+	jz      1f
+
+	popl    %edi
+	popl    %esi
+	popl    %ebx
+	ret
+1:
+	xorl    %ebp, %ebp
+	movl    4(%esp), %eax
+	call    *%eax
+	movl    %eax, %ebx
+	movl    $NR_exit, %eax
+	int     $0x80
+	hlt
+
+.type thread_clone,@function
+.size thread_clone,.-thread_clone
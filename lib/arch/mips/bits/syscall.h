@@ -364,5 +364,9 @@
 #define NR_copy_file_range            NR(360)
 #define NR_preadv2                    NR(361)
 #define NR_pwritev2                   NR(362)
+#define NR_statx                      NR(366)
+#define NR_io_uring_setup             NR(425)
+#define NR_io_uring_enter             NR(426)
+#define NR_io_uring_register          NR(427)
 
 #endif
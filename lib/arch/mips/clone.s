@@ -0,0 +1,57 @@
+.equ NR_clone, 4120
+.equ NR_exit, 4001
+
+/* long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                     int (*fn)(void*), void* arg)
+
+   See x86_64/clone.s. The kernel takes tls before ctid, and with o32
+   the fifth syscall argument goes to 16($sp). Errors are flagged in $a3
+   with a positive errno in $v0. The child needs fn in $t9 for PIC.
+
+   The new stack gets the usual 16 bytes of argument space for fn,
+   with fn and arg stashed right above it. */
+
+.text
+.align 4
+.globl thread_clone
+.set noreorder
+
+thread_clone:
+	lw      $t0, 16($sp)        /* fn */
+	lw      $t1, 20($sp)        /* arg */
+	li      $t2, -8
+	and     $a1, $a1, $t2
+	addiu   $a1, $a1, -24
+	sw      $t0, 16($a1)
+	sw      $t1, 20($a1)
+
+	addiu   $sp, $sp, -24
+	sw      $a3, 16($sp)        /* ctid */
+	move    $a3, $zero          /* tls */
+	li      $v0, NR_clone
+	syscall
+
+	bnez    $a3, 2f
+	nop
+	beqz    $v0, 1f             /* child, running on the new stack */
+	nop
+	jr      $ra
+	addiu   $sp, $sp, 24        /* delay slot */
+2:
+	subu    $v0, $zero, $v0
+	jr      $ra
+	addiu   $sp, $sp, 24        /* delay slot */
+1:
+	move    $fp, $zero
+	lw      $t9, 16($sp)
+	lw      $a0, 20($sp)
+	jalr    $t9
+	nop
+	move    $a0, $v0
+	li      $v0, NR_exit
+	syscall
+
+.set reorder
+
+.type thread_clone,function
+.size thread_clone,.-thread_clone
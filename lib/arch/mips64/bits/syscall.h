@@ -326,5 +326,9 @@
 #define NR_pkey_mprotect              5323
 #define NR_pkey_alloc                 5324
 #define NR_pkey_free                  5325
+#define NR_statx                      5326
+#define NR_io_uring_setup             5425
+#define NR_io_uring_enter             5426
+#define NR_io_uring_register          5427
 
 #endif
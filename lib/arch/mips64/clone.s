@@ -0,0 +1,48 @@
+.equ NR_clone, 5055
+.equ NR_exit, 5058
+
+# long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+#                   int (*fn)(void*), void* arg)
+#
+# See x86_64/clone.s. The kernel takes tls before ctid. With n64, all
+# arguments are in registers, $a4 and $a5 being $8 and $9. Errors are
+# flagged in $a3 with a positive errno in $v0. The child needs fn in $t9
+# since the code is PIC.
+
+.text
+.align 8
+.globl thread_clone
+.set noreorder
+
+thread_clone:
+	and     $5, $5, -16
+	dsubu   $5, $5, 16
+	sd      $8, 0($5)       /* fn */
+	sd      $9, 8($5)       /* arg */
+	move    $8, $7          /* ctid */
+	move    $7, $0          /* tls */
+	li      $2, NR_clone
+	syscall
+	bnez    $7, 2f
+	nop
+	beqz    $2, 1f
+	nop
+	jr      $31
+	nop
+2:
+	jr      $31
+	dsubu   $2, $0, $2      /* delay slot */
+1:
+	move    $fp, $0
+	ld      $25, 0($sp)
+	ld      $4, 8($sp)
+	jalr    $25
+	nop
+	move    $4, $2
+	li      $2, NR_exit
+	syscall
+
+.set reorder
+
+.type thread_clone,function
+.size thread_clone,.-thread_clone
@@ -265,5 +265,10 @@
 #define NR_getrandom            278
 #define NR_memfd_create         279
 #define NR_bpf                  280
+#define NR_copy_file_range      285
+#define NR_statx                291
+#define NR_io_uring_setup       425
+#define NR_io_uring_enter       426
+#define NR_io_uring_register    427
 
 #endif
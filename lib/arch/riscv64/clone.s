@@ -0,0 +1,34 @@
+.equ NR_clone, 220
+.equ NR_exit, 93
+
+/* long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                     int (*fn)(void*), void* arg)
+
+   See x86_64/clone.s. The kernel takes tls before ctid here. */
+
+.text
+.align 4
+.global thread_clone
+
+thread_clone:
+	andi    a1, a1, -16
+	addi    a1, a1, -16
+	sd      a4, 0(a1)    /* fn */
+	sd      a5, 8(a1)    /* arg */
+	mv      a4, a3       /* ctid */
+	li      a3, 0        /* tls */
+	li      a7, NR_clone
+	ecall
+	beqz    a0, 1f
+	ret
+1:
+	ld      a1, 0(sp)
+	ld      a0, 8(sp)
+	addi    sp, sp, 16
+	li      x8, 0
+	jalr    a1
+	li      a7, NR_exit
+	ecall
+
+.type thread_clone,function
+.size thread_clone,.-thread_clone
@@ -318,5 +318,11 @@
 #define NR_renameat2            316
 #define NR_seccomp              317
 #define NR_getrandom            318
+#define NR_memfd_create         319
+#define NR_copy_file_range      326
+#define NR_statx                332
+#define NR_io_uring_setup       425
+#define NR_io_uring_enter       426
+#define NR_io_uring_register    427
 
 #endif
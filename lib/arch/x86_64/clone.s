@@ -0,0 +1,37 @@
+.equ NR_clone, 56
+.equ NR_exit, 60
+
+/* long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                     int (*fn)(void*), void* arg)
+
+   Raw clone() for threads. The child starts on the new stack with
+   nothing but fn and arg, calls fn(arg) and exits with its return
+   value. The parent gets the usual clone() result. */
+
+.text
+.globl thread_clone
+
+thread_clone:
+	andq    $-16, %rsi              /* align the new stack */
+	subq    $16, %rsi
+	movq    %r8, 0(%rsi)            /* fn */
+	movq    %r9, 8(%rsi)            /* arg */
+	movq    %rcx, %r10              /* ctid */
+	xorl    %r8d, %r8d              /* tls */
+	movq    $NR_clone, %rax
+	syscall
+	testq   %rax, %rax
+	jz      1f
+	ret
+1:
+	xorl    %ebp, %ebp
+	popq    %rax                    /* fn */
+	popq    %rdi                    /* arg */
+	call    *%rax
+	movq    %rax, %rdi
+	movq    $NR_exit, %rax
+	syscall
+	hlt
+
+.size thread_clone,.-thread_clone
+.type thread_clone,function
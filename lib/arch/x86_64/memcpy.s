@@ -0,0 +1,59 @@
+/* SSE2 memcpy. Blocks of 16 bytes go through unaligned loads and stores,
+   which are as fast as aligned ones on anything with SSE2. The last block
+   is loaded upfront and stored at the very end, possibly overlapping
+   the one before it.
+
+   Copying goes strictly forward; memmove() relies on that. */
+
+.text
+.globl memcpy
+
+memcpy:
+	movq    %rdi, %rax
+	cmpq    $16, %rdx
+	jb      3f
+
+	movdqu  -16(%rsi,%rdx), %xmm1
+	leaq    -16(%rdi,%rdx), %rcx
+1:
+	movdqu  (%rsi), %xmm0
+	movdqu  %xmm0, (%rdi)
+	addq    $16, %rsi
+	addq    $16, %rdi
+	subq    $16, %rdx
+	cmpq    $16, %rdx
+	jae     1b
+
+	movdqu  %xmm1, (%rcx)
+	ret
+3:
+	cmpq    $8, %rdx
+	jb      4f
+	movq    (%rsi), %rcx
+	movq    -8(%rsi,%rdx), %r8
+	movq    %rcx, (%rdi)
+	movq    %r8, -8(%rdi,%rdx)
+	ret
+4:
+	cmpq    $4, %rdx
+	jb      5f
+	movl    (%rsi), %ecx
+	movl    -4(%rsi,%rdx), %r8d
+	movl    %ecx, (%rdi)
+	movl    %r8d, -4(%rdi,%rdx)
+	ret
+5:
+	testq   %rdx, %rdx
+	jz      7f
+6:
+	movb    (%rsi), %cl
+	movb    %cl, (%rdi)
+	incq    %rsi
+	incq    %rdi
+	decq    %rdx
+	jnz     6b
+7:
+	ret
+
+.type memcpy,function
+.size memcpy,.-memcpy
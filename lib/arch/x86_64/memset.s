@@ -0,0 +1,50 @@
+/* SSE2 memset, same layout as memcpy: the last 16 bytes are stored first,
+   the rest goes in 16-byte unaligned stores. */
+
+.text
+.globl memset
+
+memset:
+	movq    %rdi, %rax
+	movzbl  %sil, %ecx
+	movabsq $0x0101010101010101, %r8
+	imulq   %r8, %rcx
+
+	cmpq    $16, %rdx
+	jb      3f
+
+	movq    %rcx, %xmm0
+	punpcklqdq %xmm0, %xmm0
+	movdqu  %xmm0, -16(%rdi,%rdx)
+1:
+	movdqu  %xmm0, (%rdi)
+	addq    $16, %rdi
+	subq    $16, %rdx
+	cmpq    $16, %rdx
+	jae     1b
+	ret
+3:
+	cmpq    $8, %rdx
+	jb      4f
+	movq    %rcx, (%rdi)
+	movq    %rcx, -8(%rdi,%rdx)
+	ret
+4:
+	cmpq    $4, %rdx
+	jb      5f
+	movl    %ecx, (%rdi)
+	movl    %ecx, -4(%rdi,%rdx)
+	ret
+5:
+	testq   %rdx, %rdx
+	jz      7f
+6:
+	movb    %cl, (%rdi)
+	incq    %rdi
+	decq    %rdx
+	jnz     6b
+7:
+	ret
+
+.type memset,function
+.size memset,.-memset
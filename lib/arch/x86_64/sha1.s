@@ -0,0 +1,196 @@
+/* SHA-1 block function using the SHA-NI extension.
+
+   void sha1_hw_block(uint32_t H[5], char blk[64])
+
+   ABCD live in %xmm1 (A in the top lane), E alternates between %xmm2
+   and %xmm3 since sha1nexte needs the ABCD value from before the last
+   four rounds. Message words rotate through %xmm4-%xmm7.
+
+   Needs SSSE3 and SSE4.1 besides SHA itself; the caller checks. */
+
+.text
+.globl sha1_hw_block
+
+sha1_hw_block:
+	movdqu  0(%rdi), %xmm1
+	pxor    %xmm2, %xmm2
+	pinsrd  $3, 16(%rdi), %xmm2
+	pshufd  $0x1B, %xmm1, %xmm1
+
+	movdqa  flip(%rip), %xmm8
+
+	movdqa  %xmm2, %xmm9
+	movdqa  %xmm1, %xmm10
+
+	/* rounds 0-3 */
+	movdqu  0(%rsi), %xmm4
+	pshufb  %xmm8, %xmm4
+	paddd   %xmm4, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1rnds4 $0, %xmm2, %xmm1
+
+	/* rounds 4-7 */
+	movdqu  16(%rsi), %xmm5
+	pshufb  %xmm8, %xmm5
+	sha1nexte %xmm5, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1rnds4 $0, %xmm3, %xmm1
+	sha1msg1 %xmm5, %xmm4
+
+	/* rounds 8-11 */
+	movdqu  32(%rsi), %xmm6
+	pshufb  %xmm8, %xmm6
+	sha1nexte %xmm6, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1rnds4 $0, %xmm2, %xmm1
+	sha1msg1 %xmm6, %xmm5
+	pxor    %xmm6, %xmm4
+
+	/* rounds 12-15 */
+	movdqu  48(%rsi), %xmm7
+	pshufb  %xmm8, %xmm7
+	sha1nexte %xmm7, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm7, %xmm4
+	sha1rnds4 $0, %xmm3, %xmm1
+	sha1msg1 %xmm7, %xmm6
+	pxor    %xmm7, %xmm5
+
+	/* rounds 16-19 */
+	sha1nexte %xmm4, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm4, %xmm5
+	sha1rnds4 $0, %xmm2, %xmm1
+	sha1msg1 %xmm4, %xmm7
+	pxor    %xmm4, %xmm6
+
+	/* rounds 20-23 */
+	sha1nexte %xmm5, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm5, %xmm6
+	sha1rnds4 $1, %xmm3, %xmm1
+	sha1msg1 %xmm5, %xmm4
+	pxor    %xmm5, %xmm7
+
+	/* rounds 24-27 */
+	sha1nexte %xmm6, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm6, %xmm7
+	sha1rnds4 $1, %xmm2, %xmm1
+	sha1msg1 %xmm6, %xmm5
+	pxor    %xmm6, %xmm4
+
+	/* rounds 28-31 */
+	sha1nexte %xmm7, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm7, %xmm4
+	sha1rnds4 $1, %xmm3, %xmm1
+	sha1msg1 %xmm7, %xmm6
+	pxor    %xmm7, %xmm5
+
+	/* rounds 32-35 */
+	sha1nexte %xmm4, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm4, %xmm5
+	sha1rnds4 $1, %xmm2, %xmm1
+	sha1msg1 %xmm4, %xmm7
+	pxor    %xmm4, %xmm6
+
+	/* rounds 36-39 */
+	sha1nexte %xmm5, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm5, %xmm6
+	sha1rnds4 $1, %xmm3, %xmm1
+	sha1msg1 %xmm5, %xmm4
+	pxor    %xmm5, %xmm7
+
+	/* rounds 40-43 */
+	sha1nexte %xmm6, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm6, %xmm7
+	sha1rnds4 $2, %xmm2, %xmm1
+	sha1msg1 %xmm6, %xmm5
+	pxor    %xmm6, %xmm4
+
+	/* rounds 44-47 */
+	sha1nexte %xmm7, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm7, %xmm4
+	sha1rnds4 $2, %xmm3, %xmm1
+	sha1msg1 %xmm7, %xmm6
+	pxor    %xmm7, %xmm5
+
+	/* rounds 48-51 */
+	sha1nexte %xmm4, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm4, %xmm5
+	sha1rnds4 $2, %xmm2, %xmm1
+	sha1msg1 %xmm4, %xmm7
+	pxor    %xmm4, %xmm6
+
+	/* rounds 52-55 */
+	sha1nexte %xmm5, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm5, %xmm6
+	sha1rnds4 $2, %xmm3, %xmm1
+	sha1msg1 %xmm5, %xmm4
+	pxor    %xmm5, %xmm7
+
+	/* rounds 56-59 */
+	sha1nexte %xmm6, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm6, %xmm7
+	sha1rnds4 $2, %xmm2, %xmm1
+	sha1msg1 %xmm6, %xmm5
+	pxor    %xmm6, %xmm4
+
+	/* rounds 60-63 */
+	sha1nexte %xmm7, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm7, %xmm4
+	sha1rnds4 $3, %xmm3, %xmm1
+	sha1msg1 %xmm7, %xmm6
+	pxor    %xmm7, %xmm5
+
+	/* rounds 64-67 */
+	sha1nexte %xmm4, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm4, %xmm5
+	sha1rnds4 $3, %xmm2, %xmm1
+	sha1msg1 %xmm4, %xmm7
+	pxor    %xmm4, %xmm6
+
+	/* rounds 68-71 */
+	sha1nexte %xmm5, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1msg2 %xmm5, %xmm6
+	sha1rnds4 $3, %xmm3, %xmm1
+	pxor    %xmm5, %xmm7
+
+	/* rounds 72-75 */
+	sha1nexte %xmm6, %xmm2
+	movdqa  %xmm1, %xmm3
+	sha1msg2 %xmm6, %xmm7
+	sha1rnds4 $3, %xmm2, %xmm1
+
+	/* rounds 76-79 */
+	sha1nexte %xmm7, %xmm3
+	movdqa  %xmm1, %xmm2
+	sha1rnds4 $3, %xmm3, %xmm1
+
+	sha1nexte %xmm9, %xmm2
+	paddd   %xmm10, %xmm1
+
+	pshufd  $0x1B, %xmm1, %xmm1
+	movdqu  %xmm1, 0(%rdi)
+	pextrd  $3, %xmm2, 16(%rdi)
+	ret
+
+.size sha1_hw_block,.-sha1_hw_block
+.type sha1_hw_block,function
+
+.section .rodata
+.align 16
+
+flip:
+	.octa   0x000102030405060708090a0b0c0d0e0f
@@ -0,0 +1,247 @@
+/* SHA-256 block function using the SHA-NI extension.
+
+   void sha256_hw_block(uint32_t H[8], char blk[64])
+
+   The instructions want the state as ABEF and CDGH halves, so H gets
+   shuffled on the way in and back on the way out. Message words go
+   through a rolling window of four registers (%xmm3-%xmm6), %xmm0 is
+   the implicit W+K operand of sha256rnds2.
+
+   Needs SSSE3 and SSE4.1 besides SHA itself; the caller checks. */
+
+.text
+.globl sha256_hw_block
+
+sha256_hw_block:
+	movdqu  0(%rdi), %xmm1          /* DCBA */
+	movdqu  16(%rdi), %xmm2         /* HGFE */
+	pshufd  $0xB1, %xmm1, %xmm1     /* CDAB */
+	pshufd  $0x1B, %xmm2, %xmm2     /* EFGH */
+	movdqa  %xmm1, %xmm8
+	palignr $8, %xmm2, %xmm1        /* ABEF */
+	pblendw $0xF0, %xmm8, %xmm2     /* CDGH */
+
+	movdqa  flip(%rip), %xmm7
+	leaq    K256(%rip), %rax
+
+	movdqa  %xmm1, %xmm9
+	movdqa  %xmm2, %xmm10
+
+	/* rounds 0-3 */
+	movdqu  0(%rsi), %xmm0
+	pshufb  %xmm7, %xmm0
+	movdqa  %xmm0, %xmm3
+	paddd   0(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+
+	/* rounds 4-7 */
+	movdqu  16(%rsi), %xmm0
+	pshufb  %xmm7, %xmm0
+	movdqa  %xmm0, %xmm4
+	paddd   16(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm4, %xmm3
+
+	/* rounds 8-11 */
+	movdqu  32(%rsi), %xmm0
+	pshufb  %xmm7, %xmm0
+	movdqa  %xmm0, %xmm5
+	paddd   32(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm5, %xmm4
+
+	/* rounds 12-15 */
+	movdqu  48(%rsi), %xmm0
+	pshufb  %xmm7, %xmm0
+	movdqa  %xmm0, %xmm6
+	paddd   48(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm6, %xmm8
+	palignr $4, %xmm5, %xmm8
+	paddd   %xmm8, %xmm3
+	sha256msg2 %xmm6, %xmm3
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm6, %xmm5
+
+	/* rounds 16-19 */
+	movdqa  %xmm3, %xmm0
+	paddd   64(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm3, %xmm8
+	palignr $4, %xmm6, %xmm8
+	paddd   %xmm8, %xmm4
+	sha256msg2 %xmm3, %xmm4
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm3, %xmm6
+
+	/* rounds 20-23 */
+	movdqa  %xmm4, %xmm0
+	paddd   80(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm4, %xmm8
+	palignr $4, %xmm3, %xmm8
+	paddd   %xmm8, %xmm5
+	sha256msg2 %xmm4, %xmm5
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm4, %xmm3
+
+	/* rounds 24-27 */
+	movdqa  %xmm5, %xmm0
+	paddd   96(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm5, %xmm8
+	palignr $4, %xmm4, %xmm8
+	paddd   %xmm8, %xmm6
+	sha256msg2 %xmm5, %xmm6
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm5, %xmm4
+
+	/* rounds 28-31 */
+	movdqa  %xmm6, %xmm0
+	paddd   112(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm6, %xmm8
+	palignr $4, %xmm5, %xmm8
+	paddd   %xmm8, %xmm3
+	sha256msg2 %xmm6, %xmm3
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm6, %xmm5
+
+	/* rounds 32-35 */
+	movdqa  %xmm3, %xmm0
+	paddd   128(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm3, %xmm8
+	palignr $4, %xmm6, %xmm8
+	paddd   %xmm8, %xmm4
+	sha256msg2 %xmm3, %xmm4
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm3, %xmm6
+
+	/* rounds 36-39 */
+	movdqa  %xmm4, %xmm0
+	paddd   144(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm4, %xmm8
+	palignr $4, %xmm3, %xmm8
+	paddd   %xmm8, %xmm5
+	sha256msg2 %xmm4, %xmm5
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm4, %xmm3
+
+	/* rounds 40-43 */
+	movdqa  %xmm5, %xmm0
+	paddd   160(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm5, %xmm8
+	palignr $4, %xmm4, %xmm8
+	paddd   %xmm8, %xmm6
+	sha256msg2 %xmm5, %xmm6
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm5, %xmm4
+
+	/* rounds 44-47 */
+	movdqa  %xmm6, %xmm0
+	paddd   176(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm6, %xmm8
+	palignr $4, %xmm5, %xmm8
+	paddd   %xmm8, %xmm3
+	sha256msg2 %xmm6, %xmm3
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm6, %xmm5
+
+	/* rounds 48-51 */
+	movdqa  %xmm3, %xmm0
+	paddd   192(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm3, %xmm8
+	palignr $4, %xmm6, %xmm8
+	paddd   %xmm8, %xmm4
+	sha256msg2 %xmm3, %xmm4
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+	sha256msg1 %xmm3, %xmm6
+
+	/* rounds 52-55 */
+	movdqa  %xmm4, %xmm0
+	paddd   208(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm4, %xmm8
+	palignr $4, %xmm3, %xmm8
+	paddd   %xmm8, %xmm5
+	sha256msg2 %xmm4, %xmm5
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+
+	/* rounds 56-59 */
+	movdqa  %xmm5, %xmm0
+	paddd   224(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	movdqa  %xmm5, %xmm8
+	palignr $4, %xmm4, %xmm8
+	paddd   %xmm8, %xmm6
+	sha256msg2 %xmm5, %xmm6
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+
+	/* rounds 60-63 */
+	movdqa  %xmm6, %xmm0
+	paddd   240(%rax), %xmm0
+	sha256rnds2 %xmm1, %xmm2
+	pshufd  $0x0E, %xmm0, %xmm0
+	sha256rnds2 %xmm2, %xmm1
+
+	paddd   %xmm9, %xmm1
+	paddd   %xmm10, %xmm2
+
+	pshufd  $0x1B, %xmm1, %xmm1     /* FEBA */
+	pshufd  $0xB1, %xmm2, %xmm2     /* DCHG */
+	movdqa  %xmm1, %xmm8
+	pblendw $0xF0, %xmm2, %xmm1     /* DCBA */
+	palignr $8, %xmm8, %xmm2        /* HGFE */
+
+	movdqu  %xmm1, 0(%rdi)
+	movdqu  %xmm2, 16(%rdi)
+	ret
+
+.size sha256_hw_block,.-sha256_hw_block
+.type sha256_hw_block,function
+
+.section .rodata
+.align 16
+
+flip:
+	.octa   0x0c0d0e0f08090a0b0405060700010203
+K256:
+	.long   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5
+	.long   0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5
+	.long   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3
+	.long   0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174
+	.long   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc
+	.long   0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da
+	.long   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7
+	.long   0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967
+	.long   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13
+	.long   0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85
+	.long   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3
+	.long   0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070
+	.long   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5
+	.long   0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3
+	.long   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208
+	.long   0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
@@ -0,0 +1,38 @@
+/* SSE2 strlen. Loads are always 16-byte aligned so they never cross
+   a page boundary; the bytes preceding the string in the first block
+   are shifted out of the mask. */
+
+.text
+.globl strlen
+
+strlen:
+	movq    %rdi, %rax
+	movl    %edi, %ecx
+	andq    $-16, %rax
+	andl    $15, %ecx
+	pxor    %xmm0, %xmm0
+
+	movdqa  (%rax), %xmm1
+	pcmpeqb %xmm0, %xmm1
+	pmovmskb %xmm1, %edx
+	shrl    %cl, %edx
+	testl   %edx, %edx
+	jz      1f
+
+	bsfl    %edx, %eax
+	ret
+1:
+	addq    $16, %rax
+	movdqa  (%rax), %xmm1
+	pcmpeqb %xmm0, %xmm1
+	pmovmskb %xmm1, %edx
+	testl   %edx, %edx
+	jz      1b
+
+	bsfl    %edx, %edx
+	addq    %rdx, %rax
+	subq    %rdi, %rax
+	ret
+
+.type strlen,function
+.size strlen,.-strlen
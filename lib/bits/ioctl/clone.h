@@ -0,0 +1,7 @@
+#include <bits/ioctl.h>
+
+/* Reflink the whole source file, arg is the source fd.
+   Only works within the same filesystem, and only on those
+   that support shared extents (btrfs, xfs, overlay on top of them). */
+
+#define FICLONE  _IOW(0x94, 9, int)
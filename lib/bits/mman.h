@@ -5,6 +5,7 @@
 
 #define PAGE 4096
 
+#define PROT_NONE       0
 #define PROT_READ       (1<<0)
 #define PROT_WRITE      (1<<1)
 #define PROT_EXEC       (1<<2)
@@ -17,4 +18,10 @@
 #define MREMAP_MAYMOVE  (1<<0)
 #define MREMAP_FIXED    (1<<1)
 
+#define MADV_NORMAL     0
+#define MADV_RANDOM     1
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED   3
+#define MADV_DONTNEED   4
+
 #endif
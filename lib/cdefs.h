@@ -6,7 +6,9 @@
 
 #define __unused __attribute__((unused))
 #define __packed __attribute__((packed))
+#define __weak __attribute__((weak))
 #define noreturn __attribute__((noreturn))
+#define noinline __attribute__((noinline))
 
 #define unused(x) (void)x
 
@@ -34,9 +34,100 @@
 #include <crypto/pbkdf2.h>
 #include <endian.h>
 #include <string.h>
+#include <thread.h>
 
 #include "scrypt.h"
 
+/* With SSE2 or NEON around, salsa20/8 runs on four 4-word vectors,
+   one column (or, after shuffling, row) per vector. For that to work
+   without shuffling in and out on every call, the words of each 64-byte
+   block are kept permuted in X and V so that position i holds word 5i
+   mod 16, which puts the diagonals of the 4x4 matrix into vectors. Word
+   0 stays in place, so integerify does not care about the layout.
+
+   Anything else gets the original scalar code and the natural order. */
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+
+typedef uint32_t v4 __attribute__((vector_size(16)));
+typedef v4 v4u __attribute__((aligned(4)));
+
+static const v4 rot1 = { 1, 2, 3, 0 };
+static const v4 rot2 = { 2, 3, 0, 1 };
+static const v4 rot3 = { 3, 0, 1, 2 };
+
+static int position(int i)
+{
+	return (5*i) & 15;
+}
+
+static void blkcpy(uint32_t* dst, const uint32_t* src, size_t n)
+{
+	v4u* d = (v4u*)dst;
+	v4u* s = (v4u*)src;
+
+	for(size_t i = 0; i < n/4; i++)
+		d[i] = s[i];
+}
+
+static void blkxor(uint32_t* dst, const uint32_t* src, size_t n)
+{
+	v4u* d = (v4u*)dst;
+	v4u* s = (v4u*)src;
+
+	for(size_t i = 0; i < n/4; i++)
+		d[i] ^= s[i];
+}
+
+static v4 rotl(v4 x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static void salsa20_8(uint32_t B[16])
+{
+	v4u* b = (v4u*)B;
+	v4 X0 = b[0];
+	v4 X1 = b[1];
+	v4 X2 = b[2];
+	v4 X3 = b[3];
+	size_t i;
+
+	for (i = 0; i < 8; i += 2) {
+		/* columns */
+		X1 ^= rotl(X0 + X3, 7);
+		X2 ^= rotl(X1 + X0, 9);
+		X3 ^= rotl(X2 + X1, 13);
+		X0 ^= rotl(X3 + X2, 18);
+
+		X1 = __builtin_shuffle(X1, rot3);
+		X2 = __builtin_shuffle(X2, rot2);
+		X3 = __builtin_shuffle(X3, rot1);
+
+		/* rows */
+		X3 ^= rotl(X0 + X1, 7);
+		X2 ^= rotl(X3 + X0, 9);
+		X1 ^= rotl(X2 + X3, 13);
+		X0 ^= rotl(X1 + X2, 18);
+
+		X1 = __builtin_shuffle(X1, rot1);
+		X2 = __builtin_shuffle(X2, rot2);
+		X3 = __builtin_shuffle(X3, rot3);
+	}
+
+	b[0] += X0;
+	b[1] += X1;
+	b[2] += X2;
+	b[3] += X3;
+}
+
+#else
+
+static int position(int i)
+{
+	return i;
+}
+
 static void blkcpy(uint32_t* dst, const uint32_t* src, size_t n)
 {
 	for(size_t i = 0; i < n; i++)
@@ -95,6 +186,8 @@ static void salsa20_8(uint32_t B[16])
 	blkadd(B, x, 16);
 }
 
+#endif
+
 static void blockmix(const uint32_t* Bin, uint32_t* Bout, uint32_t* X, size_t r)
 {
 	size_t i;
@@ -111,12 +204,11 @@ static void blockmix(const uint32_t* Bin, uint32_t* Bout, uint32_t* X, size_t r)
 	}
 }
 
-static uint64_t integerify(uint32_t* B, size_t r)
+/* Only the low 32 bits are ever used since N is an uint. */
+
+static uint32_t integerify(uint32_t* B, size_t r)
 {
-	size_t i = (2*r - 1)*16;
-	uint64_t rh = B[i + 1];
-	uint64_t rl = B[i + 0];
-	return ((rh << 32) | rl);
+	return B[(2*r - 1)*16];
 }
 
 static void salsamix(uint32_t* B, int r, int N, uint32_t* V, void* XY)
@@ -129,7 +221,7 @@ static void salsamix(uint32_t* B, int r, int N, uint32_t* V, void* XY)
 	long k;
 
 	for (k = 0; k < 32*r; k++)
-		X[k] = itohl(B[k]);
+		X[k] = itohl(B[(k & ~15) | position(k & 15)]);
 
 	for (i = 0; i < N; i += 2) {
 		blkcpy(&V[i*(32*r)], X, 32*r);
@@ -148,7 +240,7 @@ static void salsamix(uint32_t* B, int r, int N, uint32_t* V, void* XY)
 	}
 
 	for (k = 0; k < 32*r; k++)
-		B[k] = htoil(X[k]);
+		B[(k & ~15) | position(k & 15)] = htoil(X[k]);
 }
 
 static void spbkdf(struct scrypt* sc, void* salt, int slen, void* dk, int dklen)
@@ -159,6 +251,15 @@ static void spbkdf(struct scrypt* sc, void* salt, int slen, void* dk, int dklen)
 	pbkdf2_sha256(dk, dklen, pass, plen, salt, slen, 1);
 }
 
+static ulong temp_size(uint n, uint r, uint p, uint threads)
+{
+	ulong B0size = 128*r*p;
+	ulong XYsize = 256*r + 64;
+	ulong V0size = 128*r*n;
+
+	return B0size + threads*(XYsize + V0size);
+}
+
 ulong scrypt_init(struct scrypt* sc, uint n, uint r, uint p)
 {
 	memzero(sc, sizeof(*sc));
@@ -166,15 +267,30 @@ ulong scrypt_init(struct scrypt* sc, uint n, uint r, uint p)
 	sc->n = n;
 	sc->p = p;
 	sc->r = r;
+	sc->threads = 1;
 
-	ulong B0size = 128*r*p;
-	ulong XYsize = 256*r + 64;
-	ulong V0size = 128*r*n;
-	ulong need = B0size + XYsize + V0size;
+	sc->templen = temp_size(n, r, p, 1);
 
-	sc->templen = need;
+	return sc->templen;
+}
 
-	return need;
+/* Each thread needs its own V and XY, so the amount of temporary
+   memory grows linearly with the number of threads. There is no point
+   in having more threads than lanes. */
+
+ulong scrypt_threads(struct scrypt* sc, uint threads)
+{
+	if(threads > sc->p)
+		threads = sc->p;
+	if(threads > SCRYPT_THREADS)
+		threads = SCRYPT_THREADS;
+	if(threads < 1)
+		threads = 1;
+
+	sc->threads = threads;
+	sc->templen = temp_size(sc->n, sc->r, sc->p, threads);
+
+	return sc->templen;
 }
 
 int scrypt_temp(struct scrypt* sc, void* buf, ulong len)
@@ -200,8 +316,22 @@ int scrypt_data(struct scrypt* sc, void* P, uint plen, void* S, uint slen)
 	return 0;
 }
 
-void scrypt_hash(struct scrypt* sc, void* dk, uint dklen)
+/* Lanes are independent of each other, thread k takes lanes k, k+t,
+   k+2t and so on, using the k-th XY+V area. The calling thread acts
+   as thread 0, and also picks up the share of any thread that failed
+   to start. */
+
+struct lanes {
+	struct scrypt* sc;
+	uint32_t* B;
+	int index;
+	int stride;
+};
+
+static int run_lanes(void* arg)
 {
+	struct lanes* ln = arg;
+	struct scrypt* sc = ln->sc;
 	int r = sc->r;
 	int p = sc->p;
 	int n = sc->n;
@@ -209,15 +339,53 @@ void scrypt_hash(struct scrypt* sc, void* dk, uint dklen)
 
 	ulong B0size = 128*r*p;
 	ulong XYsize = 256*r + 64;
+	ulong V0size = 128*r*n;
+
+	void* area = sc->temp + B0size + ln->index*(XYsize + V0size);
+	uint32_t* XY = area;
+	uint32_t* V = area + XYsize;
+
+	for(i = ln->index; i < p; i += ln->stride)
+		salsamix(&ln->B[i*32*r], r, n, V, XY);
+
+	return 0;
+}
+
+static void run_threads(struct scrypt* sc, uint32_t* B)
+{
+	struct lanes ln[SCRYPT_THREADS];
+	struct thread th[SCRYPT_THREADS];
+	int i, t = sc->threads;
+
+	for(i = 0; i < t; i++) {
+		ln[i].sc = sc;
+		ln[i].B = B;
+		ln[i].index = i;
+		ln[i].stride = t;
+	}
+
+	for(i = 1; i < t; i++)
+		if(thread_start(&th[i], run_lanes, &ln[i]) < 0)
+			th[i].stack = NULL;
+
+	run_lanes(&ln[0]);
+
+	for(i = 1; i < t; i++)
+		if(th[i].stack)
+			thread_join(&th[i]);
+		else
+			run_lanes(&ln[i]);
+}
 
-	uint32_t* B = (sc->temp + 0);
-	uint32_t* XY = (sc->temp + B0size);
-	uint32_t* V = (sc->temp + B0size + XYsize);
+void scrypt_hash(struct scrypt* sc, void* dk, uint dklen)
+{
+	int r = sc->r;
+	int p = sc->p;
+	uint32_t* B = sc->temp;
 
 	spbkdf(sc, sc->salt, sc->saltlen, B, 4*p*32*r);
 
-	for(i = 0; i < p; i++)
-		salsamix(&B[i*32*r], r, n, V, XY);
+	run_threads(sc, B);
 
 	spbkdf(sc, B, 4*p*32*r, dk, dklen);
 }
@@ -1,5 +1,9 @@
 #include <bits/types.h>
 
+/* The p lanes may be run in parallel, see scrypt_threads(). */
+
+#define SCRYPT_THREADS 32
+
 struct scrypt {
 	void* dk; uint dklen;
 	void* pass; uint passlen;
@@ -8,9 +12,11 @@ struct scrypt {
 	uint n; /* CPU/memory cost parameter */
 	uint p; /* parallelization parameter */
 	uint r; /* block size */
+	uint threads;
 };
 
 ulong scrypt_init(struct scrypt* sc, uint n, uint r, uint p);
+ulong scrypt_threads(struct scrypt* sc, uint threads);
 int scrypt_temp(struct scrypt* sc, void* buf, ulong len);
 int scrypt_data(struct scrypt* sc, void* P, uint plen, void* S, uint slen);
 void scrypt_hash(struct scrypt* sc, void* dk, uint dklen);
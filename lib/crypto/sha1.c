@@ -39,6 +39,7 @@
 #include <format.h>
 
 #include "sha1.h"
+#include "shahw.h"
 
 static uint32_t rol(uint32_t x, int n)
 {
@@ -153,39 +154,28 @@ static void sha1_put_size(char blk[64], uint64_t total)
 	*lw = htonl(bits & 0xFFFFFFFF);
 }
 
-static void sha1_load_pad1(struct sha1* sh, char* ptr, int tail, uint64_t total)
+static void sha1_pad1(char block[64], char* ptr, int tail, uint64_t total)
 {
-	char block[64];
-
 	memcpy(block, ptr, tail);
 	memset(block + tail, 0, 64 - tail);
 
 	block[tail] = 0x80;
 	sha1_put_size(block, total);
-
-	sha1_load(sh, block);
 }
 
-static void sha1_load_pad2(struct sha1* sh, char* ptr, int tail)
+static void sha1_pad2(char block[64], char* ptr, int tail)
 {
-	char block[64];
-
 	memcpy(block, ptr, tail);
 	memset(block + tail, 0, 64 - tail);
 
 	block[tail] = 0x80;
-
-	sha1_load(sh, block);
 }
 
-static void sha1_load_pad0(struct sha1* sh, uint64_t total)
+static void sha1_pad0(char block[64], uint64_t total)
 {
-	char block[64];
-
 	memset(block, 0, 64);
 
 	sha1_put_size(block, total);
-	sha1_load(sh, block);
 }
 
 /* Input must be processed in blocks of 64 bytes, except for the last
@@ -193,10 +183,19 @@ static void sha1_load_pad0(struct sha1* sh, uint64_t total)
 
    SHA1 needs *complete* size of the input, including all regular blocks
    processes from the very start, at the end of padding. The data pointed
-   to by ptr must be (total % 64) bytes long. */
+   to by ptr must be (total % 64) bytes long.
+
+   All blocks, including the padded ones, go through sha1_proc so that
+   the hardware path gets used for them as well if available. */
 
 void sha1_proc(struct sha1* sh, char blk[64])
 {
+#if defined(__x86_64__) || defined(__aarch64__)
+	if(sha_hwcaps() & SHA_HW_SHA1) {
+		sha1_hw_block(sh->H, blk);
+		return;
+	}
+#endif
 	sha1_load(sh, blk);
 	sha1_hash(sh);
 }
@@ -204,14 +203,15 @@ void sha1_proc(struct sha1* sh, char blk[64])
 void sha1_last(struct sha1* sh, char* ptr, int len, uint64_t total)
 {
 	int tail = len % 64;
+	char block[64];
 
 	if(tail > 55) {
-		sha1_load_pad2(sh, ptr, tail);
-		sha1_hash(sh);
-		sha1_load_pad0(sh, total);
-		sha1_hash(sh);
+		sha1_pad2(block, ptr, tail);
+		sha1_proc(sh, block);
+		sha1_pad0(block, total);
+		sha1_proc(sh, block);
 	} else {
-		sha1_load_pad1(sh, ptr, tail, total);
-		sha1_hash(sh);
+		sha1_pad1(block, ptr, tail, total);
+		sha1_proc(sh, block);
 	}
 }
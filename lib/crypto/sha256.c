@@ -39,6 +39,7 @@
 #include <format.h>
 
 #include "sha256.h"
+#include "shahw.h"
 
 static const uint32_t K[64] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
@@ -166,43 +167,38 @@ static void sha256_put_size(char blk[64], uint64_t total)
 	*lw = htonl(bits & 0xFFFFFFFF);
 }
 
-static void sha256_load_pad1(struct sha256* sh, char* ptr, int tail, uint64_t total)
+static void sha256_pad1(char block[64], char* ptr, int tail, uint64_t total)
 {
-	char block[64];
-
 	memcpy(block, ptr, tail);
 	memset(block + tail, 0, 64 - tail);
 
 	block[tail] = 0x80;
 	sha256_put_size(block, total);
-
-	sha256_load(sh, block);
 }
 
-static void sha256_load_pad2(struct sha256* sh, char* ptr, int tail)
+static void sha256_pad2(char block[64], char* ptr, int tail)
 {
-	char block[64];
-
 	memcpy(block, ptr, tail);
 	memset(block + tail, 0, 64 - tail);
 
 	block[tail] = 0x80;
-
-	sha256_load(sh, block);
 }
 
-static void sha256_load_pad0(struct sha256* sh, uint64_t total)
+static void sha256_pad0(char block[64], uint64_t total)
 {
-	char block[64];
-
 	memset(block, 0, 64);
 
 	sha256_put_size(block, total);
-	sha256_load(sh, block);
 }
 
 void sha256_proc(struct sha256* sh, char blk[64])
 {
+#if defined(__x86_64__) || defined(__aarch64__)
+	if(sha_hwcaps() & SHA_HW_SHA256) {
+		sha256_hw_block(sh->H, blk);
+		return;
+	}
+#endif
 	sha256_load(sh, blk);
 	sha256_hash(sh);
 }
@@ -210,14 +206,15 @@ void sha256_proc(struct sha256* sh, char blk[64])
 void sha256_last(struct sha256* sh, char* ptr, int len, uint64_t total)
 {
 	int tail = len % 64;
+	char block[64];
 
 	if(tail > 55) {
-		sha256_load_pad2(sh, ptr, tail);
-		sha256_hash(sh);
-		sha256_load_pad0(sh, total);
-		sha256_hash(sh);
+		sha256_pad2(block, ptr, tail);
+		sha256_proc(sh, block);
+		sha256_pad0(block, total);
+		sha256_proc(sh, block);
 	} else {
-		sha256_load_pad1(sh, ptr, tail, total);
-		sha256_hash(sh);
+		sha256_pad1(block, ptr, tail, total);
+		sha256_proc(sh, block);
 	}
 }
@@ -0,0 +1,100 @@
+#include <sys/file.h>
+#include <bits/auxvec.h>
+
+#include "shahw.h"
+
+static int caps = -1;
+static int allowed = ~0;
+
+#if defined(__x86_64__)
+
+static void cpuid(uint leaf, uint r[4])
+{
+	asm volatile ("cpuid"
+		: "=a"(r[0]), "=b"(r[1]), "=c"(r[2]), "=d"(r[3])
+		: "a"(leaf), "c"(0));
+}
+
+/* The SHA-NI code also uses pshufb (SSSE3) and pinsrd/pblendw (SSE4.1).
+   Any CPU with SHA has both, but it costs nothing to check. */
+
+static int probe(void)
+{
+	uint r[4];
+
+	cpuid(0, r);
+
+	if(r[0] < 7)
+		return 0;
+
+	cpuid(1, r);
+
+	if(!(r[2] & (1<<9)) || !(r[2] & (1<<19)))
+		return 0;
+
+	cpuid(7, r);
+
+	if(!(r[1] & (1<<29)))
+		return 0;
+
+	return SHA_HW_SHA1 | SHA_HW_SHA256;
+}
+
+#elif defined(__aarch64__)
+
+#define HWCAP_SHA1 (1<<5)
+#define HWCAP_SHA2 (1<<6)
+
+/* Reading ID registers from userspace only works on newer kernels,
+   so the hwcaps get picked from the aux vector instead. There is no
+   pointer to it around, but /proc/self/auxv has the same data. */
+
+static int probe(void)
+{
+	struct auxvec av[64];
+	int fd, rd, i, n;
+	long hwcap = 0;
+	int ret = 0;
+
+	if((fd = sys_open("/proc/self/auxv", O_RDONLY)) < 0)
+		return 0;
+
+	rd = sys_read(fd, av, sizeof(av));
+
+	sys_close(fd);
+
+	n = rd > 0 ? rd / sizeof(*av) : 0;
+
+	for(i = 0; i < n; i++)
+		if(av[i].key == AT_HWCAP)
+			hwcap = av[i].val;
+
+	if(hwcap & HWCAP_SHA1)
+		ret |= SHA_HW_SHA1;
+	if(hwcap & HWCAP_SHA2)
+		ret |= SHA_HW_SHA256;
+
+	return ret;
+}
+
+#else
+
+static int probe(void)
+{
+	return 0;
+}
+
+#endif
+
+int sha_hwcaps(void)
+{
+	if(caps < 0)
+		caps = probe();
+
+	return caps & allowed;
+}
+
+void sha_hwmask(int mask)
+{
+	allowed = mask;
+}
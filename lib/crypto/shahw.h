@@ -0,0 +1,19 @@
+#include <bits/types.h>
+
+/* Hardware SHA block functions: SHA-NI on x86_64, ARMv8 crypto
+   extensions on aarch64. sha1_proc and sha256_proc use them whenever
+   sha_hwcaps() says the CPU has them, and fall back to the C code
+   otherwise. The probe runs once and gets cached.
+
+   sha_hwmask() limits the set of capabilities used from then on,
+   mostly to let the tests run the same vectors through both paths.
+   sha_hwmask(~0) restores the probed set. */
+
+#define SHA_HW_SHA1    (1<<0)
+#define SHA_HW_SHA256  (1<<1)
+
+int sha_hwcaps(void);
+void sha_hwmask(int mask);
+
+void sha1_hw_block(uint32_t H[5], char blk[64]);
+void sha256_hw_block(uint32_t H[8], char blk[64]);
@@ -27,6 +27,7 @@ char* fmterr(char* p, char* e, int err);
 
 char* fmtbyte(char* p, char* e, char c);
 char* fmtbytes(char* p, char* e, const void* data, uint len);
+char* fmthexline(char* p, char* e, uint64_t addr, const void* data, int len);
 
 char* fmti32(char* p, char* e,  int32_t num);
 char* fmtu32(char* p, char* e, uint32_t num);
@@ -0,0 +1,101 @@
+#include <bits/types.h>
+#include <string.h>
+#include <format.h>
+
+/* One line of hexdump output, up to 16 bytes of data:
+
+   00000000   01 02 03 04 05 06 07  08 09 0A 0B 0C 0D 0E 0F  ................
+
+   Hexdump spends most of its time here, so the digits come from a table
+   of pre-formatted pairs and the line gets written without per-character
+   bounds checks whenever the buffer has room for the longest possible one.
+   Addresses take 8 digits until they need more. */
+
+#define LINEMAX (16 + 3 + 16*3 + 1 + 2 + 16 + 1)
+
+#define ROW(h) \
+	h"0", h"1", h"2", h"3", h"4", h"5", h"6", h"7", \
+	h"8", h"9", h"A", h"B", h"C", h"D", h"E", h"F"
+
+static const char pairs[256][2] = {
+	ROW("0"), ROW("1"), ROW("2"), ROW("3"),
+	ROW("4"), ROW("5"), ROW("6"), ROW("7"),
+	ROW("8"), ROW("9"), ROW("A"), ROW("B"),
+	ROW("C"), ROW("D"), ROW("E"), ROW("F")
+};
+
+static char* hexaddr(char* p, uint64_t addr)
+{
+	int i, n = 8;
+
+	while(n < 16 && (addr >> 4*n))
+		n += 2;
+
+	for(i = n/2 - 1; i >= 0; i--) {
+		const char* h = pairs[(addr >> 8*i) & 0xFF];
+		*p++ = h[0];
+		*p++ = h[1];
+	}
+
+	return p;
+}
+
+static char* hexline(char* p, uint64_t addr, const uint8_t* data, int len)
+{
+	int i;
+
+	p = hexaddr(p, addr);
+
+	*p++ = ' ';
+	*p++ = ' ';
+	*p++ = ' ';
+
+	for(i = 0; i < 16; i++) {
+		if(i < len) {
+			const char* h = pairs[data[i]];
+			p[0] = h[0];
+			p[1] = h[1];
+		} else {
+			p[0] = ' ';
+			p[1] = ' ';
+		}
+
+		p[2] = ' ';
+		p += 3;
+
+		if(i == 7)
+			*p++ = ' ';
+	}
+
+	*p++ = ' ';
+	*p++ = ' ';
+
+	for(i = 0; i < len; i++) {
+		uint8_t c = data[i];
+		*p++ = (c >= 0x20 && c < 0x7F) ? c : '.';
+	}
+
+	*p++ = '\n';
+
+	return p;
+}
+
+char* fmthexline(char* p, char* e, uint64_t addr, const void* data, int len)
+{
+	char buf[LINEMAX];
+	long n;
+
+	if(len > 16)
+		len = 16;
+	if(e - p >= LINEMAX)
+		return hexline(p, addr, data, len);
+
+	n = hexline(buf, addr, data, len) - buf;
+
+	if(n > e - p)
+		n = e - p;
+
+	memcpy(p, buf, n);
+
+	return p + n;
+}
@@ -42,3 +42,14 @@ void* halloc(struct heap* hp, long size)
 	return ptr;
 }
 
+/* Return unused pages past hp->ptr to the system. */
+
+void htrim(struct heap* hp)
+{
+	void* new = hp->brk + align(hp->ptr - hp->brk);
+
+	if(new >= hp->end)
+		return;
+
+	hp->end = (void*)sys_brk(new);
+}
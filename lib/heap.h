@@ -9,3 +9,23 @@ struct heap {
 void hinit(struct heap* hp, long size);
 void hextend(struct heap* hp, long size);
 void* halloc(struct heap* hp, long size);
+void htrim(struct heap* hp);
+
+/* Size-class allocator with free, for long-running services that need
+   to release per-connection or per-process state. Blocks are carved
+   from the heap in powers of two, freed blocks go onto per-class lists,
+   and the heap gets trimmed back whenever its tail becomes free.
+
+   Unlike halloc(), hpalloc() returns NULL when out of memory. */
+
+#define HPCLASSES 16
+
+struct hpool {
+	struct heap hp;
+	uint last;
+	void* free[HPCLASSES];
+};
+
+void hpinit(struct hpool* hp);
+void* hpalloc(struct hpool* hp, long size);
+void hpfree(struct hpool* hp, void* ptr);
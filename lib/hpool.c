@@ -0,0 +1,164 @@
+#include <sys/mman.h>
+#include <string.h>
+#include <heap.h>
+#include <util.h>
+
+/* Each block starts with a header holding its own size and the size
+   of the block immediately preceding it in the heap. The latter allows
+   walking back from the tail when trimming. Free blocks are linked
+   into per-class double-linked lists through their payload.
+
+   Sizes are powers of two starting at MINBLOCK, so the lowest bit
+   of the size field is available to mark free blocks. The payload
+   is 8-aligned, which is enough for anything in minibase. */
+
+#define MINBLOCK 32
+#define MINSHIFT 5
+#define FREE 1
+#define SLACK 4*PAGE
+
+struct block {
+	uint size;
+	uint prev;
+	struct block* next;
+	struct block* pred;
+};
+
+#define HDRSIZE offsetof(struct block, next)
+
+static int class_of(long size)
+{
+	long need = size + HDRSIZE;
+	int k = 0;
+
+	while((MINBLOCK << k) < need)
+		if(++k >= HPCLASSES)
+			return -1;
+
+	return k;
+}
+
+static int class_idx(struct block* b)
+{
+	return __builtin_ctz(b->size & ~FREE) - MINSHIFT;
+}
+
+static void link_free(struct hpool* hp, struct block* b)
+{
+	int k = class_idx(b);
+	struct block* head = hp->free[k];
+
+	b->size |= FREE;
+	b->pred = NULL;
+	b->next = head;
+
+	if(head) head->pred = b;
+
+	hp->free[k] = b;
+}
+
+static void unlink_free(struct hpool* hp, struct block* b)
+{
+	int k = class_idx(b);
+
+	if(b->pred)
+		b->pred->next = b->next;
+	else
+		hp->free[k] = b->next;
+	if(b->next)
+		b->next->pred = b->pred;
+
+	b->size &= ~FREE;
+}
+
+static struct block* carve(struct hpool* hp, uint size)
+{
+	struct heap* hh = &hp->hp;
+	void* ptr = hh->ptr;
+	void* end = ptr + size;
+
+	if(end > hh->end) {
+		void* req = hh->end + pagealign(end - hh->end);
+		void* new = sys_brk(req);
+
+		if(brk_error(hh->end, new) || new < end)
+			return NULL;
+
+		hh->end = new;
+	}
+
+	struct block* b = ptr;
+
+	b->size = size;
+	b->prev = hp->last;
+
+	hp->last = size;
+	hh->ptr = end;
+
+	return b;
+}
+
+/* Drop any free blocks at the tail of the heap. The pages past the
+   new tail only get released once at least SLACK bytes have piled up
+   there, which keeps brk from moving back and forth on short
+   alloc-free sequences. When that happens, htrim gives back everything
+   down to the page boundary above the tail. */
+
+static void trim_tail(struct hpool* hp)
+{
+	struct heap* hh = &hp->hp;
+
+	while(hh->ptr > hh->brk) {
+		struct block* b = hh->ptr - hp->last;
+
+		if(!(b->size & FREE))
+			break;
+
+		unlink_free(hp, b);
+
+		hh->ptr = b;
+		hp->last = b->prev;
+	}
+
+	if(hh->end - hh->ptr >= SLACK)
+		htrim(hh);
+}
+
+void hpinit(struct hpool* hp)
+{
+	void* brk = sys_brk(NULL);
+
+	memzero(hp, sizeof(*hp));
+
+	hp->hp.brk = brk;
+	hp->hp.ptr = brk;
+	hp->hp.end = brk;
+}
+
+void* hpalloc(struct hpool* hp, long size)
+{
+	struct block* b;
+	int k;
+
+	if((k = class_of(size)) < 0)
+		return NULL;
+
+	if((b = hp->free[k]))
+		unlink_free(hp, b);
+	else if(!(b = carve(hp, MINBLOCK << k)))
+		return NULL;
+
+	return (void*)b + HDRSIZE;
+}
+
+void hpfree(struct hpool* hp, void* ptr)
+{
+	if(!ptr) return;
+
+	struct block* b = ptr - HDRSIZE;
+
+	link_free(hp, b);
+
+	if((void*)b + (b->size & ~FREE) == hp->hp.ptr)
+		trim_tail(hp);
+}
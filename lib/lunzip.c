@@ -0,0 +1,250 @@
+#include <sys/mman.h>
+#include <string.h>
+#include <thread.h>
+#include <lzma.h>
+#include <lzip.h>
+
+/* Member-parallel lzip decoding, see lzip.h. Members are independent
+   LZMA streams with their own trailers, so once the trailers are parsed
+   and the output offsets known, each one can be decoded on its own into
+   the shared output buffer. Workers pick members off a shared counter,
+   the calling thread takes part as well. */
+
+struct member {
+	byte* src;
+	long slen;
+	byte* dst;
+	uint64_t dlen;
+	int ret;
+};
+
+struct shared {
+	struct member* mm;
+	int count;
+	int next;
+	uint32_t crctbl[256];
+};
+
+static uint64_t get_le(byte* p, int n)
+{
+	uint64_t ret = 0;
+
+	while(n-- > 0)
+		ret = (ret << 8) | p[n];
+
+	return ret;
+}
+
+static int check_header(byte* buf)
+{
+	if(memcmp(buf, "LZIP\x01", 5))
+		return LZIP_BAD_HEADER;
+
+	byte dscode = buf[5];
+	uint dictsize = 1 << (dscode & 0x1F);
+	dictsize -= (dictsize/16) * ((dscode >> 5) & 7);
+
+	if(dictsize < (1<<12) || dictsize > (1<<29))
+		return LZIP_BAD_HEADER;
+
+	return 0;
+}
+
+/* Members are found last to first. With mm == NULL, only counts them. */
+
+static int walk(byte* buf, long len, struct member* mm, int* count, uint64_t* size)
+{
+	byte* end = buf + len;
+	uint64_t total = 0;
+	int n = 0;
+	int ret;
+
+	while(end > buf) {
+		long left = end - buf;
+
+		if(left < 6 + 20)
+			return LZIP_BAD_TRAILER;
+
+		uint64_t msize = get_le(end - 8, 8);
+		uint64_t dsize = get_le(end - 16, 8);
+
+		if(msize < 6 + 20 || msize > (uint64_t)left)
+			return LZIP_BAD_TRAILER;
+
+		byte* start = end - msize;
+
+		if((ret = check_header(start)))
+			return ret;
+		if(total + dsize < total)
+			return LZIP_BAD_SIZE;
+
+		if(mm) {
+			struct member* m = &mm[*count - n - 1];
+
+			m->src = start;
+			m->slen = msize;
+			m->dlen = dsize;
+			m->ret = 0;
+		}
+
+		total += dsize;
+		end = start;
+		n++;
+	}
+
+	if(!n)
+		return LZIP_BAD_HEADER;
+
+	*count = n;
+	*size = total;
+
+	return 0;
+}
+
+int lzip_scan(void* buf, long len, uint64_t* size)
+{
+	int count;
+
+	return walk(buf, len, NULL, &count, size);
+}
+
+static void init_crc(struct shared* sh)
+{
+	static const uint mask[2] = { 0x00000000, 0xEDB88320U };
+	uint i, k, c;
+
+	for(i = 0; i < 256; i++) {
+		c = i;
+
+		for(k = 0; k < 8; k++)
+			c = (c >> 1) ^ mask[c & 1];
+
+		sh->crctbl[i] = c;
+	}
+}
+
+static uint32_t calc_crc(struct shared* sh, byte* ptr, uint64_t len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	byte* end = ptr + len;
+
+	while(ptr < end)
+		crc = sh->crctbl[(crc ^ *ptr++) & 0xFF] ^ (crc >> 8);
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+static int unpack(struct shared* sh, struct member* m)
+{
+	byte lzbuf[LZMA_SIZE];
+	struct lzma* lz;
+	byte* src = m->src;
+	byte* end = src + m->slen - 20;
+	int ret;
+
+	if(!(lz = lzma_create(lzbuf, sizeof(lzbuf))))
+		return -EINVAL;
+
+	/* skip the header and the leading zero byte of the range coder */
+	lz->srcbuf = src;
+	lz->srcptr = src + 7;
+	lz->srchwm = end;
+	lz->srcend = end;
+
+	lz->dstbuf = m->dst;
+	lz->dstptr = m->dst;
+	lz->dsthwm = m->dst + m->dlen;
+	lz->dstend = m->dst + m->dlen;
+
+	if((ret = lzma_inflate(lz)) != LZMA_STREAM_END)
+		return ret;
+	if(lz->srcptr != lz->srcend)
+		return LZIP_BAD_SIZE;
+	if(lz->dstptr != lz->dstend)
+		return LZIP_BAD_SIZE;
+	if(calc_crc(sh, m->dst, m->dlen) != get_le(end, 4))
+		return LZIP_BAD_CRC;
+
+	return 0;
+}
+
+static int worker(void* arg)
+{
+	struct shared* sh = arg;
+	int i;
+
+	while((i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED)) < sh->count)
+		sh->mm[i].ret = unpack(sh, &sh->mm[i]);
+
+	return 0;
+}
+
+static int run_workers(struct shared* sh, int threads)
+{
+	struct thread th[LZIP_THREADS];
+	int i, n = 0;
+
+	if(threads > sh->count)
+		threads = sh->count;
+	if(threads > LZIP_THREADS)
+		threads = LZIP_THREADS;
+
+	/* Failing to start some of the threads is not fatal,
+	   whatever is left will be done by the calling thread. */
+
+	for(i = 1; i < threads; i++)
+		if(thread_start(&th[n], worker, sh) >= 0)
+			n++;
+
+	worker(sh);
+
+	for(i = 0; i < n; i++)
+		thread_join(&th[i]);
+
+	for(i = 0; i < sh->count; i++)
+		if(sh->mm[i].ret)
+			return sh->mm[i].ret;
+
+	return 0;
+}
+
+int lzip_inflate(void* buf, long len, void* out, uint64_t size, int threads)
+{
+	struct shared sh;
+	uint64_t total;
+	int i, count, ret;
+
+	if((ret = walk(buf, len, NULL, &count, &total)))
+		return ret;
+	if(total != size)
+		return LZIP_BAD_SIZE;
+
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	long mlen = pagealign(count*sizeof(struct member));
+	struct member* mm = sys_mmap(NULL, mlen, prot, flags, -1, 0);
+
+	if((ret = mmap_error(mm)))
+		return ret;
+	if((ret = walk(buf, len, mm, &count, &total)))
+		goto out;
+
+	byte* dst = out;
+
+	for(i = 0; i < count; i++) {
+		mm[i].dst = dst;
+		dst += mm[i].dlen;
+	}
+
+	sh.mm = mm;
+	sh.count = count;
+	sh.next = 0;
+
+	init_crc(&sh);
+
+	ret = run_workers(&sh, threads);
+out:
+	sys_munmap(mm, mlen);
+
+	return ret;
+}
@@ -0,0 +1,137 @@
+#include <bits/errno.h>
+#include <string.h>
+#include <lzma.h>
+#include <lzip.h>
+#include <util.h>
+
+static void init_crc(struct lzip* lp)
+{
+	static const uint mask[2] = { 0x00000000, 0xEDB88320U };
+	uint i, k, c;
+
+	for(i = 0; i < 256; i++) {
+		c = i;
+
+		for(k = 0; k < 8; k++)
+			c = (c >> 1) ^ mask[c & 1];
+
+		lp->crctbl[i] = c;
+	}
+
+	lp->crc = 0xFFFFFFFF;
+}
+
+static void update_crc(struct lzip* lp, byte* ptr, long len)
+{
+	uint32_t crc = lp->crc;
+	byte* end = ptr + len;
+
+	while(ptr < end)
+		crc = lp->crctbl[(crc ^ *ptr++) & 0xFF] ^ (crc >> 8);
+
+	lp->crc = crc;
+}
+
+static int flush_output(struct lzip* lp)
+{
+	struct lzma* lz = lp->lz;
+	void* buf = lz->dstbuf;
+	long len = lz->dstptr - buf;
+	int ret;
+
+	if((ret = writeall(lp->fd, buf, len)) < 0)
+		return ret;
+
+	lp->osize += len;
+	lz->dstptr = buf;
+
+	return 0;
+}
+
+static byte* put_le(byte* p, uint64_t val, int n)
+{
+	for(int i = 0; i < n; i++)
+		*p++ = val >> 8*i;
+
+	return p;
+}
+
+int lzip_start(struct lzip* lp, int fd, void* buf, long len, int level)
+{
+	struct lzma* lz;
+
+	if(level < 1 || level > 9)
+		return -EINVAL;
+	if(len < LZIP_SIZE(level))
+		return -ENOMEM;
+	if(!(lz = lzma_deflate_create(buf, len - LZIP_OUTBUF, level)))
+		return -EINVAL;
+
+	byte* out = buf + len - LZIP_OUTBUF;
+
+	lz->dstbuf = out;
+	lz->dstptr = out + 6;
+	lz->dsthwm = out + LZIP_OUTBUF - 256;
+	lz->dstend = out + LZIP_OUTBUF;
+
+	memcpy(out, "LZIP\x01", 5);
+	out[5] = LZMA_DICT_BITS(level);
+
+	lp->fd = fd;
+	lp->lz = lz;
+	lp->isize = 0;
+	lp->osize = 0;
+
+	init_crc(lp);
+
+	return 0;
+}
+
+int lzip_write(struct lzip* lp, void* data, long len)
+{
+	struct lzma* lz = lp->lz;
+	int ret;
+
+	update_crc(lp, data, len);
+	lp->isize += len;
+
+	lz->srcbuf = data;
+	lz->srcptr = data;
+	lz->srchwm = data + len;
+	lz->srcend = data + len;
+
+	while((ret = lzma_deflate(lz)) == LZMA_NEED_OUTPUT)
+		if((ret = flush_output(lp)) < 0)
+			return ret;
+
+	if(ret != LZMA_NEED_INPUT)
+		return -EINVAL;
+
+	return 0;
+}
+
+int lzip_finish(struct lzip* lp)
+{
+	struct lzma* lz = lp->lz;
+	int ret;
+
+	while((ret = lzma_finish(lz)) == LZMA_NEED_OUTPUT)
+		if((ret = flush_output(lp)) < 0)
+			return ret;
+
+	if(ret != LZMA_STREAM_END)
+		return -EINVAL;
+
+	if((ret = flush_output(lp)) < 0)
+		return ret;
+
+	byte* p = lz->dstbuf;
+
+	p = put_le(p, lp->crc ^ 0xFFFFFFFF, 4);
+	p = put_le(p, lp->isize, 8);
+	p = put_le(p, lp->osize + 20, 8);
+
+	lz->dstptr = p;
+
+	return flush_output(lp);
+}
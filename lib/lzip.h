@@ -0,0 +1,48 @@
+#include <bits/types.h>
+
+/* Writing .lz files: lzip header, a single LZMA member, and the trailer
+   with CRC and sizes. The LZMA part is done by lzma_deflate(), which
+   needs <lzma.h> to be included before this file.
+
+   The caller supplies a zeroed workspace of at least LZIP_SIZE(level)
+   bytes, typically fresh anonymous mmap. Compressed data is buffered
+   there as well, and gets written to fd in LZIP_OUTBUF-sized chunks.
+
+   All calls return 0 on success or a negative errno value. */
+
+#define LZIP_OUTBUF (64*1024)
+#define LZIP_SIZE(level) (LZMA_DEFLATE_SIZE(level) + LZIP_OUTBUF)
+
+struct lzip {
+	int fd;
+	struct lzma* lz;
+	uint32_t crc;
+	uint64_t isize;
+	uint64_t osize;
+	uint32_t crctbl[256];
+};
+
+int lzip_start(struct lzip* lp, int fd, void* buf, long len, int level);
+int lzip_write(struct lzip* lp, void* data, long len);
+int lzip_finish(struct lzip* lp);
+
+/* Reading .lz files. The whole input is expected to be in memory,
+   and gets unpacked into a single output buffer. Files with multiple
+   members (as made by plzip or lzip -b) get decoded in parallel, one
+   member per thread at a time, using up to the given number of threads.
+   Single-member files are decoded in the calling thread.
+
+   lzip_scan() walks the member trailers from the end of the file and
+   reports the total uncompressed size, which is the size of the buffer
+   lzip_inflate() needs. Both return 0 on success, negative errno on
+   system errors, or a positive LZMA_* or LZIP_* code for malformed data. */
+
+#define LZIP_BAD_HEADER   8
+#define LZIP_BAD_TRAILER  9
+#define LZIP_BAD_CRC     10
+#define LZIP_BAD_SIZE    11
+
+#define LZIP_THREADS     32
+
+int lzip_scan(void* buf, long len, uint64_t* size);
+int lzip_inflate(void* buf, long len, void* out, uint64_t size, int threads);
@@ -4,44 +4,12 @@
 #include <cdefs.h>
 #include <lzma.h>
 
-#define STATES 12
-#define PSTATES 4
-#define DSTATES 4
-#define DISLOTS 64
-#define LCONTEXT 8
-
-#define ALIGN_BITS 4
-#define DIST_MODEL_START 4
-#define DIST_MODEL_END 14
-
-#define STATE_LIT_LIT           0
-#define STATE_MATCH_LIT_LIT     1
-#define STATE_REP_LIT_LIT       2
-#define STATE_SHORTREP_LIT_LIT  3
-#define STATE_MATCH_LIT         4
-#define STATE_REP_LIT           5
-#define STATE_SHORTREP_LIT      6
-#define STATE_LIT_MATCH         7
-#define STATE_LIT_LONGREP       8
-#define STATE_LIT_SHORTREP      9
-#define STATE_NONLIT_MATCH     10
-#define STATE_NONLIT_REP       11
+#include "lzmadefs.h"
+
 /* not really states */
 #define STATE_INVALID          13
 #define STATE_INITIAL          14
 
-typedef struct {
-	uint32_t probability;
-} bitmodel;
-
-typedef struct {
-	bitmodel choice1;
-	bitmodel choice2;
-	bitmodel low[PSTATES][8];
-	bitmodel mid[PSTATES][8];
-	bitmodel high[256];
-} lenmodel;
-
 struct private {
 	struct lzma lz;
 
@@ -344,7 +312,7 @@ static uint dec_match(PZ, bitmodel bma[], uint bms, uint mbyte)
 	return ret & 0xFF;
 }
 
-uint dec_length(PZ, lenmodel* lm, uint pstate)
+static uint dec_length(PZ, lenmodel* lm, uint pstate)
 {
 	if(!dec_bit(pz, &lm->choice1))
 		return dec_tree(pz, BMS(lm->low[pstate]), 3);
@@ -470,6 +438,337 @@ static int inflate_longrep(PZ, int state, int pstate, int n)
 	return repeat_from_dict(pz, state, rep, len);
 }
 
+/* Fast path. Most of the stream gets decoded with plenty of room left
+   both in the input and in the output buffers, and in that case there
+   is no need to check the pointers for each bit or each byte.
+
+   The room is checked once per symbol instead: a single symbol consumes
+   at most one input byte per decoded bit, which is well under FASTIN,
+   and produces at most FASTOUT bytes of output. Range coder state is
+   kept in struct fast, which the compiler should be able to keep in
+   registers throughout decode_fast().
+
+   The code below must decode the same bitstream in the same way as
+   the generic code above. Range checks are omitted since bitmodel
+   indexes are bounded by construction here. */
+
+#define FASTIN  64
+#define FASTOUT 273
+
+struct fast {
+	uint32_t range;
+	uint32_t code;
+	byte* src;
+};
+
+static const byte lit_next[STATES] = { 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 4, 5 };
+
+static inline uint fast_bit(struct fast* f, bitmodel* bm)
+{
+	uint32_t probability = bm->probability;
+	uint32_t bound = (f->range >> 11) * probability;
+	uint bit;
+
+	if(f->code < bound) {
+		f->range = bound;
+		bm->probability = probability + (((1<<11) - probability) >> 5);
+		bit = 0;
+	} else {
+		f->range -= bound;
+		f->code -= bound;
+		bm->probability = probability - (probability >> 5);
+		bit = 1;
+	}
+
+	if(f->range <= 0x00FFFFFFU) {
+		f->range <<= 8;
+		f->code = (f->code << 8) | *(f->src)++;
+	}
+
+	return bit;
+}
+
+static inline uint fast_tree(struct fast* f, bitmodel bma[], uint n)
+{
+	uint i, ret = 1;
+
+	for(i = 0; i < n; i++)
+		ret = (ret << 1) | fast_bit(f, &bma[ret]);
+
+	return ret - (1 << n);
+}
+
+static inline uint fast_rtree(struct fast* f, bitmodel bma[], uint n)
+{
+	uint i, ret = 1, sym = 0;
+
+	for(i = 0; i < n; i++) {
+		uint bit = fast_bit(f, &bma[ret]);
+		ret = (ret << 1) | bit;
+		sym |= bit << i;
+	}
+
+	return sym;
+}
+
+static inline uint fast_direct(struct fast* f, uint n)
+{
+	uint ret = 0;
+
+	for(; n > 0; n--) {
+		f->range >>= 1;
+		ret <<= 1;
+
+		if(f->code >= f->range) {
+			f->code -= f->range;
+			ret |= 1;
+		}
+
+		if(f->range <= 0x00FFFFFFU) {
+			f->range <<= 8;
+			f->code = (f->code << 8) | *(f->src)++;
+		}
+	}
+
+	return ret;
+}
+
+static inline uint fast_length(struct fast* f, lenmodel* lm, uint pstate)
+{
+	if(!fast_bit(f, &lm->choice1))
+		return fast_tree(f, lm->low[pstate], 3);
+	if(!fast_bit(f, &lm->choice2))
+		return (1<<3) + fast_tree(f, lm->mid[pstate], 3);
+
+	return (1<<3) + (1<<3) + fast_tree(f, lm->high, 8);
+}
+
+/* Literals are the most common symbol. The plain literal case is
+   the 8-bit tree unrolled; the matched literal case follows the match
+   byte until the first mismatch and then continues as a plain tree. */
+
+static inline uint fast_literal(struct fast* f, bitmodel* bma)
+{
+	uint c = 1;
+
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+	c = (c << 1) | fast_bit(f, &bma[c]);
+
+	return c & 0xFF;
+}
+
+static inline uint fast_matched(struct fast* f, bitmodel* bma, uint mbyte)
+{
+	uint c = 1;
+
+	while(c < 0x100) {
+		uint matchbit = (mbyte >> 7) & 1;
+		uint bit = fast_bit(f, &bma[0x100 + (matchbit << 8) + c]);
+
+		mbyte <<= 1;
+		c = (c << 1) | bit;
+
+		if(matchbit != bit)
+			break;
+	}
+
+	while(c < 0x100)
+		c = (c << 1) | fast_bit(f, &bma[c]);
+
+	return c & 0xFF;
+}
+
+/* Returns rep (distance - 1), or 0xFFFFFFFF for the end marker. */
+
+static inline uint fast_distance(PZ, struct fast* f, uint len)
+{
+	uint dstate = len - 2 < DSTATES - 1 ? len - 2 : DSTATES - 1;
+	uint dislot = fast_tree(f, pz->dislot[dstate], 6);
+
+	if(dislot < DIST_MODEL_START)
+		return dislot;
+
+	uint limit = (dislot >> 1) - 1;
+	uint rep = (2 + (dislot & 1)) << limit;
+
+	if(dislot < DIST_MODEL_END)
+		return rep + fast_rtree(f, pz->dispec + rep - dislot, limit);
+
+	rep += fast_direct(f, limit - ALIGN_BITS) << ALIGN_BITS;
+	rep += fast_rtree(f, pz->align, ALIGN_BITS);
+
+	return rep;
+}
+
+static void decode_fast(LZ)
+{
+	struct private* pz = private(lz);
+	struct fast fs, *f = &fs;
+
+	byte* buf = lz->dstbuf;
+	byte* dst = lz->dstptr;
+	byte* start = dst;
+
+	byte* srclim = lz->srcend - FASTIN;
+	byte* dstlim = lz->dstend - FASTOUT;
+
+	if(srclim > (byte*)lz->srchwm)
+		srclim = lz->srchwm;
+	if(dstlim > (byte*)lz->dsthwm)
+		dstlim = lz->dsthwm;
+
+	f->range = pz->range;
+	f->code = pz->code;
+	f->src = lz->srcptr;
+
+	uint s = pz->state;
+	uint p0 = pz->pos_state;
+	uint* rep = (uint*)pz->rep;
+	uint len, r;
+
+	while(f->src <= srclim && dst <= dstlim) {
+		uint p = (p0 + (dst - start)) & 3;
+
+		if(!fast_bit(f, &pz->bit1[s][p])) {
+			bitmodel* bma = pz->literal[dst > buf ? dst[-1] >> 5 : 0];
+
+			if(s < STATE_LIT_MATCH)
+				*dst = fast_literal(f, bma);
+			else if(rep[0] < (uint)(dst - buf))
+				*dst = fast_matched(f, bma, *(dst - rep[0] - 1));
+			else
+				goto invalid;
+
+			s = lit_next[s];
+			dst++;
+			continue;
+		}
+
+		if(!fast_bit(f, &pz->bit2[s])) {
+			len = 2 + fast_length(f, &pz->matchlen, p);
+			r = fast_distance(pz, f, len);
+
+			if(r == 0xFFFFFFFF) {
+				error(pz, len == 2 ? LZMA_STREAM_END : LZMA_RANGE_CHECK);
+				break;
+			}
+
+			rep[3] = rep[2];
+			rep[2] = rep[1];
+			rep[1] = rep[0];
+			rep[0] = r;
+
+			s = s < STATE_LIT_MATCH ? STATE_LIT_MATCH : STATE_NONLIT_MATCH;
+		} else if(!fast_bit(f, &pz->bit3[s])) {
+			if(!fast_bit(f, &pz->shrt[s][p])) {
+				s = s < STATE_LIT_MATCH ? STATE_LIT_SHORTREP : STATE_NONLIT_REP;
+				len = 1;
+				goto copy;
+			}
+			len = 2 + fast_length(f, &pz->replen, p);
+			s = s < STATE_LIT_MATCH ? STATE_LIT_LONGREP : STATE_NONLIT_REP;
+		} else {
+			if(!fast_bit(f, &pz->bit4[s])) {
+				r = rep[1];
+			} else if(!fast_bit(f, &pz->bit5[s])) {
+				r = rep[2];
+				rep[2] = rep[1];
+			} else {
+				r = rep[3];
+				rep[3] = rep[2];
+				rep[2] = rep[1];
+			}
+
+			rep[1] = rep[0];
+			rep[0] = r;
+
+			len = 2 + fast_length(f, &pz->replen, p);
+			s = s < STATE_LIT_MATCH ? STATE_LIT_LONGREP : STATE_NONLIT_REP;
+		}
+	copy:
+		if(rep[0] >= (uint)(dst - buf))
+			goto invalid;
+
+		byte* from = dst - rep[0] - 1;
+
+		for(uint i = 0; i < len; i++)
+			dst[i] = from[i];
+
+		dst += len;
+	}
+
+	goto out;
+invalid:
+	error(pz, LZMA_INVALID_REF);
+out:
+	pz->range = f->range;
+	pz->code = f->code;
+	pz->state = s;
+	pz->pos_state = (p0 + (dst - start)) & 3;
+
+	lz->srcptr = f->src;
+	lz->dstptr = dst;
+}
+
+static int fast_room(LZ)
+{
+	byte* src = lz->srcptr;
+	byte* dst = lz->dstptr;
+#ifdef LZMA_NOFAST
+	return 0;
+#endif
+	if(src > (byte*)lz->srchwm || src > (byte*)lz->srcend - FASTIN)
+		return 0;
+	if(dst > (byte*)lz->dsthwm || dst > (byte*)lz->dstend - FASTOUT)
+		return 0;
+
+	return 1;
+}
+
+/* Generic path, one symbol at a time with all the checks. */
+
+static void decode_symbol(PZ)
+{
+	int p = pz->pos_state;
+	int s = pz->state;
+
+	if(range_check(pz, s, 12))
+		return;
+	if(range_check(pz, p, 4))
+		return;
+
+	if(!dec_bit(pz, &pz->bit1[s][p])) {                 /* 0....  */
+		s = inflate_literal(pz, s);
+	} else if(!dec_bit(pz, &pz->bit2[s])) {             /* 10.... */
+		s = inflate_match(pz, s, p);
+	} else if(!dec_bit(pz, &pz->bit3[s])) {             /* 110... */
+		if(!dec_bit(pz, &pz->shrt[s][p]))           /* 1100.. */
+			s = inflate_shortrep(pz, s);
+		else                                        /* 1101.. */
+			s = inflate_longrep(pz, s, p, 0);
+	} else {                                            /* 111... */
+		if(!dec_bit(pz, &pz->bit4[s]))              /* 1110.. */
+			s = inflate_longrep(pz, s, p, 1);
+		else if(!dec_bit(pz, &pz->bit5[s]))         /* 11110. */
+			s = inflate_longrep(pz, s, p, 2);
+		else                                        /* 11111. */
+			s = inflate_longrep(pz, s, p, 3);
+	}
+
+	pz->state = s;
+}
+
+/* The fast path is used whenever there is enough room for it, and
+   the generic one handles the tails of the buffers. Both stop once
+   either of the hwm-s gets crossed. Building with LZMA_NOFAST leaves
+   the generic path only, for comparison. */
+
 int lzma_inflate(LZ)
 {
 	struct private* pz = private(lz);
@@ -478,34 +777,13 @@ int lzma_inflate(LZ)
 	check_buffers(lz);
 
 	while(!(err = pz->error)) {
-		int p = pz->pos_state;
-		int s = pz->state;
-
-		if(range_check(pz, s, 12))
-			continue; /* actually abort */
-		if(range_check(pz, p, 4))
-			continue; /* ditto */
-
-		if(!dec_bit(pz, &pz->bit1[s][p])) {                 /* 0....  */
-			s = inflate_literal(pz, s);
-		} else if(!dec_bit(pz, &pz->bit2[s])) {             /* 10.... */
-			s = inflate_match(pz, s, p);
-		} else if(!dec_bit(pz, &pz->bit3[s])) {             /* 110... */
-			if(!dec_bit(pz, &pz->shrt[s][p]))           /* 1100.. */
-				s = inflate_shortrep(pz, s);
-			else                                        /* 1101.. */
-				s = inflate_longrep(pz, s, p, 0);
-		} else {                                            /* 111... */
-			if(!dec_bit(pz, &pz->bit4[s]))              /* 1110.. */
-				s = inflate_longrep(pz, s, p, 1);
-			else if(!dec_bit(pz, &pz->bit5[s]))         /* 11110. */
-				s = inflate_longrep(pz, s, p, 2);
-			else                                        /* 11111. */
-				s = inflate_longrep(pz, s, p, 3);
-		}
-
-		pz->state = s;
+		if(fast_room(lz))
+			decode_fast(lz);
+		else
+			decode_symbol(pz);
 
+		if(pz->error)
+			continue;
 		if(lz->srcptr > lz->srchwm)
 			return LZMA_NEED_INPUT;
 		if(lz->dstptr > lz->dsthwm)
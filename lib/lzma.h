@@ -61,3 +61,40 @@ struct lzma {
 
 struct lzma* lzma_create(void* buf, int len);
 int lzma_inflate(struct lzma* lz);
+
+/* Compression. Same structure, same pointers, but the roles are reversed:
+   lzma_deflate() consumes all the input between srcptr and srcend, and
+   writes compressed stream starting from dstptr. Once dstptr goes past
+   dsthwm, it returns LZMA_NEED_OUTPUT. The caller is expected to flush
+   the output and reset dstptr, there is no need to keep any of it.
+   Once all the input is consumed, LZMA_NEED_INPUT is returned.
+
+   There is no end of input indication in the src pointers. Instead, once
+   there is no more input, the caller should call lzma_finish() until it
+   returns LZMA_STREAM_END, flushing the output in between. The stream gets
+   terminated with an end marker.
+
+   The encoder keeps its own copy of the last dictsize bytes of input,
+   so srcbuf is not used and the caller may discard the data once it
+   has been consumed.
+
+   Levels 1 to 9 trade speed for compression ratio. Levels 1-3 use hash
+   chains for match finding, 4-9 use binary trees. The dictionary size
+   also depends on the level, see LZMA_DICT_BITS. The workspace must be
+   at least LZMA_DEFLATE_SIZE(level) bytes large, and it must be zeroed,
+   like fresh anonymous mmap-ed memory is. Most of it is the match finder
+   index, which only gets touched as the input grows.
+
+   The gap between dsthwm and dstend should be at least 64 bytes. */
+
+#define LZMA_DICT_BITS(level) \
+	((level) <= 3 ? 20 : (level) <= 6 ? 22 : 23)
+
+#define LZMA_DEFLATE_SIZE(level) \
+	(LZMA_SIZE + 4096 + (4 << 18) \
+	 + (2 << LZMA_DICT_BITS(level)) \
+	 + ((level) <= 3 ? 4 : 8)*(1L << LZMA_DICT_BITS(level)))
+
+struct lzma* lzma_deflate_create(void* buf, long len, int level);
+int lzma_deflate(struct lzma* lz);
+int lzma_finish(struct lzma* lz);
@@ -0,0 +1,896 @@
+#include <bits/types.h>
+#include <string.h>
+#include <cdefs.h>
+#include <lzma.h>
+
+#include "lzmadefs.h"
+
+/* LZMA encoder, the counterpart of lzma.c. Produces streams with lc=3,
+   lp=0, pb=2, which is what lzip uses and what the decoder supports.
+
+   The input gets copied into a window of 2*dictsize bytes. The match
+   finder indexes positions in the window by a hash of the next three
+   bytes, with either plain hash chains or binary trees on top of that.
+   When the window fills up, the older half of it gets dropped and all
+   the indexes get shifted down by dictsize.
+
+   Parsing is greedy with one step lookahead, using the same heuristics
+   as the "fast" mode of the reference encoder. There is no price-based
+   optimal parsing here, which is why even level 9 compresses somewhat
+   worse than lzip -9. */
+
+#define HASH_BITS 18
+#define NIL 0
+
+#define NPAIRS 8
+
+#define PHASE_DATA   0
+#define PHASE_MARKER 1
+#define PHASE_DONE   2
+
+struct level {
+	byte dictbits;
+	byte tree;
+	short depth;
+	short nice;
+};
+
+static const struct level levels[] = {
+	{ 20, 0,   4,  16 },
+	{ 20, 0,  16,  32 },
+	{ 20, 0,  48,  64 },
+	{ 22, 1,  16,  32 },
+	{ 22, 1,  24,  48 },
+	{ 22, 1,  32,  64 },
+	{ 23, 1,  48,  96 },
+	{ 23, 1,  64, 128 },
+	{ 23, 1, 128, 273 }
+};
+
+struct match {
+	uint len;
+	uint dist; /* distance - 1, like rep[] */
+};
+
+struct encoder {
+	struct lzma lz;
+
+	int phase;
+	int error;
+
+	uint dictsize;
+	uint depth;
+	uint nice;
+	int tree;
+
+	byte* win;
+	uint* head;
+	uint* chain;  /* hash chain links, or pairs of tree links */
+
+	uint wsize;
+	uint fill;    /* end of data in win */
+	uint cur;     /* position being encoded in win */
+	uint64_t pos; /* total bytes encoded */
+
+	uint64_t low;
+	uint32_t range;
+	uint64_t cachesize;
+	byte cache;
+
+	int state;
+	uint rep[4];
+
+	int pend;     /* number of pairs found ahead for cur, or -1 */
+	int pi;       /* which of pairs[] is for cur */
+	struct match pairs[2][NPAIRS];
+
+	bitmodel bit1[STATES][PSTATES];
+	bitmodel bit2[STATES];
+	bitmodel bit3[STATES];
+	bitmodel bit4[STATES];
+	bitmodel bit5[STATES];
+	bitmodel shrt[STATES][PSTATES];
+
+	bitmodel literal[LCONTEXT][0x300];
+	bitmodel dislot[DSTATES][DISLOTS];
+	bitmodel dispec[115];
+	bitmodel align[16];
+
+	lenmodel matchlen;
+	lenmodel replen;
+};
+
+#define LZ struct lzma* lz
+#define EN struct encoder* en
+
+static const byte lit_next[STATES] = { 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 4, 5 };
+
+static inline struct encoder* encoder(struct lzma* lz)
+{
+	return (struct encoder*)lz;
+}
+
+/* Range encoder */
+
+static void put_byte(EN, byte c)
+{
+	struct lzma* lz = &en->lz;
+	byte* ptr = lz->dstptr;
+
+	if(ptr >= (byte*)lz->dstend) {
+		en->error = LZMA_OUTPUT_OVER;
+		return;
+	}
+
+	*ptr++ = c;
+	lz->dstptr = ptr;
+}
+
+static void shift_low(EN)
+{
+	uint32_t low = en->low;
+	byte carry = en->low >> 32;
+
+	if(low < 0xFF000000U || carry) {
+		byte c = en->cache;
+
+		do {
+			put_byte(en, c + carry);
+			c = 0xFF;
+		} while(--en->cachesize);
+
+		en->cache = low >> 24;
+	}
+
+	en->cachesize++;
+	en->low = (low & 0x00FFFFFF) << 8;
+}
+
+static void normalize(EN)
+{
+	while(en->range <= 0x00FFFFFFU) {
+		en->range <<= 8;
+		shift_low(en);
+	}
+}
+
+static void enc_bit(EN, bitmodel* bm, uint bit)
+{
+	uint32_t probability = bm->probability;
+	uint32_t bound = (en->range >> 11) * probability;
+
+	if(!bit) {
+		en->range = bound;
+		bm->probability = probability + (((1<<11) - probability) >> 5);
+	} else {
+		en->low += bound;
+		en->range -= bound;
+		bm->probability = probability - (probability >> 5);
+	}
+
+	normalize(en);
+}
+
+static void enc_direct(EN, uint val, uint n)
+{
+	while(n-- > 0) {
+		en->range >>= 1;
+
+		if((val >> n) & 1)
+			en->low += en->range;
+
+		normalize(en);
+	}
+}
+
+static void enc_tree(EN, bitmodel bma[], uint n, uint val)
+{
+	uint i = 1;
+
+	while(n-- > 0) {
+		uint bit = (val >> n) & 1;
+		enc_bit(en, &bma[i], bit);
+		i = (i << 1) | bit;
+	}
+}
+
+static void enc_rtree(EN, bitmodel bma[], uint n, uint val)
+{
+	uint i = 1;
+
+	for(uint k = 0; k < n; k++) {
+		uint bit = (val >> k) & 1;
+		enc_bit(en, &bma[i], bit);
+		i = (i << 1) | bit;
+	}
+}
+
+static void enc_matched(EN, bitmodel bma[], uint c, uint mbyte)
+{
+	uint i = 1;
+	int k;
+
+	for(k = 7; k >= 0; k--) {
+		uint bit = (c >> k) & 1;
+		uint matchbit = (mbyte >> k) & 1;
+
+		enc_bit(en, &bma[0x100 + (matchbit << 8) + i], bit);
+		i = (i << 1) | bit;
+
+		if(bit != matchbit)
+			break;
+	}
+
+	for(k--; k >= 0; k--) {
+		uint bit = (c >> k) & 1;
+
+		enc_bit(en, &bma[i], bit);
+		i = (i << 1) | bit;
+	}
+}
+
+static void enc_length(EN, lenmodel* lm, uint len, uint pstate)
+{
+	len -= MATCH_MIN;
+
+	if(len < 8) {
+		enc_bit(en, &lm->choice1, 0);
+		enc_tree(en, lm->low[pstate], 3, len);
+	} else if(len < 16) {
+		enc_bit(en, &lm->choice1, 1);
+		enc_bit(en, &lm->choice2, 0);
+		enc_tree(en, lm->mid[pstate], 3, len - 8);
+	} else {
+		enc_bit(en, &lm->choice1, 1);
+		enc_bit(en, &lm->choice2, 1);
+		enc_tree(en, lm->high, 8, len - 16);
+	}
+}
+
+static uint dist_slot(uint dist)
+{
+	if(dist < DIST_MODEL_START)
+		return dist;
+
+	uint n = 31 - __builtin_clz(dist);
+
+	return (n << 1) | ((dist >> (n - 1)) & 1);
+}
+
+static void enc_distance(EN, uint dist, uint len)
+{
+	uint dstate = len - 2 < DSTATES - 1 ? len - 2 : DSTATES - 1;
+	uint slot = dist_slot(dist);
+
+	enc_tree(en, en->dislot[dstate], 6, slot);
+
+	if(slot < DIST_MODEL_START)
+		return;
+
+	uint limit = (slot >> 1) - 1;
+	uint base = (2 | (slot & 1)) << limit;
+	uint rest = dist - base;
+
+	if(slot < DIST_MODEL_END) {
+		enc_rtree(en, en->dispec + base - slot, limit, rest);
+	} else {
+		enc_direct(en, rest >> ALIGN_BITS, limit - ALIGN_BITS);
+		enc_rtree(en, en->align, ALIGN_BITS, rest & 15);
+	}
+}
+
+/* Symbols. These only do the encoding, moving through the window
+   is done by the parser below. */
+
+static void put_literal(EN)
+{
+	byte* p = en->win + en->cur;
+	uint ps = en->pos & 3;
+	int s = en->state;
+	bitmodel* bma = en->literal[p[-1] >> 5];
+
+	enc_bit(en, &en->bit1[s][ps], 0);
+
+	if(s < STATE_LIT_MATCH)
+		enc_tree(en, bma, 8, p[0]);
+	else
+		enc_matched(en, bma, p[0], *(p - en->rep[0] - 1));
+
+	en->state = lit_next[s];
+}
+
+static void put_match(EN, uint len, uint dist)
+{
+	uint ps = en->pos & 3;
+	int s = en->state;
+
+	enc_bit(en, &en->bit1[s][ps], 1);
+	enc_bit(en, &en->bit2[s], 0);
+	enc_length(en, &en->matchlen, len, ps);
+	enc_distance(en, dist, len);
+
+	en->rep[3] = en->rep[2];
+	en->rep[2] = en->rep[1];
+	en->rep[1] = en->rep[0];
+	en->rep[0] = dist;
+
+	en->state = s < STATE_LIT_MATCH ? STATE_LIT_MATCH : STATE_NONLIT_MATCH;
+}
+
+static void put_rep(EN, uint len, int n)
+{
+	uint ps = en->pos & 3;
+	int s = en->state;
+	uint rep = en->rep[n];
+
+	enc_bit(en, &en->bit1[s][ps], 1);
+	enc_bit(en, &en->bit2[s], 1);
+
+	if(!n) {
+		enc_bit(en, &en->bit3[s], 0);
+		enc_bit(en, &en->shrt[s][ps], len > 1);
+	} else {
+		enc_bit(en, &en->bit3[s], 1);
+
+		if(n == 1) {
+			enc_bit(en, &en->bit4[s], 0);
+		} else {
+			enc_bit(en, &en->bit4[s], 1);
+			enc_bit(en, &en->bit5[s], n > 2);
+		}
+	}
+
+	if(len == 1) {
+		en->state = s < STATE_LIT_MATCH ? STATE_LIT_SHORTREP : STATE_NONLIT_REP;
+		return;
+	}
+
+	enc_length(en, &en->replen, len, ps);
+
+	for(; n > 0; n--)
+		en->rep[n] = en->rep[n-1];
+
+	en->rep[0] = rep;
+
+	en->state = s < STATE_LIT_MATCH ? STATE_LIT_LONGREP : STATE_NONLIT_REP;
+}
+
+static void put_marker(EN)
+{
+	uint ps = en->pos & 3;
+	int s = en->state;
+
+	enc_bit(en, &en->bit1[s][ps], 1);
+	enc_bit(en, &en->bit2[s], 0);
+	enc_length(en, &en->matchlen, MATCH_MIN, ps);
+	enc_distance(en, 0xFFFFFFFF, MATCH_MIN);
+}
+
+/* Match finders. Both return up to NPAIRS (len, dist) pairs with
+   increasing len, the longest one last. Positions in the index that
+   are too far back to be referenced are treated as empty. */
+
+static inline uint hash3(byte* p)
+{
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static inline uint match_len(byte* p, byte* q, uint len, uint limit)
+{
+	while(len < limit && p[len] == q[len])
+		len++;
+
+	return len;
+}
+
+static int add_pair(struct match* m, int n, uint len, uint dist)
+{
+	if(n >= NPAIRS) {
+		memmove(m, m + 1, (NPAIRS - 1)*sizeof(*m));
+		n = NPAIRS - 1;
+	}
+
+	m[n].len = len;
+	m[n].dist = dist;
+
+	return n + 1;
+}
+
+static int hc_find(EN, uint pos, struct match* m)
+{
+	byte* p = en->win + pos;
+	uint avail = en->fill - pos;
+	uint limit = avail < MATCH_MAX ? avail : MATCH_MAX;
+	uint mask = en->dictsize - 1;
+	uint h = hash3(p);
+	uint cand = en->head[h];
+	uint depth = en->depth;
+	uint best = 1;
+	int n = 0;
+
+	en->head[h] = pos;
+	en->chain[pos & mask] = cand;
+
+	if(!m) return 0;
+
+	for(; depth > 0; depth--, cand = en->chain[cand & mask]) {
+		if(cand == NIL || cand >= pos || pos - cand >= en->dictsize)
+			break;
+
+		byte* q = en->win + cand;
+
+		if(q[best] != p[best])
+			continue;
+
+		uint len = match_len(p, q, 0, limit);
+
+		if(len <= best)
+			continue;
+
+		best = len;
+		n = add_pair(m, n, len, pos - cand - 1);
+
+		if(len >= en->nice || len >= limit)
+			break;
+	}
+
+	return n;
+}
+
+static int bt_find(EN, uint pos, struct match* m)
+{
+	byte* p = en->win + pos;
+	uint avail = en->fill - pos;
+	uint limit = avail < en->nice ? avail : en->nice;
+	uint mask = en->dictsize - 1;
+	uint h = hash3(p);
+	uint cand = en->head[h];
+	uint depth = en->depth;
+	uint* ptr0 = en->chain + 2*(pos & mask) + 1;
+	uint* ptr1 = en->chain + 2*(pos & mask);
+	uint len0 = 0, len1 = 0;
+	uint best = 1;
+	int n = 0;
+
+	en->head[h] = pos;
+
+	while(1) {
+		if(cand == NIL || cand >= pos || pos - cand >= en->dictsize || !depth--) {
+			*ptr0 = *ptr1 = NIL;
+			break;
+		}
+
+		uint* pair = en->chain + 2*(cand & mask);
+		byte* q = en->win + cand;
+		uint len = len0 < len1 ? len0 : len1;
+
+		if(q[len] == p[len]) {
+			len = match_len(p, q, len + 1, limit);
+
+			if(len > best) {
+				best = len;
+				if(m) n = add_pair(m, n, len, pos - cand - 1);
+			}
+
+			if(len >= limit) {
+				*ptr1 = pair[0];
+				*ptr0 = pair[1];
+				break;
+			}
+		}
+
+		if(q[len] < p[len]) {
+			*ptr1 = cand;
+			ptr1 = pair + 1;
+			cand = *ptr1;
+			len1 = len;
+		} else {
+			*ptr0 = cand;
+			ptr0 = pair;
+			cand = *ptr0;
+			len0 = len;
+		}
+	}
+
+	return n;
+}
+
+/* Adds pos to the index, and with non-NULL m, looks for matches.
+   The longest match gets extended past nice since the tree search
+   stops there. */
+
+static int find(EN, uint pos, struct match* m)
+{
+	uint avail = en->fill - pos;
+	int n;
+
+	if(avail < 3)
+		return 0;
+
+	if(en->tree)
+		n = bt_find(en, pos, m);
+	else
+		n = hc_find(en, pos, m);
+
+	if(n > 0 && m[n-1].len >= en->nice) {
+		struct match* b = &m[n-1];
+		byte* p = en->win + pos;
+		uint limit = avail < MATCH_MAX ? avail : MATCH_MAX;
+
+		b->len = match_len(p, p - b->dist - 1, b->len, limit);
+	}
+
+	return n;
+}
+
+/* Parser. Each call to encode_next() emits a single symbol. */
+
+static void advance(EN, uint from, uint len)
+{
+	uint end = en->cur + len;
+
+	for(uint pos = from; pos < end; pos++)
+		find(en, pos, NULL);
+
+	en->cur = end;
+	en->pos += len;
+}
+
+/* Whether rep can be used at cur + off. */
+
+static int rep_valid(EN, uint rep, uint off)
+{
+	return rep < en->pos + off && rep < en->cur + off;
+}
+
+static int change_pair(uint small, uint big)
+{
+	return (big >> 7) > small;
+}
+
+static void literal(EN, uint from)
+{
+	byte* p = en->win + en->cur;
+	uint rep0 = en->rep[0];
+
+	if(en->state < STATE_LIT_MATCH && rep_valid(en, rep0, 0) && p[0] == *(p - rep0 - 1))
+		put_rep(en, 1, 0);
+	else
+		put_literal(en);
+
+	advance(en, from, 1);
+}
+
+static int better_next(EN, struct match* next, int nn, uint mainlen, uint maindist)
+{
+	byte* p = en->win + en->cur + 1;
+	uint avail = en->fill - en->cur - 1;
+
+	if(nn > 0) {
+		uint len = next[nn-1].len;
+		uint dist = next[nn-1].dist;
+
+		if(len >= mainlen && dist < maindist)
+			return 1;
+		if(len == mainlen + 1 && !change_pair(maindist, dist))
+			return 1;
+		if(len > mainlen + 1)
+			return 1;
+		if(len + 1 >= mainlen && mainlen >= 3 && change_pair(dist, maindist))
+			return 1;
+	}
+
+	uint limit = mainlen - 1;
+
+	if(limit > avail)
+		limit = avail;
+
+	for(int i = 0; i < 4; i++) {
+		uint rep = en->rep[i];
+
+		if(!rep_valid(en, rep, 1))
+			continue;
+
+		byte* q = p - rep - 1;
+
+		if(p[0] != q[0] || p[1] != q[1])
+			continue;
+		if(match_len(p, q, 2, limit) >= limit)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void encode_next(EN)
+{
+	uint cur = en->cur;
+	byte* p = en->win + cur;
+	uint avail = en->fill - cur;
+	struct match* m = en->pairs[en->pi];
+	int i, n;
+
+	if(en->pend >= 0)
+		n = en->pend;
+	else
+		n = find(en, cur, m);
+
+	en->pend = -1;
+
+	if(avail > MATCH_MAX)
+		avail = MATCH_MAX;
+	if(avail < 2)
+		return literal(en, cur + 1);
+
+	uint replen = 0, repidx = 0;
+
+	for(i = 0; i < 4; i++) {
+		uint rep = en->rep[i];
+
+		if(!rep_valid(en, rep, 0))
+			continue;
+
+		byte* q = p - rep - 1;
+
+		if(p[0] != q[0] || p[1] != q[1])
+			continue;
+
+		uint len = match_len(p, q, 2, avail);
+
+		if(len >= en->nice) {
+			put_rep(en, len, i);
+			return advance(en, cur + 1, len);
+		} if(len > replen) {
+			replen = len;
+			repidx = i;
+		}
+	}
+
+	uint mainlen = n > 0 ? m[n-1].len : 0;
+	uint maindist = n > 0 ? m[n-1].dist : 0;
+
+	if(mainlen >= en->nice) {
+		put_match(en, mainlen, maindist);
+		return advance(en, cur + 1, mainlen);
+	}
+
+	while(n > 1 && mainlen == m[n-2].len + 1) {
+		if(!change_pair(m[n-2].dist, maindist))
+			break;
+
+		n--;
+		mainlen = m[n-1].len;
+		maindist = m[n-1].dist;
+	}
+
+	if(mainlen == 2 && maindist >= 0x80)
+		mainlen = 1;
+
+	if(replen >= 2 && ((replen + 1 >= mainlen) ||
+	                   (replen + 2 >= mainlen && maindist >= (1<<9)) ||
+	                   (replen + 3 >= mainlen && maindist >= (1<<15)))) {
+		put_rep(en, replen, repidx);
+		return advance(en, cur + 1, replen);
+	}
+
+	if(mainlen < 2 || avail <= 2)
+		return literal(en, cur + 1);
+
+	/* Lazy step: look at the next position, and if it's going to be
+	   better, leave the matches found there for the next call. */
+
+	struct match* next = en->pairs[en->pi ^ 1];
+	int nn = find(en, cur + 1, next);
+
+	if(better_next(en, next, nn, mainlen, maindist)) {
+		en->pi ^= 1;
+		en->pend = nn;
+		return literal(en, cur + 1);
+	}
+
+	put_match(en, mainlen, maindist);
+	advance(en, cur + 2, mainlen);
+}
+
+/* Window */
+
+static uint shift_down(uint v, uint off)
+{
+	return v > off ? v - off : NIL;
+}
+
+static void slide(EN)
+{
+	uint off = en->dictsize;
+	uint nh = 1 << HASH_BITS;
+	uint nc = en->tree ? 2*off : off;
+	uint i;
+
+	memmove(en->win, en->win + off, en->fill - off);
+
+	en->fill -= off;
+	en->cur -= off;
+
+	for(i = 0; i < nh; i++)
+		en->head[i] = shift_down(en->head[i], off);
+	for(i = 0; i < nc; i++)
+		en->chain[i] = shift_down(en->chain[i], off);
+}
+
+static void take_input(EN)
+{
+	struct lzma* lz = &en->lz;
+	byte* src = lz->srcptr;
+	byte* end = lz->srcend;
+	long left = end - src;
+	long room = en->wsize - en->fill;
+
+	if(left > room)
+		left = room;
+	if(left <= 0)
+		return;
+
+	memcpy(en->win + en->fill, src, left);
+
+	en->fill += left;
+	lz->srcptr = src + left;
+}
+
+static void encode(EN, int last)
+{
+	struct lzma* lz = &en->lz;
+
+	while(!en->error) {
+		uint avail = en->fill - en->cur;
+
+		if(!avail || (avail < MATCH_MAX && !last))
+			break;
+		if(lz->dstptr > lz->dsthwm)
+			break;
+
+		encode_next(en);
+	}
+}
+
+int lzma_deflate(LZ)
+{
+	struct encoder* en = encoder(lz);
+
+	while(!en->error) {
+		if(en->fill == en->wsize && en->fill - en->cur < MATCH_MAX)
+			slide(en);
+
+		take_input(en);
+
+		encode(en, 0);
+
+		if(en->error)
+			break;
+		if(lz->dstptr > lz->dsthwm)
+			return LZMA_NEED_OUTPUT;
+		if(lz->srcptr >= lz->srcend)
+			return LZMA_NEED_INPUT;
+	}
+
+	return en->error;
+}
+
+int lzma_finish(LZ)
+{
+	struct encoder* en = encoder(lz);
+	int ret;
+
+	if(lz->srcptr < lz->srcend)
+		if((ret = lzma_deflate(lz)) != LZMA_NEED_INPUT)
+			return ret;
+
+	if(en->phase == PHASE_DATA) {
+		encode(en, 1);
+
+		if(en->error)
+			return en->error;
+		if(en->cur < en->fill)
+			return LZMA_NEED_OUTPUT;
+
+		en->phase = PHASE_MARKER;
+	}
+
+	if(en->phase == PHASE_MARKER) {
+		if(lz->dstptr > lz->dsthwm)
+			return LZMA_NEED_OUTPUT;
+
+		put_marker(en);
+
+		for(int i = 0; i < 5; i++)
+			shift_low(en);
+
+		if(en->error)
+			return en->error;
+
+		en->phase = PHASE_DONE;
+	}
+
+	return LZMA_STREAM_END;
+}
+
+#define BMS(a) a, ARRAY_SIZE(a)
+#define BMD(a) (bitmodel*)a, ARRAY_SIZE(a)*ARRAY_SIZE(a[0])
+
+static void init_probs(bitmodel bmp[], uint size)
+{
+	for(uint i = 0; i < size; i++)
+		bmp[i].probability = (1<<10);
+}
+
+static void init_lenmodel(lenmodel* lm)
+{
+	init_probs(&lm->choice1, 1);
+	init_probs(&lm->choice2, 1);
+
+	init_probs(BMD(lm->low));
+	init_probs(BMD(lm->mid));
+	init_probs(BMS(lm->high));
+}
+
+static void init_models(EN)
+{
+	init_probs(BMD(en->bit1));
+	init_probs(BMS(en->bit2));
+	init_probs(BMS(en->bit3));
+	init_probs(BMS(en->bit4));
+	init_probs(BMS(en->bit5));
+	init_probs(BMD(en->shrt));
+
+	init_probs(BMD(en->literal));
+	init_probs(BMD(en->dislot));
+	init_probs(BMS(en->dispec));
+	init_probs(BMS(en->align));
+
+	init_lenmodel(&en->matchlen);
+	init_lenmodel(&en->replen);
+}
+
+/* Workspace layout: struct encoder, hash heads, chain or tree links,
+   and the window. See LZMA_DEFLATE_SIZE in lzma.h. */
+
+struct lzma* lzma_deflate_create(void* buf, long len, int level)
+{
+	struct encoder* en = buf;
+	const struct level* lv;
+
+	if(level < 1 || level > (int)ARRAY_SIZE(levels))
+		return NULL;
+	if(len < LZMA_DEFLATE_SIZE(level))
+		return NULL;
+	if(sizeof(*en) > LZMA_SIZE + 4096)
+		return NULL;
+
+	lv = &levels[level-1];
+
+	memzero(en, sizeof(*en));
+
+	en->dictsize = 1 << lv->dictbits;
+	en->depth = lv->depth;
+	en->nice = lv->nice;
+	en->tree = lv->tree;
+
+	en->head = buf + LZMA_SIZE + 4096;
+	en->chain = en->head + (1 << HASH_BITS);
+	en->win = (byte*)(en->chain + (en->tree ? 2 : 1)*en->dictsize);
+	en->wsize = 2*en->dictsize;
+
+	/* win[0] is the "previous byte" for the first literal */
+	en->win[0] = 0;
+	en->fill = 1;
+	en->cur = 1;
+
+	en->range = 0xFFFFFFFF;
+	en->cachesize = 1;
+	en->pend = -1;
+
+	init_models(en);
+
+	return &en->lz;
+}
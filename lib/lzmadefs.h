@@ -0,0 +1,40 @@
+/* Bits shared between the LZMA decoder (lzma.c) and the encoder
+   (lzma_deflate.c). Not for use outside of lib. */
+
+#define STATES 12
+#define PSTATES 4
+#define DSTATES 4
+#define DISLOTS 64
+#define LCONTEXT 8
+
+#define MATCH_MIN 2
+#define MATCH_MAX 273
+
+#define ALIGN_BITS 4
+#define DIST_MODEL_START 4
+#define DIST_MODEL_END 14
+
+#define STATE_LIT_LIT           0
+#define STATE_MATCH_LIT_LIT     1
+#define STATE_REP_LIT_LIT       2
+#define STATE_SHORTREP_LIT_LIT  3
+#define STATE_MATCH_LIT         4
+#define STATE_REP_LIT           5
+#define STATE_SHORTREP_LIT      6
+#define STATE_LIT_MATCH         7
+#define STATE_LIT_LONGREP       8
+#define STATE_LIT_SHORTREP      9
+#define STATE_NONLIT_MATCH     10
+#define STATE_NONLIT_REP       11
+
+typedef struct {
+	uint32_t probability;
+} bitmodel;
+
+typedef struct {
+	bitmodel choice1;
+	bitmodel choice2;
+	bitmodel low[PSTATES][8];
+	bitmodel mid[PSTATES][8];
+	bitmodel high[256];
+} lenmodel;
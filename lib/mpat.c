@@ -0,0 +1,175 @@
+#include <string.h>
+#include <heap.h>
+#include <mpat.h>
+
+/* Node 0 is the root. Children of a node form a linked list, except for
+   the root which gets a full 256-entry table since nearly every step
+   of the scan that does not continue some partial match lands there.
+
+   Each node may end several identical patterns, chained through same[],
+   and dict points to the nearest node down the failure chain that ends
+   some pattern, so reporting all matches at a given position does not
+   need to walk the whole failure chain. */
+
+static int child(struct mpat* mp, int n, byte c)
+{
+	struct mpnode* nodes = mp->nodes;
+	int i;
+
+	if(!n)
+		return mp->root[c];
+
+	for(i = nodes[n].child; i; i = nodes[i].next)
+		if(nodes[i].ch == c)
+			return i;
+
+	return 0;
+}
+
+static int add_node(struct mpat* mp, int parent, byte c)
+{
+	struct mpnode* nodes = mp->nodes;
+	int i = mp->nnodes++;
+	struct mpnode* nd = &nodes[i];
+
+	nd->ch = c;
+	nd->out = -1;
+
+	if(parent) {
+		nd->next = nodes[parent].child;
+		nodes[parent].child = i;
+	} else {
+		mp->root[c] = i;
+	}
+
+	return i;
+}
+
+static void add_pattern(struct mpat* mp, char* str, int idx)
+{
+	byte* s = (byte*)str;
+	int n = 0, c;
+
+	for(; *s; s++)
+		n = (c = child(mp, n, *s)) ? c : add_node(mp, n, *s);
+
+	mp->lens[idx] = s - (byte*)str;
+
+	if(!n) {
+		mp->same[idx] = mp->empty;
+		mp->empty = idx;
+	} else {
+		mp->same[idx] = mp->nodes[n].out;
+		mp->nodes[n].out = idx;
+	}
+}
+
+static int fail_link(struct mpat* mp, int parent, byte c)
+{
+	int f, n;
+
+	if(!parent)
+		return 0;
+
+	for(f = mp->nodes[parent].fail; ; f = mp->nodes[f].fail)
+		if((n = child(mp, f, c)) || !f)
+			return n;
+}
+
+/* Breadth-first, so that the failure links of all the shorter
+   prefixes are already known by the time a node gets its own. */
+
+static void link_nodes(struct mpat* mp, int* queue)
+{
+	struct mpnode* nodes = mp->nodes;
+	int head = 0, tail = 0;
+	int c, i;
+
+	for(c = 0; c < 256; c++)
+		if((i = mp->root[c]))
+			queue[tail++] = i;
+
+	while(head < tail) {
+		int n = queue[head++];
+		struct mpnode* nd = &nodes[n];
+		int f = nd->fail;
+
+		nd->dict = nodes[f].out >= 0 ? f : nodes[f].dict;
+
+		for(i = nd->child; i; i = nodes[i].next) {
+			nodes[i].fail = fail_link(mp, n, nodes[i].ch);
+			queue[tail++] = i;
+		}
+	}
+}
+
+void mp_compile(struct mpat* mp, struct heap* hp, char** patts, int n)
+{
+	long total = 1;
+	int i;
+
+	memzero(mp, sizeof(*mp));
+
+	for(i = 0; i < n; i++)
+		if(patts[i])
+			total += strlen(patts[i]);
+
+	mp->nodes = halloc(hp, total*sizeof(struct mpnode));
+	mp->same = halloc(hp, n*sizeof(int));
+	mp->lens = halloc(hp, n*sizeof(int));
+	mp->empty = -1;
+
+	memzero(mp->nodes, total*sizeof(struct mpnode));
+	mp->nodes[0].out = -1;
+	mp->nnodes = 1;
+
+	for(i = n - 1; i >= 0; i--)
+		if(patts[i])
+			add_pattern(mp, patts[i], i);
+
+	int* queue = halloc(hp, total*sizeof(int));
+
+	link_nodes(mp, queue);
+
+	hp->ptr = queue;
+}
+
+static int report(struct mpat* mp, int idx, int end, mpcall cb, void* data)
+{
+	int ret;
+
+	for(; idx >= 0; idx = mp->same[idx])
+		if(!cb)
+			return idx;
+		else if((ret = cb(data, idx, end)) >= 0)
+			return ret;
+
+	return -1;
+}
+
+int mp_scan(struct mpat* mp, char* buf, int len, mpcall cb, void* data)
+{
+	struct mpnode* nodes = mp->nodes;
+	byte* s = (byte*)buf;
+	int i, n = 0, ret;
+
+	if((ret = report(mp, mp->empty, 0, cb, data)) >= 0)
+		return ret;
+
+	for(i = 0; i < len; i++) {
+		byte c = s[i];
+		int m;
+
+		while(!(m = child(mp, n, c)) && n)
+			n = nodes[n].fail;
+
+		if(!(n = m))
+			continue;
+
+		for(m = nodes[n].out >= 0 ? n : nodes[n].dict; m; m = nodes[m].dict)
+			if((ret = report(mp, nodes[m].out, i + 1, cb, data)) >= 0)
+				return ret;
+	}
+
+	return -1;
+}
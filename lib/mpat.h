@@ -0,0 +1,40 @@
+#include <bits/types.h>
+
+/* Multi-pattern substring search (Aho-Corasick). The patterns get
+   compiled once into a trie with failure links, then each buffer is
+   scanned in a single pass no matter how many patterns there are.
+
+   mp_scan() reports matches in the order they end in the buffer,
+   longer ones first for the same end, then by pattern index.
+   Without a callback, it returns the index of the first match.
+   With one, the callback gets pattern index and the offset right past
+   the match, and the scan stops as soon as it returns a non-negative
+   value, which then gets returned by mp_scan(). No match is -1.
+
+   The pattern strings must stay around while the matcher is in use.
+   NULL patterns in the list are skipped. */
+
+struct heap;
+
+struct mpnode {
+	int child;
+	int next;
+	int fail;
+	int dict;
+	int out;
+	byte ch;
+};
+
+struct mpat {
+	struct mpnode* nodes;
+	int nnodes;
+	int* same;
+	int* lens;
+	int empty;
+	int root[256];
+};
+
+typedef int (*mpcall)(void* data, int idx, int end);
+
+void mp_compile(struct mpat* mp, struct heap* hp, char** patts, int n);
+int mp_scan(struct mpat* mp, char* buf, int len, mpcall cb, void* data);
@@ -0,0 +1,445 @@
+#include <sys/file.h>
+#include <sys/dents.h>
+
+#include <format.h>
+#include <string.h>
+#include <procs.h>
+#include <heap.h>
+#include <util.h>
+
+/* The record being read always sits at hp->ptr, and only gets committed
+   by moving hp->ptr past it. Dropping a process is then a matter of not
+   doing that. Any number of records may be read this way, the heap grows
+   as needed. */
+
+#define STATUS_FIELDS (PS_UIDS | PS_GIDS)
+#define STAT_FIELDS (PS_NAME | PS_STATE | PS_PPID)
+#define STATUS_KEYS (STAT_FIELDS | STATUS_FIELDS)
+#define CMDCHUNK 1024
+
+int ps_open(struct pstab* pt, struct heap* hp, int fields)
+{
+	int fd;
+
+	memzero(pt, sizeof(*pt));
+
+	if((fd = sys_open("/proc", O_DIRECTORY)) < 0)
+		return fd;
+
+	pt->fd = fd;
+	pt->hp = hp;
+	pt->fields = fields;
+	pt->recs = hp->ptr;
+
+	return fd;
+}
+
+void ps_close(struct pstab* pt)
+{
+	sys_close(pt->fd);
+	pt->fd = -1;
+}
+
+static int open_file(struct pstab* pt, char* pidstr, char* name)
+{
+	FMTBUF(p, e, path, 50);
+	p = fmtstr(p, e, pidstr);
+	p = fmtstr(p, e, "/");
+	p = fmtstr(p, e, name);
+	FMTEND(p, e);
+
+	return sys_openat(pt->fd, path, O_RDONLY);
+}
+
+/* With fd < 0, the file gets opened and closed right away. Otherwise
+   it's one of the fds kept by the caller, re-read from the start.
+   The contents end up in pt->buf, 0-terminated. */
+
+static int read_file(struct pstab* pt, int fd, char* pidstr, char* name)
+{
+	int size = sizeof(pt->buf) - 1;
+	int rd;
+
+	if(fd >= 0) {
+		rd = sys_pread(fd, pt->buf, size, 0);
+	} else if((fd = open_file(pt, pidstr, name)) >= 0) {
+		rd = sys_read(fd, pt->buf, size);
+		sys_close(fd);
+	} else {
+		return fd;
+	}
+
+	if(rd < 0)
+		return rd;
+	if(!rd)
+		return -ESRCH;
+
+	pt->buf[rd] = '\0';
+
+	return rd;
+}
+
+static void set_name(struct psent* ps, char* name, char* end)
+{
+	long len = end - name;
+
+	if(len > PS_NAMEMAX)
+		len = PS_NAMEMAX;
+
+	memcpy(ps->name, name, len);
+	ps->name[len] = '\0';
+	ps->nlen = len;
+}
+
+static char* skipspace(char* p, char* e)
+{
+	for(; p < e; p++)
+		if(*p != ' ' && *p != '\t')
+			break;
+
+	return p;
+}
+
+static char* skip_fields(char* p, char* e, int n)
+{
+	for(; n > 0; n--) {
+		while(p < e && *p != ' ')
+			p++;
+		while(p < e && *p == ' ')
+			p++;
+	}
+
+	return p;
+}
+
+static void set_ids(char* p, char* e, int* id, int* eid)
+{
+	if(!(p = parseint(p, id)))
+		return;
+
+	p = skipspace(p, e);
+
+	(void)parseint(p, eid);
+}
+
+/* The name in stat is in parens and may contain anything, including
+   spaces and parens, so it ends at the last ')' in the line.
+
+       1234 (some name) S 1 1234 1234 0 -1 ...
+
+   utime and stime are 10 fields past ppid, and get only parsed when
+   PS_TIMES has been requested. */
+
+static int parse_stat(struct psent* ps, char* buf, int len, int fields)
+{
+	char* end = buf + len;
+	uint64_t utime, stime;
+	char *p, *q;
+
+	if((p = strecbrk(buf, end, '(')) >= end)
+		return -EINVAL;
+
+	for(q = end - 1; q > p; q--)
+		if(*q == ')')
+			break;
+	if(q <= p || q + 4 >= end)
+		return -EINVAL;
+
+	set_name(ps, p + 1, q);
+
+	ps->state = q[2];
+
+	if(!(p = parseint(q + 4, &ps->ppid)))
+		return -EINVAL;
+	if(!(fields & PS_TIMES))
+		return 0;
+
+	p = skip_fields(p, end, 10);
+
+	if(!(p = parseu64(p, &utime)) || *p != ' ')
+		return -EINVAL;
+	if(!parseu64(p + 1, &stime))
+		return -EINVAL;
+
+	ps->ticks = utime + stime;
+
+	return 0;
+}
+
+/* statm is a line of page counts: size resident shared text ... */
+
+static int parse_statm(struct psent* ps, char* buf, int len)
+{
+	char* p = skip_fields(buf, buf + len, 1);
+
+	if(!parselong(p, &ps->rss))
+		return -EINVAL;
+
+	return 0;
+}
+
+/* Key-value lines, "Key:\tvalue\n". All the keys we may need are near
+   the top of the file, and parsing stops as soon as all requested ones
+   have been seen. Lines that did not fit into the buffer get ignored. */
+
+static int parse_line(struct psent* ps, char* key, char* val, char* end)
+{
+	int klen = val - key;
+
+	val = skipspace(val + 1, end);
+
+	if(klen == 4 && !memcmp(key, "Name", 4)) {
+		set_name(ps, val, end);
+		return PS_NAME;
+	} else if(klen == 5 && !memcmp(key, "State", 5)) {
+		ps->state = *val;
+		return PS_STATE;
+	} else if(klen == 4 && !memcmp(key, "PPid", 4)) {
+		(void)parseint(val, &ps->ppid);
+		return PS_PPID;
+	} else if(klen == 3 && !memcmp(key, "Uid", 3)) {
+		set_ids(val, end, &ps->uid, &ps->euid);
+		return PS_UIDS;
+	} else if(klen == 3 && !memcmp(key, "Gid", 3)) {
+		set_ids(val, end, &ps->gid, &ps->egid);
+		return PS_GIDS;
+	}
+
+	return 0;
+}
+
+static int parse_status(struct psent* ps, char* buf, int len, int want)
+{
+	char* end = buf + len;
+	char *ls, *le, *sep;
+	int got = 0;
+
+	for(ls = buf; ls < end; ls = le + 1) {
+		if((le = strecbrk(ls, end, '\n')) >= end)
+			break;
+		if((sep = strecbrk(ls, le, ':')) >= le)
+			break;
+
+		*le = '\0';
+
+		got |= parse_line(ps, ls, sep, le);
+
+		if((got & want) == want)
+			return 0;
+	}
+
+	return -EINVAL;
+}
+
+/* stat and statm only, either through the fds kept by the caller
+   or by opening them anew if those are negative. */
+
+static int read_stat(struct pstab* pt, struct psent* ps, char* pidstr,
+                     int statfd, int statmfd)
+{
+	int fields = pt->fields;
+	char* buf = pt->buf;
+	int rd, ret;
+
+	if(fields & (STAT_FIELDS | PS_TIMES)) {
+		if((rd = read_file(pt, statfd, pidstr, "stat")) < 0)
+			return rd;
+		if((ret = parse_stat(ps, buf, rd, fields)) < 0)
+			return ret;
+	}
+
+	if(fields & PS_RSS) {
+		if((rd = read_file(pt, statmfd, pidstr, "statm")) < 0)
+			return rd;
+		if((ret = parse_statm(ps, buf, rd)) < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int read_fields(struct pstab* pt, struct psent* ps, char* pidstr)
+{
+	int fields = pt->fields;
+	int rd, ret;
+
+	if(!(fields & STATUS_FIELDS))
+		return read_stat(pt, ps, pidstr, -1, -1);
+
+	if((rd = read_file(pt, -1, pidstr, "status")) < 0)
+		return rd;
+	if((ret = parse_status(ps, pt->buf, rd, fields & STATUS_KEYS)) < 0)
+		return ret;
+
+	/* status has the rest of stat fields but not the times */
+	pt->fields = fields & ~STAT_FIELDS;
+	ret = read_stat(pt, ps, pidstr, -1, -1);
+	pt->fields = fields;
+
+	return ret;
+}
+
+/* cmdline goes straight into the heap past the name. A short read means
+   the whole thing has been read. */
+
+static int read_cmdline(struct pstab* pt, struct psent* ps, char* pidstr)
+{
+	struct heap* hp = pt->hp;
+	char* p = ps_cmdline(ps);
+	int fd, rd;
+	long len;
+
+	FMTBUF(q, e, path, 50);
+	q = fmtstr(q, e, pidstr);
+	q = fmtstr(q, e, "/cmdline");
+	FMTEND(q, e);
+
+	if((fd = sys_openat(pt->fd, path, O_RDONLY)) < 0)
+		return fd;
+
+	while(1) {
+		hextend(hp, (p - (char*)hp->ptr) + CMDCHUNK);
+
+		len = hp->end - (void*)p;
+
+		if((rd = sys_read(fd, p, len)) > 0)
+			p += rd;
+		if(rd < len)
+			break;
+	}
+
+	sys_close(fd);
+
+	ps->clen = p - ps_cmdline(ps);
+
+	return 0;
+}
+
+int ps_load(struct pstab* pt, char* pidstr)
+{
+	struct heap* hp = pt->hp;
+	struct psent* ps;
+	long len;
+	int ret, pid;
+	char* p;
+
+	if(!(p = parseint(pidstr, &pid)) || *p)
+		return -EINVAL;
+
+	hextend(hp, sizeof(*ps) + PS_NAMEMAX + 1);
+
+	ps = hp->ptr;
+
+	memzero(ps, sizeof(*ps));
+
+	ps->pid = pid;
+	ps->name[0] = '\0';
+
+	if((ret = read_fields(pt, ps, pidstr)) < 0)
+		return ret;
+	if(pt->filter && pt->filter(pt, ps))
+		return 0;
+	if(pt->fields & PS_CMDLINE)
+		if((ret = read_cmdline(pt, ps, pidstr)) < 0)
+			return ret;
+
+	len = sizeof(*ps) + ps->nlen + 1 + ps->clen;
+	len = (len + 7) & ~7;
+
+	hextend(hp, len);
+
+	ps->len = len;
+	hp->ptr += len;
+	pt->count++;
+
+	return 1;
+}
+
+static int isdigit(int c)
+{
+	return (c >= '0' && c <= '9');
+}
+
+int ps_scan(struct pstab* pt)
+{
+	char buf[2048];
+	int rd;
+
+	while((rd = sys_getdents(pt->fd, buf, sizeof(buf))) > 0) {
+		void* ptr = buf;
+		void* end = buf + rd;
+
+		while(ptr < end) {
+			struct dirent* de = ptr;
+			ptr += de->reclen;
+
+			if(de->reclen <= 0)
+				break;
+			if(de->type != DT_DIR)
+				continue;
+			if(!isdigit(de->name[0]))
+				continue;
+
+			(void)ps_load(pt, de->name);
+		}
+	}
+
+	return rd;
+}
+
+void ps_index(struct pstab* pt)
+{
+	int i, count = pt->count;
+	void* ptr = pt->recs;
+	void* end = pt->hp->ptr;
+	struct psent** idx;
+
+	idx = halloc(pt->hp, count*sizeof(*idx));
+
+	for(i = 0; i < count && ptr < end; i++) {
+		struct psent* ps = ptr;
+		idx[i] = ps;
+		ptr += ps->len;
+	}
+
+	pt->idx = idx;
+	pt->count = i;
+}
+
+int ps_find(struct pstab* pt, int pid)
+{
+	struct psent** idx = pt->idx;
+	int lo = 0, hi = pt->count;
+
+	while(lo < hi) {
+		int mid = lo + (hi - lo)/2;
+		int mp = idx[mid]->pid;
+
+		if(mp == pid)
+			return mid;
+		if(mp < pid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return -1;
+}
+
+int ps_openat(struct pstab* pt, int pid, char* name)
+{
+	FMTBUF(p, e, pidstr, 20);
+	p = fmtint(p, e, pid);
+	FMTEND(p, e);
+
+	return open_file(pt, pidstr, name);
+}
+
+int ps_sample(struct pstab* pt, struct psent* ps, int statfd, int statmfd)
+{
+	FMTBUF(p, e, pidstr, 20);
+	p = fmtint(p, e, ps->pid);
+	FMTEND(p, e);
+
+	return read_stat(pt, ps, pidstr, statfd, statmfd);
+}
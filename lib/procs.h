@@ -0,0 +1,83 @@
+#include <bits/types.h>
+
+/* Process table snapshot, shared by pslist, pstree and pskill.
+
+   The caller picks the fields it needs, and only the files that carry
+   them get read: /proc/$pid/stat is enough for the name, state and ppid,
+   /proc/$pid/status is only read when uids or gids are requested, and
+   cmdline only with PS_CMDLINE. Files are opened relative to a single
+   /proc fd, so there are no per-process directory fds to open and close.
+
+   Records get packed into the caller's heap as they are read. The index
+   built by ps_index() is in pid order for tables filled by ps_scan(),
+   since that's the order /proc lists them in, and ps_find() relies on it
+   to look up the index of a given pid.
+
+   The filter, if set, gets called for each process once its stat or
+   status fields are known but before the cmdline gets read. Returning
+   non-zero drops the process.
+
+   PS_TIMES (utime+stime, in USER_HZ ticks) comes from stat as well,
+   and PS_RSS (resident pages) from statm. Tools that sample the same
+   processes over and over can keep stat and statm open with ps_openat()
+   and have ps_sample() re-read them with pread; the kernel regenerates
+   the contents on each read from offset 0. ps_sample() only fills the
+   fields found in stat and statm, never uids, gids or cmdline. */
+
+#define PS_NAME    (1<<0)
+#define PS_STATE   (1<<1)
+#define PS_PPID    (1<<2)
+#define PS_UIDS    (1<<3)
+#define PS_GIDS    (1<<4)
+#define PS_CMDLINE (1<<5)
+#define PS_TIMES   (1<<6)
+#define PS_RSS     (1<<7)
+
+#define PS_NAMEMAX 64
+
+struct heap;
+
+struct psent {
+	uint len;  /* of the whole record, incl. strings */
+	int pid;
+	int ppid;
+	int uid, euid;
+	int gid, egid;
+	uint64_t ticks;
+	long rss;
+	char state;
+	byte nlen;
+	uint clen;
+	char name[]; /* name, \0, then clen bytes of cmdline */
+};
+
+struct pstab {
+	int fd;
+	int fields;
+	struct heap* hp;
+	void* recs;
+	void* data;
+	int (*filter)(struct pstab* pt, struct psent* ps);
+
+	int count;
+	struct psent** idx;
+
+	char buf[1024];
+};
+
+int ps_open(struct pstab* pt, struct heap* hp, int fields);
+void ps_close(struct pstab* pt);
+
+int ps_load(struct pstab* pt, char* pidstr);
+int ps_scan(struct pstab* pt);
+
+void ps_index(struct pstab* pt);
+int ps_find(struct pstab* pt, int pid);
+
+int ps_openat(struct pstab* pt, int pid, char* name);
+int ps_sample(struct pstab* pt, struct psent* ps, int statfd, int statmfd);
+
+inline static char* ps_cmdline(struct psent* ps)
+{
+	return ps->name + ps->nlen + 1;
+}
@@ -7,6 +7,8 @@ int memxcmp(const void* av, const void* bv, size_t len);
 void memzero(void* a, size_t n);
 void* memmove(void* dst, const void* src, size_t n);
 int nonzero(void* a, size_t n);
+char* textfind(char* p, char* e, long min);
+char* textend(char* p, char* e);
 
 char* strcbrk(char* str, char c);
 char* strecbrk(char* p, char* e, char k);
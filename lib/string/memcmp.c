@@ -1,16 +1,39 @@
 #include <bits/types.h>
+#include <cdefs.h>
 #include <string.h>
+#include "word.h"
 
-int memcmp(const void* av, const void* bv, size_t len)
+/* Words are only used to skip over the matching prefix. The first
+   mismatching word gets re-scanned bytewise, which keeps the result
+   independent of the byte order. */
+
+__weak int memcmp(const void* av, const void* bv, size_t len)
 {
 	const uint8_t* a = (const uint8_t*) av;
 	const uint8_t* b = (const uint8_t*) bv;
 	int d;
 
+	if(len < 2*WS || (((ulong)a ^ (ulong)b) & WMASK))
+		goto tail;
+
+	for(; !aligned(a); len--)
+		if((d = (*a++ - *b++)))
+			return d;
+
+	const word* aw = (const word*)a;
+	const word* bw = (const word*)b;
+
+	for(; len >= WS && *aw == *bw; len -= WS) {
+		aw++;
+		bw++;
+	}
+
+	a = (const uint8_t*)aw;
+	b = (const uint8_t*)bw;
+tail:
 	while(len-- > 0)
 		if((d = (*a++ - *b++)))
 			return d;
 
 	return 0;
 }
-
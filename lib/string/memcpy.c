@@ -1,13 +1,35 @@
+#include <cdefs.h>
 #include <string.h>
+#include "word.h"
 
-/* memcpy() calls may be generated implicitly by gcc */
+/* memcpy() calls may be generated implicitly by gcc.
 
-void* memcpy(void* dst, const void* src, unsigned long n)
+   Whole words get copied whenever src and dst can be aligned at the same
+   time. Copying goes strictly forward, and memmove() relies on that. */
+
+__weak void* memcpy(void* dst, const void* src, unsigned long n)
 {
 	void* r = dst;
 	char* d = dst;
 	const char* s = src;
 
+	if(n < 2*WS || (((ulong)d ^ (ulong)s) & WMASK))
+		goto tail;
+
+	while(!aligned(d)) {
+		*(d++) = *(s++);
+		n--;
+	}
+
+	word* dw = (word*)d;
+	const word* sw = (const word*)s;
+
+	for(; n >= WS; n -= WS)
+		*(dw++) = *(sw++);
+
+	d = (char*)dw;
+	s = (const char*)sw;
+tail:
 	while(n--) *(d++) = *(s++);
 
 	return r;
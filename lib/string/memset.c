@@ -1,10 +1,28 @@
+#include <cdefs.h>
 #include <string.h>
+#include "word.h"
 
-void* memset(void* a, int c, unsigned long n)
+__weak void* memset(void* a, int c, unsigned long n)
 {
 	char* p = (char*) a;
 	char* e = p + n;
 
+	if(n < 2*WS)
+		goto tail;
+
+	word w = ONES * (byte)c;
+
+	while(!aligned(p))
+		*p++ = c;
+
+	word* q = (word*)p;
+	word* qe = (word*)((ulong)e & ~WMASK);
+
+	while(q < qe)
+		*q++ = w;
+
+	p = (char*)q;
+tail:
 	while(p < e) *p++ = c;
 
 	return a;
@@ -1,12 +1,29 @@
+#include <bits/types.h>
 #include <string.h>
+#include "word.h"
+
+/* Mostly used to spot all-zero blocks in disk images, so the inner loop
+   ORs several words together and only checks the result once per round. */
 
 int nonzero(void* a, unsigned long n)
 {
-	char* p = a;
-	char* e = a + n;
+	const uint8_t* p = a;
+
+	for(; n && !aligned(p); n--)
+		if(*p++) return 1;
+
+	const word* w = (const word*)p;
+
+	for(; n >= 4*WS; n -= 4*WS, w += 4)
+		if(w[0] | w[1] | w[2] | w[3])
+			return 1;
+	for(; n >= WS; n -= WS)
+		if(*w++) return 1;
+
+	p = (const uint8_t*)w;
 
-	for(; p < e; p++)
-		if(*p) return 1;
+	while(n-- > 0)
+		if(*p++) return 1;
 
 	return 0;
 }
@@ -1,12 +1,26 @@
 #include <cdefs.h>
 #include <string.h>
+#include "word.h"
 
-char* strchr(const char* str, int c)
+__weak char* strchr(const char* str, int c)
 {
 	const char* p = str;
+	char k = c;
 
-	for(p = str; *p; p++)
-		if(*p == c)
+	for(; !aligned(p); p++)
+		if(!*p)
+			return NULL;
+		else if(*p == k)
+			return (char*)p;
+
+	word m = ONES * (byte)k;
+	const word* w = (const word*)p;
+
+	while(!haszero(*w) && !haszero(*w ^ m))
+		w++;
+
+	for(p = (const char*)w; *p; p++)
+		if(*p == k)
 			return (char*)p;
 
 	return NULL;
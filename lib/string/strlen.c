@@ -1,10 +1,22 @@
+#include <cdefs.h>
 #include <string.h>
+#include "word.h"
 
-size_t strlen(const char* p)
+__weak size_t strlen(const char* str)
 {
-	size_t len = 0;
+	const char* p = str;
 
-	while(*p++) len++;
+	for(; !aligned(p); p++)
+		if(!*p) goto out;
 
-	return len;
+	const word* w = (const word*)p;
+
+	while(!haszero(*w))
+		w++;
+
+	p = (const char*)w;
+
+	while(*p) p++;
+out:
+	return p - str;
 }
@@ -0,0 +1,82 @@
+#include <bits/types.h>
+#include <string.h>
+#include "word.h"
+
+/* Runs of printable text, the way strings(1) sees them: 0x20 to 0x7E
+   plus tab. Long runs get scanned a word at a time, and only the word
+   where the run ends gets looked at bytewise. */
+
+#define ALL(c) (ONES * (c))
+
+inline static int printable(uint8_t c)
+{
+	return (c >= 0x20 && c < 0x7F) || c == '\t';
+}
+
+/* High bit set in each byte of the result that's printable in w.
+   None of the additions below carry into the next byte, since all
+   the high bits are cleared beforehand. */
+
+static word textmask(word w)
+{
+	word low = w & ~HIGHS;
+	word ge20 = low + ALL(0x60);
+	word ge7F = low + ALL(0x01);
+	word tab = low ^ ALL(0x09);
+
+	tab = ~((tab + ALL(0x7F)) | tab);
+
+	return ((ge20 & ~ge7F) | tab) & ~w & HIGHS;
+}
+
+char* textend(char* p, char* e)
+{
+	for(; p < e && !aligned(p); p++)
+		if(!printable(*p)) return p;
+
+	for(; p + WS <= e; p += WS)
+		if(textmask(*(word*)p) != HIGHS)
+			break;
+
+	for(; p < e; p++)
+		if(!printable(*p)) return p;
+
+	return e;
+}
+
+/* First run of at least min printable bytes, or the one reaching e
+   if shorter, since it may continue past e. Any run that long must
+   include the byte at p + min - 1, so if that one is not printable,
+   nothing before it needs to be looked at. Most of the input gets
+   skipped min bytes at a time this way. */
+
+char* textfind(char* p, char* e, long min)
+{
+	char *q, *s, *r;
+
+	while(e - p >= min) {
+		q = p + min - 1;
+
+		if(!printable(*q)) {
+			p = q + 1;
+			continue;
+		}
+
+		for(s = q; s > p; s--)
+			if(!printable(s[-1]))
+				break;
+
+		r = s + min < e ? s + min : e;
+
+		if((p = textend(q + 1, r)) >= r)
+			return s;
+
+		p++;
+	}
+
+	for(s = e; s > p; s--)
+		if(!printable(s[-1]))
+			break;
+
+	return s;
+}
@@ -0,0 +1,26 @@
+#include <bits/types.h>
+
+/* Word-at-a-time helpers for the string routines.
+
+   Aligned word loads never cross a page boundary, so reading a whole
+   word that contains the terminating zero is safe even if the rest
+   of it lies past the end of the string. Unaligned loads are avoided
+   altogether since some of the supported targets trap on them. */
+
+typedef ulong __attribute__((may_alias)) word;
+
+#define WS sizeof(word)
+#define WMASK (WS - 1)
+
+#define ONES ((word)-1 / 0xFF)
+#define HIGHS (ONES * 0x80)
+
+/* Non-zero iff some byte in w is zero. The exact value is only
+   meaningful for the lowest zero byte, which is all we need. */
+
+#define haszero(w) (((w) - ONES) & ~(w) & HIGHS)
+
+inline static int aligned(const void* p)
+{
+	return !((ulong)p & WMASK);
+}
@@ -0,0 +1,18 @@
+#include <syscall.h>
+#include <bits/time.h>
+
+#define FUTEX_WAIT            0
+#define FUTEX_WAKE            1
+#define FUTEX_PRIVATE_FLAG  128
+
+#define FUTEX_WAIT_PRIVATE  (FUTEX_WAIT | FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAKE_PRIVATE  (FUTEX_WAKE | FUTEX_PRIVATE_FLAG)
+
+/* The private variants are only good for futexes shared between threads
+   of the same process. Anything placed in MAP_SHARED memory and used by
+   several processes should go with plain FUTEX_WAIT/FUTEX_WAKE. */
+
+inline static long sys_futex(int* addr, int op, int val, struct timespec* ts)
+{
+	return syscall4(NR_futex, (long)addr, op, val, (long)ts);
+}
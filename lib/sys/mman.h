@@ -52,7 +52,25 @@ inline static void* sys_mremap(void* old, size_t oldsize, size_t newsize, int fl
 	return (void*)syscall4(NR_mremap, (long)old, oldsize, newsize, flags);
 }
 
+inline static long sys_mprotect(void* ptr, unsigned long len, int prot)
+{
+	return syscall3(NR_mprotect, (long)ptr, len, prot);
+}
+
 inline static long sys_munmap(void* ptr, unsigned long len)
 {
 	return syscall2(NR_munmap, (long)ptr, len);
 }
+
+inline static long sys_madvise(void* ptr, unsigned long len, int advice)
+{
+	return syscall3(NR_madvise, (long)ptr, len, advice);
+}
+
+#define MFD_CLOEXEC        (1<<0)
+#define MFD_ALLOW_SEALING  (1<<1)
+
+inline static long sys_memfd_create(const char* name, int flags)
+{
+	return syscall2(NR_memfd_create, (long)name, flags);
+}
@@ -13,6 +13,15 @@
 #define WIFSTOPPED(status)	(((status) & 0xFF) == 0x7F)
 #define WIFCONTINUED(status)	((status) == 0xFFFF)
 
+#define CLONE_VM              0x00000100
+#define CLONE_FS              0x00000200
+#define CLONE_FILES           0x00000400
+#define CLONE_SIGHAND         0x00000800
+#define CLONE_PARENT_SETTID   0x00100000
+#define CLONE_THREAD          0x00010000
+#define CLONE_SYSVSEM         0x00040000
+#define CLONE_CHILD_CLEARTID  0x00200000
+
 inline static long sys_fork(void)
 {
 	return syscall5(NR_clone, SIGCHLD, 0, 0, 0, 0);
@@ -27,3 +36,10 @@ inline static long sys_waitpid(int pid, int* status, int flags)
 {
 	return syscall4(NR_wait4, pid, (long)status, flags, 0);
 }
+
+/* Unlike _exit, which only ends the calling thread. */
+
+inline static long sys_exit_group(int code)
+{
+	return syscall1(NR_exit_group, code);
+}
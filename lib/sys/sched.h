@@ -17,6 +17,11 @@ inline static long sys_pause(void)
 	return syscall4(NR_ppoll, 0, 0, 0, 0);
 }
 
+inline static long sys_sched_yield(void)
+{
+	return syscall0(NR_sched_yield);
+}
+
 inline static long sys_nanosleep(struct timespec* req, struct timespec* rem)
 {
 	return syscall2(NR_nanosleep, (long)req, (long)rem);
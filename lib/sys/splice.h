@@ -19,6 +19,13 @@ inline static long sys_tee(int fdin, int fdout, size_t len, unsigned flags)
 	return syscall4(NR_tee, fdin, fdout, len, flags);
 }
 
+inline static long sys_copy_file_range(int ifd, uint64_t* offin, int ofd,
+                                       uint64_t* offout, size_t len, unsigned flags)
+{
+	return syscall6(NR_copy_file_range, ifd, (long)offin, ofd, (long)offout,
+                                                                   len, flags);
+}
+
 inline static long sys_sendfile(int ofd, int ifd, uint64_t* offset, size_t count)
 {
 	return syscall4(NR_sendfile, ofd, ifd, (long)offset, count);
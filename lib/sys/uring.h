@@ -0,0 +1,100 @@
+#include <syscall.h>
+#include <bits/types.h>
+
+/* Raw io_uring interface. See lib/uring.h for the ring handling code. */
+
+struct io_uring_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t ioprio;
+	int32_t fd;
+	uint64_t off;
+	uint64_t addr;
+	uint32_t len;
+	uint32_t opflags;     /* rw_flags, open_flags, statx_flags etc */
+	uint64_t user_data;
+	uint16_t buf_index;
+	uint16_t personality;
+	int32_t splice_fd_in;
+	uint64_t pad[2];
+};
+
+struct io_uring_cqe {
+	uint64_t user_data;
+	int32_t res;
+	uint32_t flags;
+};
+
+struct io_sqring_offsets {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t ring_mask;
+	uint32_t ring_entries;
+	uint32_t flags;
+	uint32_t dropped;
+	uint32_t array;
+	uint32_t resv1;
+	uint64_t resv2;
+};
+
+struct io_cqring_offsets {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t ring_mask;
+	uint32_t ring_entries;
+	uint32_t overflow;
+	uint32_t cqes;
+	uint32_t flags;
+	uint32_t resv1;
+	uint64_t resv2;
+};
+
+struct io_uring_params {
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+	uint32_t sq_thread_cpu;
+	uint32_t sq_thread_idle;
+	uint32_t features;
+	uint32_t wq_fd;
+	uint32_t resv[3];
+	struct io_sqring_offsets sq_off;
+	struct io_cqring_offsets cq_off;
+};
+
+#define IORING_OFF_SQ_RING    0x00000000ULL
+#define IORING_OFF_CQ_RING    0x08000000ULL
+#define IORING_OFF_SQES       0x10000000ULL
+
+#define IORING_FEAT_SINGLE_MMAP    (1<<0)
+#define IORING_FEAT_NODROP         (1<<1)
+#define IORING_FEAT_SUBMIT_STABLE  (1<<2)
+#define IORING_FEAT_RW_CUR_POS     (1<<3)
+
+#define IORING_ENTER_GETEVENTS  (1<<0)
+
+#define IOSQE_FIXED_FILE   (1<<0)
+#define IOSQE_IO_DRAIN     (1<<1)
+#define IOSQE_IO_LINK      (1<<2)
+#define IOSQE_IO_HARDLINK  (1<<3)
+
+#define IORING_OP_NOP          0
+#define IORING_OP_READV        1
+#define IORING_OP_WRITEV       2
+#define IORING_OP_FSYNC        3
+#define IORING_OP_OPENAT      18
+#define IORING_OP_CLOSE       19
+#define IORING_OP_STATX       21
+#define IORING_OP_READ        22
+#define IORING_OP_WRITE       23
+
+inline static long sys_io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+	return syscall2(NR_io_uring_setup, entries, (long)p);
+}
+
+inline static long sys_io_uring_enter(int fd, unsigned submit, unsigned wait,
+                                      unsigned flags)
+{
+	return syscall6(NR_io_uring_enter, fd, submit, wait, flags, 0, 0);
+}
@@ -0,0 +1,88 @@
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#include <bits/types.h>
+#include <cdefs.h>
+
+/* Bare-bones threads on top of raw clone(). No TLS, no errno, nothing
+   per-thread beyond the stack. All threads share the address space,
+   file descriptors and the heap pointers, so brk-based allocation must
+   be done before spawning or from a single thread only.
+
+   fail() and _exit() only end the calling thread, so workers must not
+   use them. Errors should either be passed back in memory and reported
+   by the main thread once the workers have been joined, or, if there's
+   no point in going on, reported with thread_fail(). That one and
+   thread_quit() end the whole process no matter which thread calls them.
+
+   thread_spawn() starts a thread that does not keep the process around.
+   If the main thread exits while it's still running, say blocked in some
+   uninterruptible syscall, the spawned thread just continues on its own.
+   It gets its own pid and its own copy of the fd table, and signals sent
+   to the process do not reach it. Fds opened or closed in the spawned
+   thread do not affect the rest of the process, and vice versa. */
+
+/* Stacks get mapped lazily, so only the pages actually used cost
+   memory. The size is meant to fit a recursion one level deep for each
+   byte of a PATH_MAX-long path at around 100 bytes per frame, with room
+   for a few page-sized buffers on top. */
+
+#define THREAD_STACK (512*1024)
+
+struct thread {
+	int tid;
+	void* stack;
+};
+
+int thread_start(struct thread* th, int (*fn)(void*), void* arg);
+int thread_spawn(struct thread* th, int (*fn)(void*), void* arg);
+int thread_join(struct thread* th);
+int thread_cpus(void);
+
+void thread_quit(int code) noreturn;
+void thread_fail(const char* msg, const char* obj, int err) noreturn;
+
+/* Futex-based mutex: 0 unlocked, 1 locked, 2 locked with waiters.
+   Zero-initialized struct is an unlocked mutex. */
+
+struct mutex {
+	int state;
+};
+
+void mutex_lock(struct mutex* mx);
+int mutex_trylock(struct mutex* mx);
+void mutex_unlock(struct mutex* mx);
+
+/* Condition variable as a sequence counter. Spurious wakeups are
+   possible, callers should re-check their condition in a loop. */
+
+struct condvar {
+	int seq;
+};
+
+void cond_wait(struct condvar* cv, struct mutex* mx);
+void cond_signal(struct condvar* cv);
+void cond_broadcast(struct condvar* cv);
+
+/* Bounded lock-free multi-producer multi-consumer queue of pointers,
+   with a sequence number in each slot. The caller supplies the slots,
+   their number must be a power of two. Both push and pop return -EAGAIN
+   instead of blocking when the queue is full or empty respectively. */
+
+struct qslot {
+	uint seq;
+	void* ptr;
+};
+
+struct queue {
+	uint head;
+	uint tail;
+	uint mask;
+	struct qslot* slots;
+};
+
+int queue_init(struct queue* q, struct qslot* slots, uint count);
+int queue_push(struct queue* q, void* ptr);
+int queue_pop(struct queue* q, void** ptr);
+
+#endif
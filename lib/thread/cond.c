@@ -0,0 +1,35 @@
+#include <sys/futex.h>
+#include <thread.h>
+
+/* Waiters sleep on the sequence value they saw before releasing
+   the mutex. Any signal bumps the sequence, so a wakeup that happens
+   between mutex_unlock and FUTEX_WAIT is not lost, the wait just
+   fails with EAGAIN. The mutex is re-acquired in the contended state
+   since there may be other threads woken by the same broadcast. */
+
+void cond_wait(struct condvar* cv, struct mutex* mx)
+{
+	int seq = __atomic_load_n(&cv->seq, __ATOMIC_RELAXED);
+	int* ptr = &mx->state;
+
+	mutex_unlock(mx);
+
+	sys_futex(&cv->seq, FUTEX_WAIT_PRIVATE, seq, NULL);
+
+	while(__atomic_exchange_n(ptr, 2, __ATOMIC_ACQUIRE))
+		sys_futex(ptr, FUTEX_WAIT_PRIVATE, 2, NULL);
+}
+
+void cond_signal(struct condvar* cv)
+{
+	__atomic_fetch_add(&cv->seq, 1, __ATOMIC_RELEASE);
+
+	sys_futex(&cv->seq, FUTEX_WAKE_PRIVATE, 1, NULL);
+}
+
+void cond_broadcast(struct condvar* cv)
+{
+	__atomic_fetch_add(&cv->seq, 1, __ATOMIC_RELEASE);
+
+	sys_futex(&cv->seq, FUTEX_WAKE_PRIVATE, 0x7FFFFFFF, NULL);
+}
@@ -0,0 +1,47 @@
+#include <sys/futex.h>
+#include <thread.h>
+
+/* The classic three-state futex mutex. Uncontended lock and unlock
+   are a single atomic op each, the syscalls only happen when some
+   thread actually has to wait. */
+
+static int cas(int* ptr, int old, int new)
+{
+	__atomic_compare_exchange_n(ptr, &old, new, 0,
+		__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+
+	return old;
+}
+
+int mutex_trylock(struct mutex* mx)
+{
+	return cas(&mx->state, 0, 1) ? -EBUSY : 0;
+}
+
+void mutex_lock(struct mutex* mx)
+{
+	int* ptr = &mx->state;
+	int c;
+
+	if(!(c = cas(ptr, 0, 1)))
+		return;
+
+	if(c != 2)
+		c = __atomic_exchange_n(ptr, 2, __ATOMIC_ACQUIRE);
+
+	while(c) {
+		sys_futex(ptr, FUTEX_WAIT_PRIVATE, 2, NULL);
+		c = __atomic_exchange_n(ptr, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+void mutex_unlock(struct mutex* mx)
+{
+	int* ptr = &mx->state;
+
+	if(__atomic_fetch_sub(ptr, 1, __ATOMIC_RELEASE) == 1)
+		return;
+
+	__atomic_store_n(ptr, 0, __ATOMIC_RELEASE);
+	sys_futex(ptr, FUTEX_WAKE_PRIVATE, 1, NULL);
+}
@@ -0,0 +1,83 @@
+#include <bits/errno.h>
+#include <thread.h>
+
+/* Bounded MPMC queue after D. Vyukov. Each slot carries a sequence
+   number telling which lap of the ring it is ready for: pos for a push,
+   pos + 1 for a pop. Producers and consumers claim positions by moving
+   tail and head with CAS, then hand the slot over by publishing the next
+   sequence value. No locks, and no ABA issues as long as the 32-bit
+   counters do not lap around while some thread is stalled mid-op. */
+
+int queue_init(struct queue* q, struct qslot* slots, uint count)
+{
+	uint i;
+
+	if(!count || (count & (count - 1)))
+		return -EINVAL;
+
+	for(i = 0; i < count; i++) {
+		slots[i].seq = i;
+		slots[i].ptr = NULL;
+	}
+
+	q->head = 0;
+	q->tail = 0;
+	q->mask = count - 1;
+	q->slots = slots;
+
+	return 0;
+}
+
+int queue_push(struct queue* q, void* ptr)
+{
+	uint pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	struct qslot* slot;
+
+	while(1) {
+		slot = &q->slots[pos & q->mask];
+
+		uint seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		int dif = (int)(seq - pos);
+
+		if(dif < 0)
+			return -EAGAIN;
+		if(dif > 0)
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		else if(__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+
+	slot->ptr = ptr;
+
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int queue_pop(struct queue* q, void** ptr)
+{
+	uint pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	struct qslot* slot;
+
+	while(1) {
+		slot = &q->slots[pos & q->mask];
+
+		uint seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		int dif = (int)(seq - (pos + 1));
+
+		if(dif < 0)
+			return -EAGAIN;
+		if(dif > 0)
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		else if(__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+
+	*ptr = slot->ptr;
+
+	__atomic_store_n(&slot->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
@@ -0,0 +1,24 @@
+#include <sys/sched.h>
+#include <string.h>
+#include <thread.h>
+
+/* Number of CPUs this process may run on, which is what matters when
+   picking the number of worker threads. Falls back to 1 on errors. */
+
+int thread_cpus(void)
+{
+	struct cpuset cs;
+	uint w, b, cpus = 0;
+
+	memzero(&cs, sizeof(cs));
+
+	if(sys_sched_getaffinity(0, &cs) < 0)
+		return 1;
+
+	for(w = 0; w < ARRAY_SIZE(cs.bits); w++)
+		for(b = 0; b < 8*sizeof(cs.bits[0]); b++)
+			if(cs.bits[w] & (1UL << b))
+				cpus++;
+
+	return cpus ? cpus : 1;
+}
@@ -0,0 +1,8 @@
+#include <thread.h>
+#include <util.h>
+
+void thread_fail(const char* msg, const char* obj, int err)
+{
+	warn(msg, obj, err);
+	thread_quit(0xFF);
+}
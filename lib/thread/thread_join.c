@@ -0,0 +1,27 @@
+#include <sys/futex.h>
+#include <sys/mman.h>
+#include <thread.h>
+
+/* The kernel wakes CLEARTID waiters with a non-private futex wake,
+   so the wait here must not use FUTEX_PRIVATE_FLAG. */
+
+int thread_join(struct thread* th)
+{
+	int tid;
+	long ret;
+
+	if(!th->stack)
+		return -EINVAL;
+
+	while((tid = __atomic_load_n(&th->tid, __ATOMIC_ACQUIRE))) {
+		ret = sys_futex(&th->tid, FUTEX_WAIT, tid, NULL);
+
+		if(ret < 0 && ret != -EAGAIN && ret != -EINTR)
+			return ret;
+	}
+
+	sys_munmap(th->stack, THREAD_STACK);
+	th->stack = NULL;
+
+	return 0;
+}
@@ -0,0 +1,9 @@
+#include <sys/proc.h>
+#include <thread.h>
+#include <util.h>
+
+void thread_quit(int code)
+{
+	sys_exit_group(code);
+	_exit(code); /* not reached */
+}
@@ -0,0 +1,66 @@
+#include <sys/mman.h>
+#include <sys/proc.h>
+#include <thread.h>
+
+long thread_clone(long flags, void* stack, int* ptid, int* ctid,
+                  int (*fn)(void*), void* arg);
+
+/* CLONE_PARENT_SETTID makes sure th->tid is set before the child gets
+   a chance to run and exit, and CLONE_CHILD_CLEARTID has the kernel zero
+   it and wake any futex waiters once the child is gone. The lowest page
+   of the stack is left inaccessible to catch overflows. */
+
+static int start(struct thread* th, int cflags, int (*fn)(void*), void* arg)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	long size = THREAD_STACK;
+	void* stack;
+	long ret;
+
+	stack = sys_mmap(NULL, size, prot, flags, -1, 0);
+
+	if((ret = mmap_error(stack)))
+		return ret;
+
+	(void)sys_mprotect(stack, PAGE, PROT_NONE);
+
+	th->tid = 0;
+	th->stack = stack;
+
+	ret = thread_clone(cflags, stack + size, &th->tid, &th->tid, fn, arg);
+
+	if(ret < 0) {
+		sys_munmap(stack, size);
+		th->stack = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+int thread_start(struct thread* th, int (*fn)(void*), void* arg)
+{
+	int cflags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND
+	           | CLONE_THREAD | CLONE_SYSVSEM
+	           | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID;
+
+	return start(th, cflags, fn, arg);
+}
+
+/* Without CLONE_THREAD, the child is a process of its own that happens
+   to share the address space. The fd table gets copied rather than shared,
+   so a child that outlives the parent does not keep the parent's pipes
+   open for whoever reads them. Exit signal is 0, so the parent
+   does not get SIGCHLD. thread_join() works the same way as for regular
+   threads, but the finished child stays a zombie until the parent exits,
+   so this is only good for short-lived tools. Should the parent exit first,
+   the child gets re-parented and reaped by init like any other orphan. */
+
+int thread_spawn(struct thread* th, int (*fn)(void*), void* arg)
+{
+	int cflags = CLONE_VM | CLONE_FS | CLONE_SYSVSEM
+	           | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID;
+
+	return start(th, cflags, fn, arg);
+}
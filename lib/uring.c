@@ -0,0 +1,173 @@
+#include <sys/file.h>
+#include <sys/mman.h>
+
+#include <string.h>
+#include <uring.h>
+#include <util.h>
+
+/* Ring setup follows the layout described in io_uring_setup(2). With
+   IORING_FEAT_SINGLE_MMAP, the SQ and CQ rings share a single mapping.
+   RW_CUR_POS came with the same kernel (5.6) as the file opcodes, so
+   it's a cheap way to check they are available without probing. */
+
+static void* map_ring(int fd, long len, uint64_t off)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_SHARED;
+
+	return sys_mmap(NULL, len, prot, flags, fd, off);
+}
+
+static int map_rings(struct uring* ur, struct io_uring_params* p)
+{
+	int fd = ur->fd;
+	long sqlen = p->sq_off.array + p->sq_entries*sizeof(uint);
+	long cqlen = p->cq_off.cqes + p->cq_entries*sizeof(struct io_uring_cqe);
+	long sqeslen = p->sq_entries*sizeof(struct io_uring_sqe);
+	void *sq, *cq, *sqes;
+	int ret;
+
+	if(p->features & IORING_FEAT_SINGLE_MMAP) {
+		if(cqlen > sqlen)
+			sqlen = cqlen;
+		cqlen = 0;
+	}
+
+	sq = map_ring(fd, sqlen, IORING_OFF_SQ_RING);
+
+	if((ret = mmap_error(sq)))
+		return ret;
+
+	ur->sqmap = sq;
+	ur->sqlen = sqlen;
+
+	if(!cqlen)
+		cq = sq;
+	else if((ret = mmap_error(cq = map_ring(fd, cqlen, IORING_OFF_CQ_RING))))
+		return ret;
+
+	ur->cqmap = cq;
+	ur->cqlen = cqlen;
+
+	sqes = map_ring(fd, sqeslen, IORING_OFF_SQES);
+
+	if((ret = mmap_error(sqes)))
+		return ret;
+
+	ur->sqes = sqes;
+	ur->sqeslen = sqeslen;
+
+	ur->sqhead = sq + p->sq_off.head;
+	ur->sqtail = sq + p->sq_off.tail;
+	ur->sqmask = *(uint*)(sq + p->sq_off.ring_mask);
+	ur->sqsize = p->sq_entries;
+	ur->sqarray = sq + p->sq_off.array;
+
+	ur->cqhead = cq + p->cq_off.head;
+	ur->cqtail = cq + p->cq_off.tail;
+	ur->cqmask = *(uint*)(cq + p->cq_off.ring_mask);
+	ur->cqes = cq + p->cq_off.cqes;
+
+	return 0;
+}
+
+int uring_init(struct uring* ur, uint entries)
+{
+	struct io_uring_params params;
+	int fd, ret;
+
+	memzero(ur, sizeof(*ur));
+	memzero(&params, sizeof(params));
+
+	if((fd = sys_io_uring_setup(entries, &params)) < 0)
+		return fd;
+
+	ur->fd = fd;
+
+	if(!(params.features & IORING_FEAT_RW_CUR_POS))
+		ret = -ENOSYS;
+	else if((ret = map_rings(ur, &params)) >= 0)
+		return 0;
+
+	uring_fini(ur);
+
+	return ret;
+}
+
+void uring_fini(struct uring* ur)
+{
+	if(ur->sqes)
+		sys_munmap(ur->sqes, ur->sqeslen);
+	if(ur->cqmap && ur->cqmap != ur->sqmap)
+		sys_munmap(ur->cqmap, ur->cqlen);
+	if(ur->sqmap)
+		sys_munmap(ur->sqmap, ur->sqlen);
+	if(ur->fd > 0)
+		sys_close(ur->fd);
+
+	memzero(ur, sizeof(*ur));
+}
+
+/* Returns a zeroed entry, or NULL if the SQ ring is full. The entry
+   becomes visible to the kernel right away, but only gets picked up
+   on the next uring_enter(). */
+
+struct io_uring_sqe* uring_sqe(struct uring* ur)
+{
+	uint head = __atomic_load_n(ur->sqhead, __ATOMIC_ACQUIRE);
+	uint tail = *ur->sqtail;
+	uint idx = tail & ur->sqmask;
+	struct io_uring_sqe* sqe = &ur->sqes[idx];
+
+	if(tail - head >= ur->sqsize)
+		return NULL;
+
+	memzero(sqe, sizeof(*sqe));
+	ur->sqarray[idx] = idx;
+
+	__atomic_store_n(ur->sqtail, tail + 1, __ATOMIC_RELEASE);
+
+	ur->pending++;
+
+	return sqe;
+}
+
+/* Submit whatever has been queued, and wait for at least the given
+   number of completions. EINTR is not an error here, the caller will
+   simply find fewer completions than it asked for. */
+
+int uring_enter(struct uring* ur, uint wait)
+{
+	uint flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	long ret;
+
+	if(!ur->pending && !wait)
+		return 0;
+
+	ret = sys_io_uring_enter(ur->fd, ur->pending, wait, flags);
+
+	if(ret == -EINTR)
+		return 0;
+	if(ret < 0)
+		return ret;
+
+	ur->pending -= ret;
+
+	return ret;
+}
+
+struct io_uring_cqe* uring_cqe(struct uring* ur)
+{
+	uint head = *ur->cqhead;
+	uint tail = __atomic_load_n(ur->cqtail, __ATOMIC_ACQUIRE);
+
+	if(head == tail)
+		return NULL;
+
+	return &ur->cqes[head & ur->cqmask];
+}
+
+void uring_seen(struct uring* ur)
+{
+	__atomic_store_n(ur->cqhead, *ur->cqhead + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,46 @@
+#include <bits/types.h>
+#include <sys/uring.h>
+
+/* Minimal io_uring ring handling, no SQPOLL and no registered buffers.
+   Submissions get queued with uring_sqe() and handed to the kernel with
+   uring_enter(), which may also wait for some completions. Completions
+   are looked at with uring_cqe() and released with uring_seen().
+
+   The caller is responsible for not having more requests in flight
+   than the CQ ring can hold, which is twice the SQ size.
+
+   uring_init() fails with -ENOSYS on kernels that lack io_uring or the
+   opcodes added in 5.6 (OPENAT, CLOSE, STATX, READ, WRITE), so callers
+   can fall back to plain syscalls on any error from it. */
+
+struct uring {
+	int fd;
+	uint pending;
+
+	uint* sqhead;
+	uint* sqtail;
+	uint sqmask;
+	uint sqsize;
+	uint* sqarray;
+	struct io_uring_sqe* sqes;
+
+	uint* cqhead;
+	uint* cqtail;
+	uint cqmask;
+	struct io_uring_cqe* cqes;
+
+	void* sqmap;
+	long sqlen;
+	void* cqmap;
+	long cqlen;
+	long sqeslen;
+};
+
+int uring_init(struct uring* ur, uint entries);
+void uring_fini(struct uring* ur);
+
+struct io_uring_sqe* uring_sqe(struct uring* ur);
+int uring_enter(struct uring* ur, uint wait);
+
+struct io_uring_cqe* uring_cqe(struct uring* ur);
+void uring_seen(struct uring* ur);
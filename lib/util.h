@@ -13,6 +13,7 @@ typedef int (*qcmp3)(void* a, void* b, long opts);
 
 void qsortp(void* ptrs, size_t n, qcmp2 cmp);
 void qsortx(void* ptrs, size_t n, qcmp3 cmp, long opts);
+void qsorts(void* ptrs, size_t n, int off);
 
 long writeall(int fd, void* buf, long len);
 
@@ -11,6 +11,10 @@
    So this basically calls for careful 3-way partitioning
    and some special cases with shorter handling.
 
+   Large directories (100k+ entries) are also expected, so recursion
+   depth must stay bounded and the worst case must not go quadratic.
+   See srec() below.
+
    The code below is loosely based on qsort from dietlibc, which in turn
    pulls from http://www.cs.princeton.edu/~rs/talks/QuicksortIsOptimal.pdf
    It's not a faithful implementation though, if it's wrong it's probably
@@ -24,22 +28,57 @@ static inline void exch(void** a, void** b)
 	*b = t;
 }
 
-static void** pick_pivot(void** S, void** E)
+/* Ranges this short get sorted by binary insertion. With expensive cmp,
+   that's fewer calls than partitioning them further, and pointer moves
+   are cheap. */
+
+#define SHORT 12
+
+/* Median of three, to avoid worst-case partitioning on already sorted
+   or reverse sorted input which is common for directory listings.
+   Longer ranges get Tukey's ninther, median of three medians. */
+
+static void** med3(void** a, void** b, void** c, qcmp3 cmp, long opts)
 {
-	return S + (E - S)/2;
+	if(cmp(*a, *b, opts) < 0) {
+		if(cmp(*b, *c, opts) < 0)
+			return b;
+		return cmp(*a, *c, opts) < 0 ? c : a;
+	} else {
+		if(cmp(*a, *c, opts) < 0)
+			return a;
+		return cmp(*b, *c, opts) < 0 ? c : b;
+	}
+}
+
+static void** pick_pivot(void** S, void** E, qcmp3 cmp, long opts)
+{
+	size_t n = E - S;
+	void** a = S;
+	void** b = S + n/2;
+	void** c = E - 1;
+
+	if(n > 40) {
+		size_t d = n/8;
+
+		a = med3(a, a + d, a + 2*d, cmp, opts);
+		b = med3(b - d, b, b + d, cmp, opts);
+		c = med3(c - 2*d, c - d, c, cmp, opts);
+	}
+
+	return med3(a, b, c, cmp, opts);
 }
 
 /* Bentley-McIlroy 3-way partitioning:
 
           eq eq lt lt ?? ?? ?? gt gt eq eq.
 
-   Equal element are then swapped to the center. */
-
-static void srec(void** S, void** E, qcmp3 cmp, long opts);
+   Equal element are then swapped to the center. On return, *L is
+   the end of the lt part and *R is the start of the gt part. */
 
-static void sort(void** S, void** E, qcmp3 cmp, long opts)
+static void partition(void** S, void** E, void*** L, void*** R, qcmp3 cmp, long opts)
 {
-	void** pv = pick_pivot(S, E);
+	void** pv = pick_pivot(S, E, cmp, opts);
 
 	void** le = S;
 	void** re = E - 1;
@@ -98,49 +137,103 @@ static void sort(void** S, void** E, qcmp3 cmp, long opts)
 	/* lt lt lt lt eq eq eq eq eq eq gt gt gt gt gt */
 	/*          le                   rp re       rr */
 
-	if(lp > ll)
-		srec(ll, lp + 1, cmp, opts);
-	if(rp < rr)
-		srec(rp, rr + 1, cmp, opts);
+	*L = lp + 1;
+	*R = rp;
 }
 
-/* Special handling for low-n cases */
+/* Binary insertion sort for short ranges. Equal elements keep their
+   relative order. */
 
-static void sort2(void** S, qcmp3 cmp, long opts)
+static void insertion(void** S, void** E, qcmp3 cmp, long opts)
 {
-	void** a0 = S + 0;
-	void** a1 = S + 1;
+	for(void** p = S + 1; p < E; p++) {
+		void* x = *p;
+		void** lo = S;
+		void** hi = p;
+
+		while(lo < hi) {
+			void** mid = lo + (hi - lo)/2;
+
+			if(cmp(x, *mid, opts) < 0)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+
+		for(void** q = p; q > lo; q--)
+			*q = *(q - 1);
 
-	if(cmp(*a0, *a1, opts) > 0)
-		exch(a0, a1);
+		*lo = x;
+	}
 }
 
-static void sort3(void** S, qcmp3 cmp, long opts)
+/* Heapsort fallback for when partitioning goes bad, which keeps
+   the worst case at O(n log n) comparisons. */
+
+static void sift_down(void** S, size_t i, size_t n, qcmp3 cmp, long opts)
 {
-	void** a0 = S + 0;
-	void** a1 = S + 1;
-	void** a2 = S + 2;
-
-	if(cmp(*a0, *a1, opts) > 0)
-		exch(a0, a1);
-	if(cmp(*a1, *a2, opts) > 0)
-		exch(a1, a2);
-	if(cmp(*a0, *a1, opts) > 0)
-		exch(a0, a1);
+	size_t c;
+
+	while((c = 2*i + 1) < n) {
+		if(c + 1 < n && cmp(S[c], S[c+1], opts) < 0)
+			c++;
+		if(cmp(S[i], S[c], opts) >= 0)
+			break;
+
+		exch(&S[i], &S[c]);
+		i = c;
+	}
+}
+
+static void heapsort(void** S, void** E, qcmp3 cmp, long opts)
+{
+	size_t n = E - S;
+	size_t i;
+
+	for(i = n/2; i > 0; i--)
+		sift_down(S, i - 1, n, cmp, opts);
+
+	for(i = n - 1; i > 0; i--) {
+		exch(&S[0], &S[i]);
+		sift_down(S, 0, i, cmp, opts);
+	}
+}
+
+/* Introsort. The smaller part gets sorted recursively and the loop
+   continues with the larger one, so the stack depth is O(log n) even
+   if the depth limit never kicks in. */
+
+static void srec(void** S, void** E, qcmp3 cmp, long opts, int depth)
+{
+	void** L;
+	void** R;
+
+	while(E - S > SHORT) {
+		if(depth-- <= 0)
+			return heapsort(S, E, cmp, opts);
+
+		partition(S, E, &L, &R, cmp, opts);
+
+		if(L - S < E - R) {
+			srec(S, L, cmp, opts, depth);
+			S = R;
+		} else {
+			srec(R, E, cmp, opts, depth);
+			E = L;
+		}
+	}
+
+	insertion(S, E, cmp, opts);
 }
 
-static void srec(void** S, void** E, qcmp3 cmp, long opts)
+static int depth_limit(size_t n)
 {
-	size_t len = E - S;
+	int depth = 0;
 
-	if(len <= 1)
-		return;
-	if(len == 2)
-		return sort2(S, cmp, opts);
-	if(len == 3)
-		return sort3(S, cmp, opts);
+	for(; n > 1; n >>= 1)
+		depth += 2;
 
-	return sort(S, E, cmp, opts);
+	return depth;
 }
 
 void qsortx(void* ptrs, size_t n, qcmp3 cmp, long opts)
@@ -148,7 +241,7 @@ void qsortx(void* ptrs, size_t n, qcmp3 cmp, long opts)
 	void** S = ptrs;
 	void** E = S + n;
 
-	srec(S, E, cmp, opts);
+	srec(S, E, cmp, opts, depth_limit(n));
 }
 
 static int cmp2to3(void* a, void* b, long arg)
@@ -0,0 +1,112 @@
+#include <bits/types.h>
+#include <string.h>
+#include <util.h>
+
+/* Specialized sort for the most common case in minibase, sorting
+   directory entries by name. The elements are pointers to structures
+   with a 0-terminated string at a fixed offset, and the order is that
+   of strcmp. Knowing the keys, we can do MSD radix sort instead of
+   comparing whole names over and over again.
+
+   Buckets are distributed in place (American flag sort), and short
+   ranges are left to insertion sort with strcmp starting at the current
+   depth, since by then the prefixes are known to match. */
+
+#define SHORT 16
+
+static inline int key(void* p, int off)
+{
+	return ((byte*)p)[off];
+}
+
+static void insertion(void** S, void** E, int off)
+{
+	for(void** p = S + 1; p < E; p++) {
+		void* x = *p;
+		void** lo = S;
+		void** hi = p;
+
+		while(lo < hi) {
+			void** mid = lo + (hi - lo)/2;
+
+			if(strcmp(x + off, *mid + off) < 0)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+
+		for(void** q = p; q > lo; q--)
+			*q = *(q - 1);
+
+		*lo = x;
+	}
+}
+
+/* The bucket tables only live through this call, so that the stack
+   use of msd() below does not grow with them at each level. This only
+   works as long as the call does not get inlined. */
+
+static noinline void distribute(void** S, void** E, int off)
+{
+	void** next[256];
+	void** end[256];
+	size_t count[256];
+	void** p;
+	int c, k;
+
+	memzero(count, sizeof(count));
+
+	for(p = S; p < E; p++)
+		count[key(*p, off)]++;
+
+	for(p = S, c = 0; c < 256; c++) {
+		next[c] = p;
+		p += count[c];
+		end[c] = p;
+	}
+
+	for(c = 0; c < 256; c++) {
+		while(next[c] < end[c]) {
+			void* x = *next[c];
+
+			while((k = key(x, off)) != c) {
+				void* t = *next[k];
+				*next[k]++ = x;
+				x = t;
+			}
+
+			*next[c]++ = x;
+		}
+	}
+}
+
+static void msd(void** S, void** E, int off)
+{
+	void** p;
+	void** q;
+	int c;
+
+	if(E - S <= SHORT)
+		return insertion(S, E, off);
+
+	distribute(S, E, off);
+
+	for(p = S; p < E; p = q) {
+		c = key(*p, off);
+
+		for(q = p + 1; q < E; q++)
+			if(key(*q, off) != c)
+				break;
+
+		if(c && q - p > 1) /* c == 0 means the strings have ended */
+			msd(p, q, off + 1);
+	}
+}
+
+void qsorts(void* ptrs, size_t n, int off)
+{
+	void** S = ptrs;
+	void** E = S + n;
+
+	msd(S, E, off);
+}
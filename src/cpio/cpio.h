@@ -3,6 +3,7 @@
 #define MAXDEPTH 15
 
 struct bufout;
+struct lzip;
 
 struct header {
 	char magic[6];
@@ -28,6 +29,7 @@ struct top {
 	char** argv;
 
 	int fd;      /* the .cpio file being worked on */
+	struct lzip* lzip; /* non-NULL when writing .cpio.lz */
 
 	void* brk;   /* heap pointers */
 	void* ptr;
@@ -89,4 +91,5 @@ void put_pref(CTX);
 void put_file(CTX, char* path, char* name, uint size, int mode);
 void put_link(CTX, char* path, char* name, uint size);
 void put_trailer(CTX);
+void finish_cpio_file(CTX);
 void put_immlink(CTX, char* name, int nlen, char* target, int size);
@@ -6,6 +6,8 @@
 #include <format.h>
 #include <printf.h>
 #include <string.h>
+#include <lzma.h>
+#include <lzip.h>
 #include <util.h>
 
 #include "cpio.h"
@@ -96,18 +98,66 @@ void open_cpio_file(CTX, char* name)
 	ctx->fd = fd;
 }
 
+/* Compressed output goes through lzip_write, which needs a sizable
+   workspace. The struct lzip itself is placed at the start of the same
+   mmaped area since the heap may not be set up yet at this point. */
+
+static int compressed_name(char* name)
+{
+	int nlen = strlen(name);
+
+	if(nlen <= 8)
+		return 0;
+
+	return !strcmp(name + nlen - 8, ".cpio.lz");
+}
+
+static void start_compression(CTX)
+{
+	int level = 6;
+	long size = sizeof(struct lzip) + LZIP_SIZE(level);
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void* buf = sys_mmap(NULL, size, prot, flags, -1, 0);
+	struct lzip* lp = buf;
+	long hdr = sizeof(*lp);
+	int ret;
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	if((ret = lzip_start(lp, ctx->fd, buf + hdr, size - hdr, level)) < 0)
+		fail("lzip", NULL, ret);
+
+	ctx->lzip = lp;
+}
+
 void make_cpio_file(CTX, char* name)
 {
 	int fd;
 	int flags = O_WRONLY | O_CREAT | O_TRUNC;
 	int mode = 0644;
+	int lz = compressed_name(name);
 
-	check_cpio_ext(name);
+	if(!lz) check_cpio_ext(name);
 
 	if((fd = sys_open3(name, flags, mode)) < 0)
 		fail(NULL, name, fd);
 
 	ctx->fd = fd;
+
+	if(lz) start_compression(ctx);
+}
+
+void finish_cpio_file(CTX)
+{
+	int ret;
+
+	if(!ctx->lzip)
+		return;
+
+	if((ret = lzip_finish(ctx->lzip)) < 0)
+		fail("write", NULL, ret);
 }
 
 void open_base_dir(CTX, char* name)
@@ -248,12 +298,37 @@ static void header_size(struct header* hdr, uint size)
 	format_size(hdr->filesize, size);
 }
 
+static void compress_body(CTX, int fd, uint size)
+{
+	int prot = PROT_READ;
+	int flags = MAP_SHARED;
+	void* buf;
+	int ret;
+
+	if(!size) return;
+
+	buf = sys_mmap(NULL, size, prot, flags, fd, 0);
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	if((ret = lzip_write(ctx->lzip, buf, size)) < 0)
+		fail("write", NULL, ret);
+
+	sys_munmap(buf, size);
+}
+
 static void stream_body(CTX, int fd, uint size)
 {
 	int ifd = fd;
 	int ofd = ctx->fd;
 	int ret;
 
+	if(ctx->lzip) {
+		compress_body(ctx, fd, size);
+		return;
+	}
+
 	while(size > 0) {
 		int sfb = (size < (1U<<30)) ? size : (1U<<30);
 
@@ -272,6 +347,12 @@ static void write_header(CTX, void* buf, int len)
 {
 	int ret, fd = ctx->fd;
 
+	if(ctx->lzip) {
+		if((ret = lzip_write(ctx->lzip, buf, len)) < 0)
+			fail("write", NULL, ret);
+		return;
+	}
+
 	if((ret = sys_write(fd, buf, len)) < 0)
 		fail("write", NULL, ret);
 	if(ret != len)
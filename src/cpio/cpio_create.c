@@ -252,4 +252,6 @@ void cmd_create(CTX)
 	scan_directory(ctx);
 
 	put_trailer(ctx);
+
+	finish_cpio_file(ctx);
 }
@@ -263,4 +263,6 @@ void cmd_pack(CTX)
 	parse_input(lct);
 
 	put_trailer(ctx);
+
+	finish_cpio_file(ctx);
 }
@@ -1,12 +1,14 @@
 #include <sys/file.h>
+#include <sys/mman.h>
 
 #include <string.h>
 #include <format.h>
 #include <util.h>
 #include <main.h>
 
-#define RDBUF (1<<12)
-#define WRBUF (1<<14)
+#define RDBUF (1<<18)
+#define WRBUF (1<<20)
+#define MAPWIN (64<<20)
 #define HEXLINE 16
 #define OUTLINE 160
 
@@ -14,157 +16,163 @@ ERRTAG("hexdump");
 ERRLIST(NENOENT NEACCES NENOTDIR NELOOP NEISDIR NEFAULT NEINVAL NENOMEM
         NEBADF NEOVERFLOW);
 
-/* The values between 0x20 and 0x7E should be safe to print on pretty
-   much any terminal. Everything else is shown as ".", and we do not
-   bother with UTF-8 sequences. Hexdump is not the kind of tool that
-   should be handling UTF-8 anyway. */
+/* Output is formatted by fmthexline() straight into a large buffer
+   that only gets written out once it's nearly full. Non-printable
+   bytes are shown as "." there, and UTF-8 sequences are not handled;
+   hexdump is not the kind of tool that should be handling UTF-8 anyway.
 
-static int isprintable(int c)
-{
-	unsigned char cc = (c & 0xFF);
-	return (cc >= 0x20 && cc < 0x7F);
-}
-
-/* The address (offset within the file) is always shown as a 4-byte value.
-   Hexdumping something over 4GB is a bad idea.
-   Using less than 4 bytes would make sense, but traditionally it has been
-   4 bytes so we keep that. Also, the first alternative would be 2 bytes
-   which is too few for actual real life usage. */
-
-static char* fmtaddr(char* p, char* e, unsigned long addr)
-{
-	int i;
+   Addresses take 8 digits, more if the file is over 4GB. */
 
-	for(i = 3; i >= 0; i--)
-		p = fmtbyte(p, e, (addr >> 8*i) & 0xFF);
+static char outbuf[WRBUF];
+static char inbuf[RDBUF];
 
-	return p;
-}
-
-/* A single output line looks like this:
-
-   00000000   01 02 03 04 05 06 07  08 09 0A 0B 0C 0D 0E 0F  ................
+struct top {
+	uint64_t addr;
+	char* ptr;
+};
 
-   The maximum length of the line is well known (~72)
-   and the buffer is expected to have at least that much
-   space available. */
+#define CTX struct top* ctx
 
-static char* makeline(char* p, char* e, unsigned long addr, char* data, int size)
+static void flush(CTX)
 {
-	int i;
-
-	p = fmtaddr(p, e, addr);
-	p = fmtstr(p, e, "   ");
-
-	for(i = 0; i < 16; i++) {
-		if(i < size)
-			p = fmtbyte(p, e, *(data + i));
-		else
-			p = fmtstr(p, e, "  ");
-		if(i == 7)
-			p = fmtstr(p, e, "  ");
-		else if(i != 15)
-			p = fmtstr(p, e, " ");
-	}
-
-	p = fmtstr(p, e, "   ");
+	if(ctx->ptr > outbuf)
+		writeall(STDOUT, outbuf, ctx->ptr - outbuf);
 
-	for(i = 0; i < 16 && i < size; i++) {
-		char c = *(data + i);
-		p = fmtchar(p, e, isprintable(c) ? c : '.');
-	}
-
-	p = fmtchar(p, e, '\n');
-
-	return p;
+	ctx->ptr = outbuf;
 }
 
-/* Several output lines (each 16 input bytes long) are merged
-   into a single output block, to avoid excessive sys_write()s.
-   There may be more than one output block per each dumpbuf()
-   call however */
+/* Lines are always 16 bytes long except for the very last one,
+   so the caller makes sure size is a multiple of 16 unless it is
+   the last block in the file. */
 
-static void dumpbuf(unsigned long addr, char* data, long size)
+static void dumpbuf(CTX, char* data, long size)
 {
-	char buf[WRBUF];
-	char* hwm = buf + sizeof(buf) - OUTLINE;
-	char* end = buf + sizeof(buf);
-	char* p = buf;
+	char* hwm = outbuf + sizeof(outbuf) - OUTLINE;
+	char* end = outbuf + sizeof(outbuf);
+	char* p = ctx->ptr;
 
 	char* dptr = data;
 	char* dend = data + size;
+	uint64_t addr = ctx->addr;
 
 	while(dptr < dend) {
-		int linesize = (dptr + 16 < dend ? 16 : dend - dptr);
-		p = makeline(p, end, addr, dptr, linesize);
+		int linesize = (dptr + HEXLINE < dend ? HEXLINE : dend - dptr);
+
+		p = fmthexline(p, end, addr, dptr, linesize);
 		dptr += linesize;
 		addr += linesize;
 
 		if(p < hwm) continue;
 
-		writeall(1, buf, p - buf);
-		p = buf;
-	} if(p > buf)
-		writeall(1, buf, p - buf);
+		ctx->ptr = p;
+		flush(ctx);
+		p = outbuf;
+	}
+
+	ctx->ptr = p;
+	ctx->addr = addr;
 }
 
-/* Input is read in large chunks, not necessary 16-byte aligned.
+/* Pipes and such get read in large chunks, not necessary 16-byte aligned.
    The sequence of chunks is then re-arranged and dumpbuf() is called
    with strictly 16-aligned blocks. Except for the last block, which
    may be shorter.
 
-   The way it is written it may do one sys_write() more than necessary,
-   but it should do a reasonably good job at handling slowly-piped data.
-
-   Not sure if that's important, but then again, hexdump is not something
-   that should be well-optimized anyway. */
+   Whatever has been formatted gets written out once the pipe runs dry,
+   so slowly-piped data still shows up as it arrives. */
 
-static void hexdump(long fd)
+static void dumpfd(CTX, int fd)
 {
-	char buf[RDBUF];
-	unsigned long addr = 0;
 	long ptr = 0;
-	long rd;
+	long rd, want;
 
-	while((rd = sys_read(fd, buf + ptr, sizeof(buf) - ptr)) > 0) {
+	while((rd = sys_read(fd, inbuf + ptr, want = sizeof(inbuf) - ptr)) > 0) {
 		if((ptr += rd) < HEXLINE)
 			continue;
 
 		long rem = ptr % HEXLINE;
 		long blk = ptr - rem;
 
-		dumpbuf(addr, buf, blk);
-		addr += blk;
+		dumpbuf(ctx, inbuf, blk);
 
 		if(rem) {
-			memcpy(buf, buf + blk, rem);
+			memcpy(inbuf, inbuf + blk, rem);
 			ptr = rem;
 		} else {
 			ptr = 0;
-		};
+		}
+
+		if(rd < want) /* drained the pipe, next read may block */
+			flush(ctx);
+	} if(rd < 0) {
+		fail("read", NULL, rd);
 	} if(ptr) {
-		dumpbuf(addr, buf, ptr);
+		dumpbuf(ctx, inbuf, ptr);
+	}
+}
+
+/* Regular files get mapped in MAPWIN-sized windows instead, which
+   saves copying multi-GB inputs through the read buffer. The window
+   size is a multiple of 16, so lines never straddle two of them. */
+
+static void dumpmap(CTX, int fd, const char* name, uint64_t size)
+{
+	uint64_t off = 0;
+	int ret;
+
+	while(off < size) {
+		long len = size - off > MAPWIN ? MAPWIN : size - off;
+		void* buf = sys_mmap(NULL, len, PROT_READ, MAP_SHARED, fd, off);
+
+		if((ret = mmap_error(buf)))
+			fail("mmap", name, ret);
+
+		(void)sys_madvise(buf, len, MADV_SEQUENTIAL);
+
+		dumpbuf(ctx, buf, len);
+
+		sys_munmap(buf, len);
+
+		off += len;
 	}
 }
 
-static void dumpfile(const char* name)
+static void hexdump(CTX, int fd, const char* name)
+{
+	struct stat st;
+
+	ctx->ptr = outbuf;
+
+	if(sys_fstat(fd, &st) >= 0 && S_ISREG(st.mode) && st.size > 0)
+		dumpmap(ctx, fd, name, st.size);
+	else
+		dumpfd(ctx, fd);
+
+	flush(ctx);
+}
+
+static void dumpfile(CTX, const char* name)
 {
 	int fd;
 
 	if((fd = sys_open(name, O_RDONLY)) < 0)
 		fail(NULL, name, fd);
 
-	hexdump(fd);
+	hexdump(ctx, fd, name);
 }
 
 /* Handling more than a single file probably makes no sense? */
 
 int main(int argc, char** argv)
 {
+	struct top context, *ctx = &context;
+
+	memzero(ctx, sizeof(*ctx));
+
 	if(argc == 1)
-		hexdump(0);
+		hexdump(ctx, STDIN, NULL);
 	else if(argc == 2)
-		dumpfile(argv[1]);
+		dumpfile(ctx, argv[1]);
 	else
 		fail("too many arguments", NULL, 0);
 
@@ -1,5 +1,7 @@
 #include <sys/file.h>
+#include <sys/mman.h>
 
+#include <format.h>
 #include <output.h>
 #include <string.h>
 #include <util.h>
@@ -11,109 +13,122 @@
 
 ERRTAG("strings");
 
-#define PAGE 4096
+#define RDBUF (1<<18)
+#define WRBUF (1<<16)
+#define MAPWIN (64<<20)
+#define MAXMIN 128
 
-char inbuf[2*PAGE];
-char outbuf[PAGE];
+char inbuf[RDBUF];
+char outbuf[WRBUF];
 
 struct top {
-	int addr;
 	int opts;
+	int min;	/* minimal sequence length */
 
-	int min;
 	long seq;	/* current uninterrupted sequence length */
-	long pos;	/* position within the file, for -x */
-	long off;	/* offset of current sequence in file */
-	char* buf;	/* string buffer */
+	uint64_t pos;	/* file offset of the block being scanned */
+	uint64_t off;	/* offset of current sequence in file */
 
 	struct bufout bo;
+
+	char buf[MAXMIN]; /* start of a sequence not known to be long enough */
 };
 
 #define CTX struct top* ctx
 
-static void output(CTX, char* buf, int len)
+static void output(CTX, char* buf, long len)
 {
 	bufout(&ctx->bo, buf, len);
 }
 
-static int printable(char c)
+/* The address is shown as a 4-byte value, same as with hexdump,
+   unless the file is large enough to need more digits. */
+
+static void write_addr(CTX, uint64_t off)
 {
-	return ((c >= 0x20 && c < 0x7F) || c == '\t');
-}
+	char* q;
 
-/* Same as with hexdump, the address is always shown as a 4-byte value. */
+	FMTBUF(p, e, buf, 30);
+	q = fmtx64(p, e, off);
+	p = fmtpad0(p, e, 8, q);
+	p = fmtstr(p, e, "  ");
+	FMTEND(p, e);
 
-static const char hexdigits[] = "0123456789ABCDEF";
+	output(ctx, buf, p - buf);
+}
+
+/* Sequences may span several blocks. Those shorter than min are kept
+   in ctx->buf until it is known whether they should be printed. */
 
-static void fmtaddr32(char* p, unsigned long addr)
+static void extend(CTX, char* p, char* q)
 {
-	int i;
-	for(i = 7; i >= 0; i--) {
-		int d = addr & 0x0F;
-		*(p + i) = hexdigits[d];
-		addr >>= 4;
+	long len = q - p;
+	long seq = ctx->seq;
+	int min = ctx->min;
+
+	if(seq >= min) {
+		output(ctx, p, len);
+	} else if(seq + len < min) {
+		memcpy(ctx->buf + seq, p, len);
+	} else {
+		if(!(ctx->opts & OPT_x))
+			write_addr(ctx, ctx->off);
+
+		output(ctx, ctx->buf, seq);
+		output(ctx, p, len);
 	}
+
+	ctx->seq = seq + len;
 }
 
-static void write_addr(CTX, long off)
+static void finish(CTX)
 {
-	char addr[10];
-
-	fmtaddr32(addr, off);
-	addr[8] = ' ';
-	addr[9] = ' ';
+	if(ctx->seq >= ctx->min)
+		output(ctx, "\n", 1);
 
-	output(ctx, addr, 10);
+	ctx->seq = 0;
 }
 
-/* This is basically innards of a state machine, pulled out of
-   strings() where it belongs. Not pretty, but keeps nesting levels sane. */
+/* Runs too short to be printed are mostly skipped by textfind() without
+   looking at every byte, and textend() goes through the long ones a word
+   at a time. */
 
-void scan_block(CTX, char* data, int len)
+static void scan_block(CTX, char* data, long len)
 {
-	char* p = data;
 	char* end = data + len;
+	char* p = data;
+	char* q;
 
-	int min = ctx->min;
-	long seq = ctx->seq;
-	long off = ctx->off;
-	long pos = ctx->pos;
-	char* buf = ctx->buf;
-
-	for(; p < end; p++, pos++) {
-		if(printable(*p)) {
-			off = pos;
-			if(seq == min && ctx->addr)
-				write_addr(ctx, off);
-			if(seq < min)
-				buf[seq] = *p;
-			else if(seq == min)
-				output(ctx, buf, seq);
-			if(seq >= min)
-				output(ctx, p, 1);
-			seq++;
-		} else {
-			if(seq > min)
-				output(ctx, "\n", 1);
-			seq = 0;
-		}
+	if(ctx->seq) {
+		q = textend(p, end);
+		extend(ctx, p, q);
+
+		if(q >= end)
+			goto out;
+
+		finish(ctx);
+		p = q + 1;
 	}
 
-	ctx->off = off;
-	ctx->pos = pos;
-	ctx->seq = seq;
-}
+	while((p = textfind(p, end, ctx->min)) < end) {
+		q = textend(p, end);
 
-static void scan_strings(CTX, int fd, int minlen, int opts)
-{
-	char strbuf[minlen];
-	int rd;
+		ctx->off = ctx->pos + (p - data);
+		extend(ctx, p, q);
 
-	ctx->buf = strbuf;
-	ctx->min = minlen - 1;
-	ctx->opts = opts;
+		if(q >= end)
+			break;
 
-	ctx->addr = !(opts & OPT_x);
+		finish(ctx);
+		p = q + 1;
+	}
+out:
+	ctx->pos += len;
+}
+
+static void scan_fd(CTX, int fd)
+{
+	long rd;
 
 	while((rd = sys_read(fd, inbuf, sizeof(inbuf))) > 0)
 		scan_block(ctx, inbuf, rd);
@@ -121,6 +136,43 @@ static void scan_strings(CTX, int fd, int minlen, int opts)
 		fail("read", NULL, rd);
 }
 
+/* Regular files get mapped in MAPWIN-sized windows instead of being
+   read, to avoid copying all the binary data between runs around. */
+
+static void scan_map(CTX, int fd, char* name, uint64_t size)
+{
+	uint64_t off = 0;
+	int ret;
+
+	while(off < size) {
+		long len = size - off > MAPWIN ? MAPWIN : size - off;
+		void* buf = sys_mmap(NULL, len, PROT_READ, MAP_SHARED, fd, off);
+
+		if((ret = mmap_error(buf)))
+			fail("mmap", name, ret);
+
+		(void)sys_madvise(buf, len, MADV_SEQUENTIAL);
+
+		scan_block(ctx, buf, len);
+
+		sys_munmap(buf, len);
+
+		off += len;
+	}
+}
+
+static void scan_strings(CTX, int fd, char* name)
+{
+	struct stat st;
+
+	if(sys_fstat(fd, &st) >= 0 && S_ISREG(st.mode) && st.size > 0)
+		scan_map(ctx, fd, name, st.size);
+	else
+		scan_fd(ctx, fd);
+
+	finish(ctx);
+}
+
 static unsigned int xatou(const char* p)
 {
 	const char* orig = p;
@@ -149,12 +201,7 @@ static int open_check(const char* name)
 
 static void init_output(CTX)
 {
-	struct bufout* bo = &ctx->bo;
-
-	bo->fd = STDOUT;
-	bo->buf = outbuf;
-	bo->ptr = 0;
-	bo->len = sizeof(outbuf);
+	bufoutset(&ctx->bo, STDOUT, outbuf, sizeof(outbuf));
 }
 
 static void fini_output(CTX)
@@ -174,17 +221,19 @@ int main(int argc, char** argv)
 		opts = argbits(OPTS, argv[i++] + 1);
 	if(opts & OPT_n)
 		minlen = xatou(argv[i++]);
-	if(minlen <= 0 || minlen > 128)
+	if(minlen <= 0 || minlen > MAXMIN)
 		fail("bad min length value", NULL, 0);
-	if(i >= argc)
-		fail("too few arguments", NULL, 0);
 	if(i < argc - 1)
 		fail("too many arguments", NULL, 0);
 
-	int fd = open_check(argv[i]);
+	char* name = i < argc ? argv[i] : NULL;
+	int fd = name ? open_check(name) : STDIN;
+
+	ctx->opts = opts;
+	ctx->min = minlen;
 
 	init_output(ctx);
-	scan_strings(ctx, fd, minlen, opts);
+	scan_strings(ctx, fd, name);
 	fini_output(ctx);
 
 	return 0;
@@ -3,8 +3,10 @@
 #include <sys/creds.h>
 #include <sys/signal.h>
 #include <string.h>
+#include <thread.h>
 #include <util.h>
 #include <lzma.h>
+#include <lzip.h>
 
 #include "common.h"
 
@@ -14,96 +16,21 @@
 
    Lzip files include uncompressed size in the footer, we use that to
    pre-allocate output area of the right size. Compresses input files
-   are always mmaped whole. */
-
-static uint32_t get_word_at(byte* at)
-{
-	uint32_t ret = 0;
-
-	ret  = at[0];
-	ret |= at[1] << 8;
-	ret |= at[2] << 16;
-	ret |= at[3] << 24;
-
-	return ret;
-}
-
-static uint64_t get_long_at(byte* at)
-{
-	uint32_t lo = get_word_at(at + 0);
-	uint32_t hi = get_word_at(at + 4);
-
-	uint64_t ret = hi;
-
-	ret = (ret << 32) | lo;
-
-	return ret;
-}
-
-static uint32_t lzip_crc(struct mbuf* mb)
-{
-	long len = mb->len;
-	byte* buf = mb->buf;
-	byte* end = buf + len;
-
-	if(len < 6 + 20)
-		return 0;
-
-	return get_word_at(end - 20);
-}
-
-static uint32_t calc_crc(struct mbuf* mb)
-{
-	uint i, c, k;
-	static const uint mask[2] = { 0x00000000, 0xEDB88320U };
-	uint32_t crc = 0xFFFFFFFF;
-	uint32_t crctbl[256];
-
-	for(i = 0; i < 256; i++) {
-		c = i;
-
-		for(k = 0; k < 8; k++)
-			c = (c >> 1) ^ mask[c & 1];
-
-		crctbl[i] = c;
-	}
-
-	byte* ptr = mb->buf;
-	byte* end = ptr + mb->len;
-
-	while(ptr < end) {
-		uint idx = (crc ^ *ptr++) & 0xFF;
-		crc = crctbl[idx] ^ (crc >> 8);
-	}
-
-	return crc ^ 0xFFFFFFFF;
-}
-
-static void set_lzma_buffers(struct lzma* lz, struct mbuf* raw, struct mbuf* out)
-{
-	void* buf = raw->buf;
-	long len = raw->len;
-
-	void* srcbuf = buf;
-	void* srcptr = buf + 7;
-	void* srcend = buf + len - 20;
-
-	lz->srcbuf = srcbuf;
-	lz->srcptr = srcptr;
-	lz->srchwm = srcend;
-	lz->srcend = srcend;
-
-	void* dstbuf = out->buf;
-	void* dstend = dstbuf + out->len;
-
-	lz->dstbuf = dstbuf;
-	lz->dstptr = dstbuf;
-	lz->dsthwm = dstend;
-	lz->dstend = dstend;
-}
+   are always mmaped whole. Multi-member files get their members decoded
+   in parallel, see lzip_inflate(). */
 
 static int report_lzma_error(CTX, char* name, int ret)
 {
+	if(ret < 0)
+		return error(ctx, "LZIP", name, ret);
+	if(ret == LZIP_BAD_HEADER)
+		return error(ctx, "invalid LZIP header in", name, 0);
+	if(ret == LZIP_BAD_TRAILER)
+		return error(ctx, "invalid LZIP trailer in", name, 0);
+	if(ret == LZIP_BAD_CRC)
+		return error(ctx, "CRC mismatch in", name, 0);
+	if(ret == LZIP_BAD_SIZE)
+		return error(ctx, "LZMA invalid output length in", name, 0);
 	if(ret == LZMA_OUTPUT_OVER)
 		return error(ctx, "LZMA output overflow in", name, 0);
 	if(ret == LZMA_INPUT_OVER)
@@ -120,32 +47,6 @@ static int report_lzma_error(CTX, char* name, int ret)
 	return error(ctx, "LZMA failure in", name, ret);
 }
 
-static int inflate(CTX, struct mbuf* raw, struct mbuf* out, char* name)
-{
-	struct lzma* lz;
-	byte lzbuf[LZMA_SIZE];
-
-	if(!(lz = lzma_create(lzbuf, sizeof(lzbuf))))
-		fail("LZMA buffer error", NULL, 0);
-
-	set_lzma_buffers(lz, raw, out);
-
-	int ret = lzma_inflate(lz);
-
-	if(ret != LZMA_STREAM_END)
-		return report_lzma_error(ctx, name, ret);
-
-	if(lz->srcptr != lz->srcend)
-		return error(ctx, "LZMA trailing garbage in", name, 0);
-	if(lz->dstptr != lz->dstend)
-		return error(ctx, "LZMA invalid output length in", name, 0);
-
-	if(lzip_crc(raw) != calc_crc(out))
-		return error(ctx, "CRC mismatch in", name, 0);
-
-	return 0;
-}
-
 static int alloc_output(CTX, struct mbuf* mb, ulong size)
 {
 	void* buf;
@@ -166,54 +67,28 @@ static int alloc_output(CTX, struct mbuf* mb, ulong size)
 	return 0;
 }
 
-static int check_header(CTX, struct mbuf* raw, char* name, ulong* size)
-{
-	ulong len = raw->len;
-	byte* buf = raw->buf;
-
-	if(len < 6 + 20)
-		return error(ctx, "archive too short:", name, 0);
-	if(memcmp(buf, "LZIP\x01", 5))
-		return error(ctx, "invalid LZIP header in", name, 0);
-
-	byte dscode = buf[5];
-	uint dictsize = 1 << (dscode & 0x1F);
-	dictsize -= (dictsize/16) * ((dscode >> 5) & 7);
-
-	if(dictsize < (1<<12) || dictsize > (1<<29))
-		return error(ctx, "invalid LZIP dictsize in", name, 0);
-
-	byte* end = buf + len;
-
-	uint64_t isize = get_long_at(end - 8);
-
-	if(isize != len)
-		return error(ctx, "invalid LZIP input size", name, 0);
-
-	uint64_t osize = get_long_at(end - 16);
-
-	*size = osize;
-
-	if(*size != osize)
-		return error(ctx, "LZIP archive too long:", name, 0);
-
-	return 0;
-}
-
 int map_lunzip(CTX, struct mbuf* mb, char* name)
 {
 	struct mbuf raw;
-	ulong size = 0;
+	uint64_t size = 0;
 	int ret;
 
 	if((ret = mmap_whole(ctx, &raw, name)) < 0)
 		return ret;
-	if((ret = check_header(ctx, &raw, name, &size)) < 0)
+	if((ret = lzip_scan(raw.buf, raw.len, &size)))
+		goto err;
+	if((uint)size != size) {
+		ret = error(ctx, "LZIP archive too long:", name, 0);
 		goto out;
+	}
 	if((ret = alloc_output(ctx, mb, size)) < 0)
 		goto out;
-	if((ret = inflate(ctx, &raw, mb, name)) < 0)
-		munmap_buf(mb);
+	if(!(ret = lzip_inflate(raw.buf, raw.len, mb->buf, size, thread_cpus())))
+		goto out;
+
+	munmap_buf(mb);
+err:
+	ret = report_lzma_error(ctx, name, ret);
 out:
 	munmap_buf(&raw);
 
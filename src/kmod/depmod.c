@@ -164,14 +164,6 @@ static int eqstrnncmp(char* a, int an, char* b, int bn)
 /* Directory scanning section.
    Locate all available modules and build sorted indexes in ctx. */
 
-static int by_path(void* pa, void* pb)
-{
-	struct mod* a = pa;
-	struct mod* b = pb;
-
-	return strcmp(a->path, b->path);
-}
-
 static int by_name(void* pa, void* pb)
 {
 	struct mod* a = pa;
@@ -207,7 +199,7 @@ static void index_modules(CTX)
 	ctx->pidx = pidx;
 	ctx->nidx = nidx;
 
-	qsortp(pidx, n, by_path);
+	qsorts(pidx, n, offsetof(struct mod, path));
 	qsortp(nidx, n, by_name);
 }
 
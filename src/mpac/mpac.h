@@ -1,4 +1,5 @@
 struct bufout;
+struct lzip;
 
 #define TAG_DIR  (1<<7)
 
@@ -21,6 +22,7 @@ struct top {
 
 	/* the .pac file being worked on */
 	int fd;
+	struct lzip* lzip; /* for .pac.lz output */
 
 	/* the top directory being packed or unpacked to */
 	char* root;
@@ -77,6 +79,7 @@ char* shift(CTX);
 void no_more_arguments(CTX);
 
 void check_pac_ext(char* name);
+int check_pac_out(char* name);
 void check_list_ext(char* name);
 
 void heap_init(CTX, int size);
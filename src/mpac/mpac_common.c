@@ -11,6 +11,9 @@
 #include <format.h>
 #include <printf.h>
 #include <config.h>
+#include <thread.h>
+#include <lzma.h>
+#include <lzip.h>
 #include <main.h>
 #include <util.h>
 
@@ -249,6 +252,72 @@ static void spawn_pipe(CTX, char* dec, char* path)
 	ctx->fd = fds[0];
 }
 
+/* .pac.lz files get unpacked in-process into a memfd, with members
+   decoded in parallel if there are several of them. The rest of the code
+   then reads the memfd like it would read an uncompressed .pac.
+   This needs the whole uncompressed package in memory, but unlike
+   the external decoder it can use all the CPUs available. */
+
+static void* map_input(int fd, char* name, long* len)
+{
+	struct stat st;
+	void* buf;
+	int ret;
+
+	if((ret = sys_fstat(fd, &st)) < 0)
+		fail("stat", name, ret);
+
+	buf = sys_mmap(NULL, st.size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", name, ret);
+
+	*len = st.size;
+
+	return buf;
+}
+
+static void open_lzip(CTX, char* name)
+{
+	int fd, mfd, ret;
+	uint64_t size;
+	long len;
+	void* raw;
+	void* out;
+
+	if((fd = sys_open(name, O_RDONLY)) < 0)
+		fail(NULL, name, fd);
+
+	raw = map_input(fd, name, &len);
+
+	if((ret = lzip_scan(raw, len, &size)))
+		goto err;
+	if((mfd = sys_memfd_create("mpac", MFD_CLOEXEC)) < 0)
+		fail("memfd_create", NULL, mfd);
+	if((ret = sys_ftruncate(mfd, size)) < 0)
+		fail("ftruncate", NULL, ret);
+
+	out = sys_mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0);
+
+	if((ret = mmap_error(out)))
+		fail("mmap", NULL, ret);
+	if((ret = lzip_inflate(raw, len, out, size, thread_cpus())))
+		goto err;
+
+	sys_munmap(out, size);
+	sys_munmap(raw, len);
+	sys_close(fd);
+
+	ctx->fd = mfd;
+
+	return;
+err:
+	if(ret < 0)
+		fail(NULL, name, ret);
+
+	fail("corrupt lzip data in", name, 0);
+}
+
 static void open_compressed(CTX, char* name, char* suff)
 {
 	int ret;
@@ -321,10 +390,31 @@ void open_pacfile(CTX, char* name)
 
 	char* prev = skip_extension(name, suff);
 
-	if(equals(prev, suff, ".pac"))
-		return open_compressed(ctx, name, suff);
+	if(!equals(prev, suff, ".pac"))
+		fail("no .pac suffix in", name, 0);
+	if(equals(suff, nend, ".lz"))
+		return open_lzip(ctx, name);
+
+	return open_compressed(ctx, name, suff);
+}
+
+/* Output files may be either .pac or .pac.lz, the latter is compressed
+   in-process. Returns 1 if compression is needed. */
+
+int check_pac_out(char* name)
+{
+	char* nend = strpend(name);
+	char* suff = skip_extension(name, nend);
+
+	if(equals(suff, nend, ".pac"))
+		return 0;
+
+	char* prev = skip_extension(name, suff);
+
+	if(equals(prev, suff, ".pac") && equals(suff, nend, ".lz"))
+		return 1;
 
-	fail("no .pac suffix in", name, 0);
+	fail("need .pac or .pac.lz suffix:", name, 0);
 }
 
 int next_entry(CTX)
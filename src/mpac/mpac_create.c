@@ -6,6 +6,8 @@
 
 #include <string.h>
 #include <format.h>
+#include <lzma.h>
+#include <lzip.h>
 #include <main.h>
 #include <util.h>
 
@@ -17,7 +19,12 @@
    This is done in two steps: first, we scan the directory, whole,
    stat and sort the entries, and write the index. Then, we scan
    the directory second time, now following the index, and append
-   individual file content to the achive. */
+   individual file content to the achive.
+
+   With .pac.lz output, everything written to the file goes through
+   the LZMA compressor in lib instead. */
+
+#define LEVEL 6
 
 struct ent {
 	short len;
@@ -361,12 +368,25 @@ static void put_entries(CTX, struct ent** idx, int depth)
 	}
 }
 
+static void output(CTX, void* buf, uint len)
+{
+	int ret;
+
+	if(ctx->lzip)
+		ret = lzip_write(ctx->lzip, buf, len);
+	else
+		ret = writeall(ctx->fd, buf, len);
+
+	if(ret < 0)
+		fail("write", NULL, ret);
+}
+
 static void dump_symlink(CTX, struct ent* p)
 {
 	int at = ctx->at;
 	char* name = p->name;
 	uint size = p->size;
-	int ret, fd = ctx->fd;
+	int ret;
 
 	void* buf = ctx->dirbuf;
 	int len = ctx->dirlen;
@@ -377,8 +397,24 @@ static void dump_symlink(CTX, struct ent* p)
 	if(ret != (int)size)
 		fail("size mismatch in", name, 0);
 
-	if((ret = writeall(fd, buf, ret)) < 0)
-		fail("write", NULL, ret);
+	output(ctx, buf, ret);
+}
+
+static void compress_file(CTX, int fd, char* name, uint size)
+{
+	void* buf;
+	int ret;
+
+	if(!size) return;
+
+	buf = sys_mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if((ret = mmap_error(buf)))
+		failx(ctx, "mmap", name, ret);
+
+	output(ctx, buf, size);
+
+	sys_munmap(buf, size);
 }
 
 static void dump_bindata(CTX, struct ent* p)
@@ -392,9 +428,11 @@ static void dump_bindata(CTX, struct ent* p)
 	if((fd = sys_openat(at, name, O_RDONLY)) < 0)
 		fail(NULL, name, fd);
 
-	if((ret = sys_sendfile(out, fd, NULL, size)) < 0)
+	if(ctx->lzip)
+		compress_file(ctx, fd, name, size);
+	else if((ret = sys_sendfile(out, fd, NULL, size)) < 0)
 		failx(ctx, "sendfile", name, ret);
-	if(ret != (int)size)
+	else if(ret != (int)size)
 		failx(ctx, NULL, name, -EINTR);
 
 	sys_close(fd);
@@ -488,7 +526,37 @@ static void* put_file_tag(void* ptr, int size)
 	return ptr + s;
 }
 
-static void open_output(CTX, char* out)
+static void start_compression(CTX)
+{
+	int level = LEVEL;
+	long size = LZIP_SIZE(level);
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	struct lzip* lp = heap_alloc(ctx, sizeof(*lp));
+	void* buf = sys_mmap(NULL, size, prot, flags, -1, 0);
+	int ret;
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	if((ret = lzip_start(lp, ctx->fd, buf, size, level)) < 0)
+		fail("lzip", NULL, ret);
+
+	ctx->lzip = lp;
+}
+
+static void finish_compression(CTX, char* out)
+{
+	int ret;
+
+	if(!ctx->lzip)
+		return;
+
+	if((ret = lzip_finish(ctx->lzip)) < 0)
+		fail(NULL, out, ret);
+}
+
+static void open_output(CTX, char* out, int lz)
 {
 	int fd;
 	int flags = O_WRONLY | O_CREAT | O_TRUNC;
@@ -498,22 +566,18 @@ static void open_output(CTX, char* out)
 		fail(NULL, out, fd);
 
 	ctx->fd = fd;
-}
-
-static void flush_header(CTX, char* out, void* hdr, uint len)
-{
-	int ret, fd = ctx->fd;
 
-	if((ret = writeall(fd, hdr, len)) < 0)
-		fail(NULL, out, ret);
+	if(lz) start_compression(ctx);
 }
 
-static void dump_packed(CTX, char* out)
+static void dump_packed(CTX, char* out, int lz)
 {
 	int need = ctx->hsize + 8;
-	void* ptr = ctx->ptr;
+	void* ptr;
 
-	open_output(ctx, out);
+	open_output(ctx, out, lz);
+
+	ptr = ctx->ptr;
 
 	(void)heap_alloc(ctx, need);
 
@@ -528,11 +592,13 @@ static void dump_packed(CTX, char* out)
 
 	ptr = put_file_tag(ptr, entsize);
 
-	flush_header(ctx, out, ptr, entend - ptr);
+	output(ctx, ptr, entend - ptr);
 
 	ctx->ptr = ptr;
 
 	dump_content(ctx, ctx->idx);
+
+	finish_compression(ctx, out);
 }
 
 void cmd_create(CTX)
@@ -540,7 +606,7 @@ void cmd_create(CTX)
 	char* outfile = shift(ctx);
 	char* start = shift(ctx);
 
-	check_pac_ext(outfile);
+	int lz = check_pac_out(outfile);
 
 	heap_init(ctx, 4*PAGE);
 
@@ -549,5 +615,5 @@ void cmd_create(CTX)
 
 	scan_files(ctx, start);
 
-	dump_packed(ctx, outfile);
+	dump_packed(ctx, outfile, lz);
 }
@@ -6,6 +6,7 @@
 #include <sys/ioctl.h>
 
 #include <string.h>
+#include <uring.h>
 #include <util.h>
 #include <main.h>
 
@@ -13,15 +14,23 @@ ERRTAG("bincopy");
 ERRLIST(NEAGAIN NEBADF NEFAULT NEINTR NEINVAL NEIO NEISDIR
 	NEFBIG NENOSPC NEPERM NEPIPE NENOENT NEEXIST);
 
-#define OPTS "rwz"
+#define OPTS "rwzas"
 #define OPT_r (1<<0)
 #define OPT_w (1<<1)
 #define OPT_z (1<<2)
+#define OPT_a (1<<3)
+#define OPT_s (1<<4)
 
 #define SET_size (1<<16)
 
 #define MAXRUN 10*1024*1024
 
+#define RINGRUN (1024*1024)
+#define RINGDEPTH 8
+
+#define SPARSERUN (1024*1024)
+#define ZEROBLK 4096
+
 struct file {
 	char* name;
 	int fd;
@@ -171,6 +180,8 @@ static void truncate(struct file* dst, uint64_t size)
 
 	if((ret = sys_ftruncate(dst->fd, size)) < 0)
 		fail("truncate", dst->name, ret);
+
+	dst->size = size;
 }
 
 static void seekfile(struct file* f)
@@ -271,6 +282,327 @@ static int copymmap(struct file* dst, struct file* src, uint64_t size)
 	return 1;
 }
 
+/* With -a, the data gets moved by io_uring, in RINGRUN-sized linked
+   read+write pairs, with up to RINGDEPTH of them in flight. This keeps
+   the device queue busy, unlike one read at a time. Only works with
+   explicit offsets, so both sides must be sizable. Anything unexpected
+   (short reads, short writes) gets finished synchronously. */
+
+struct ringrun {
+	char* buf;
+	uint64_t off;
+	uint len;
+	int left;
+};
+
+static void pwriteall(struct file* dst, char* buf, long len, uint64_t off)
+{
+	long wr;
+
+	while(len > 0) {
+		if((wr = sys_pwrite(dst->fd, buf, len, off)) <= 0)
+			fail("write", dst->name, wr ? wr : -EIO);
+
+		buf += wr;
+		off += wr;
+		len -= wr;
+	}
+}
+
+static void preadall(struct file* src, char* buf, long len, uint64_t off)
+{
+	long rd;
+
+	while(len > 0) {
+		if((rd = sys_pread(src->fd, buf, len, off)) <= 0)
+			fail("read", src->name, rd ? rd : -EIO);
+
+		buf += rd;
+		off += rd;
+		len -= rd;
+	}
+}
+
+static void issue_run(struct uring* ur, struct file* dst, struct file* src,
+                      struct ringrun* rr)
+{
+	struct io_uring_sqe* sqe;
+
+	sqe = uring_sqe(ur);
+	sqe->opcode = IORING_OP_READ;
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->fd = src->fd;
+	sqe->addr = (long)rr->buf;
+	sqe->len = rr->len;
+	sqe->off = src->off + rr->off;
+	sqe->user_data = (long)rr;
+
+	sqe = uring_sqe(ur);
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = dst->fd;
+	sqe->addr = (long)rr->buf;
+	sqe->len = rr->len;
+	sqe->off = dst->off + rr->off;
+	sqe->user_data = (long)rr | 1;
+
+	rr->left = 2;
+}
+
+static void run_done(struct file* dst, struct file* src, struct ringrun* rr,
+                     int write, int res)
+{
+	if(!write && res < 0)
+		fail("read", src->name, res);
+	if(write && res == -ECANCELED)
+		return;
+	if(write && res < 0)
+		fail("write", dst->name, res);
+
+	if(res >= (int)rr->len)
+		return;
+
+	if(!write) {
+		preadall(src, rr->buf + res, rr->len - res, src->off + rr->off + res);
+		pwriteall(dst, rr->buf, rr->len, dst->off + rr->off);
+	} else {
+		pwriteall(dst, rr->buf + res, rr->len - res, dst->off + rr->off + res);
+	}
+}
+
+static int copyring(struct file* dst, struct file* src, uint64_t size)
+{
+	struct ringrun runs[RINGDEPTH];
+	struct ringrun* idle[RINGDEPTH];
+	struct io_uring_cqe* cqe;
+	struct uring ur;
+	uint64_t next = 0;
+	int i, nidle, busy = 0;
+	long ret;
+
+	if(!sizable(src) || !sizable(dst))
+		return 0;
+	if(uring_init(&ur, 2*RINGDEPTH) < 0)
+		return 0;
+
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	char* bufs = sys_mmap(NULL, RINGDEPTH*RINGRUN, prot, flags, -1, 0);
+
+	if(mmap_error(bufs))
+		fail("mmap", NULL, (long)bufs);
+
+	for(i = 0; i < RINGDEPTH; i++) {
+		runs[i].buf = bufs + i*RINGRUN;
+		idle[i] = &runs[i];
+	}
+
+	nidle = RINGDEPTH;
+
+	while(next < size || busy) {
+		while(nidle && next < size) {
+			struct ringrun* rr = idle[--nidle];
+			uint64_t left = size - next;
+
+			rr->off = next;
+			rr->len = left > RINGRUN ? RINGRUN : left;
+
+			issue_run(&ur, dst, src, rr);
+
+			next += rr->len;
+			busy++;
+		}
+
+		if((ret = uring_enter(&ur, 1)) < 0)
+			fail("io_uring_enter", NULL, ret);
+
+		while((cqe = uring_cqe(&ur))) {
+			struct ringrun* rr = (struct ringrun*)(long)(cqe->user_data & ~1ULL);
+			int write = cqe->user_data & 1;
+
+			run_done(dst, src, rr, write, cqe->res);
+
+			uring_seen(&ur);
+
+			if(--rr->left)
+				continue;
+
+			idle[nidle++] = rr;
+			busy--;
+		}
+	}
+
+	sys_munmap(bufs, RINGDEPTH*RINGRUN);
+	uring_fini(&ur);
+
+	return 1;
+}
+
+/* Sparse copy (-s). Only the data extents of the source get read, as
+   reported by SEEK_DATA/SEEK_HOLE, and whatever gets read is checked
+   for all-zero blocks. Nothing gets written for the holes or the zero
+   blocks. Within the original size of the destination they get punched
+   out instead, so that stale data does not show through; past the end,
+   the final truncate leaves a hole.
+
+   Block devices report all of their contents as data, but zero detection
+   still applies, and punching holes in a block device zeroes the range,
+   possibly by discarding it. */
+
+struct sparse {
+	struct file* dst;
+	struct file* src;
+	char* buf;
+	uint64_t hole;	/* start of the pending hole, relative */
+};
+
+static void writezeroes(struct file* dst, uint64_t off, uint64_t len)
+{
+	uint64_t blen = len > MAXRUN ? MAXRUN : len;
+	char* zeroes = mmapempty(blen);
+
+	while(len > 0) {
+		uint64_t part = len > blen ? blen : len;
+
+		pwriteall(dst, zeroes, part, off);
+
+		off += part;
+		len -= part;
+	}
+
+	sys_munmap(zeroes, blen);
+}
+
+static void punchhole(struct sparse* sp, uint64_t upto)
+{
+	struct file* dst = sp->dst;
+	uint64_t from = dst->off + sp->hole;
+	uint64_t to = dst->off + upto;
+	const int flags = FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE;
+	long ret;
+
+	sp->hole = upto;
+
+	if(to > dst->size)
+		to = dst->size;
+	if(from >= to)
+		return;
+
+	if((ret = sys_fallocate(dst->fd, flags, from, to - from)) >= 0)
+		return;
+	if(ret != -EOPNOTSUPP && ret != -ENOSYS)
+		fail("cannot fallocate", dst->name, ret);
+
+	writezeroes(dst, from, to - from);
+}
+
+static long zeroblocks(char* buf, long i, long len)
+{
+	for(; i < len; i += ZEROBLK)
+		if(nonzero(buf + i, len - i < ZEROBLK ? len - i : ZEROBLK))
+			return i;
+
+	return len;
+}
+
+static long datablocks(char* buf, long i, long len)
+{
+	for(; i < len; i += ZEROBLK)
+		if(!nonzero(buf + i, len - i < ZEROBLK ? len - i : ZEROBLK))
+			return i;
+
+	return len;
+}
+
+static void sparserun(struct sparse* sp, uint64_t at, long len)
+{
+	char* buf = sp->buf;
+	long i = 0;
+
+	preadall(sp->src, buf, len, sp->src->off + at);
+
+	while(i < len) {
+		long ds = zeroblocks(buf, i, len);
+		long de = datablocks(buf, ds, len);
+
+		if(ds >= len)
+			break;
+
+		punchhole(sp, at + ds);
+		pwriteall(sp->dst, buf + ds, de - ds, sp->dst->off + at + ds);
+
+		sp->hole = at + de;
+		i = de;
+	}
+}
+
+/* Locate the next data extent in src at or after relative offset pos.
+   ENXIO means there's no more data; anything else, like EINVAL from
+   filesystems that do not support SEEK_DATA, is taken as all data. */
+
+static void nextdata(struct file* src, uint64_t pos, uint64_t size,
+                     uint64_t* ds, uint64_t* de)
+{
+	int64_t base = src->off;
+	int64_t ps, pe;
+	long ret;
+
+	if((ret = sys_llseek(src->fd, base + pos, &ps, SEEK_DATA)) == -ENXIO)
+		ps = base + size;
+	else if(ret < 0)
+		ps = base + pos;
+
+	if(ps >= base + size)
+		pe = ps;
+	else if(sys_llseek(src->fd, ps, &pe, SEEK_HOLE) < 0)
+		pe = base + size;
+
+	ps -= base;
+	pe -= base;
+
+	*ds = ps < (int64_t)size ? ps : size;
+	*de = pe < (int64_t)size ? pe : size;
+}
+
+static int copysparse(struct file* dst, struct file* src, uint64_t size)
+{
+	struct sparse sp = { .dst = dst, .src = src, .hole = 0 };
+	uint64_t pos = 0, ds, de;
+
+	if(!sizable(src) || !sizable(dst))
+		return 0;
+
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	char* buf = sys_mmap(NULL, SPARSERUN, prot, flags, -1, 0);
+
+	if(mmap_error(buf))
+		fail("mmap", NULL, (long)buf);
+
+	sp.buf = buf;
+
+	while(pos < size) {
+		nextdata(src, pos, size, &ds, &de);
+
+		for(pos = ds; pos < de; pos += SPARSERUN) {
+			uint64_t left = de - pos;
+			long len = left > SPARSERUN ? SPARSERUN : left;
+
+			sparserun(&sp, pos, len);
+		}
+
+		pos = de > ds ? de : size;
+	}
+
+	punchhole(&sp, size);
+
+	if(regular(dst) && dst->off + size > dst->size)
+		truncate(dst, dst->off + size);
+
+	sys_munmap(buf, SPARSERUN);
+
+	return 1;
+}
+
 static void readwrite(struct file* dst, struct file* src, uint64_t size)
 {
 	uint64_t left = size;
@@ -303,7 +635,11 @@ static void transfer(struct bcp* ctx, struct file* dst, struct file* src)
 
 	uint64_t size = ctx->size;
 
-	if(sendfile(dst, src, size))
+	if((ctx->opts & OPT_s) && copysparse(dst, src, size))
+		;
+	else if((ctx->opts & OPT_a) && copyring(dst, src, size))
+		;
+	else if(sendfile(dst, src, size))
 		;
 	else if(copymmap(dst, src, size))
 		;
@@ -83,6 +83,12 @@ static int prep_opts(CTX, int argc, char** argv)
 	if(i < argc && argv[i][0] == '-')
 		opts = argbits(OPTS, argv[i++] + 1);
 
+	/* Moving files needs the source unlinked after the contents
+	   have been copied, which does not mix well with workers
+	   or with requests left in flight. */
+	if(opts & OPT_m)
+		opts &= ~(OPT_j | OPT_a);
+
 	ctx->argc = argc;
 	ctx->argv = argv;
 	ctx->argi = i;
@@ -126,6 +132,8 @@ static void tryrun(void (*run)(CTX, CCT), CTX, CCT)
 	ctx->argi = argi;
 real:
 	run(ctx, cct);
+	wait_jobs(ctx);
+	wait_ring(ctx);
 }
 
 int main(int argc, char** argv)
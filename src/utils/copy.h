@@ -1,4 +1,4 @@
-#define OPTS "nthomuqyv"
+#define OPTS "nthomuqyvja"
 
 #define OPT_n (1<<0)     /* new copy, no overwriting */
 #define OPT_t (1<<1)     /* copy to */
@@ -9,6 +9,8 @@
 #define OPT_q (1<<6)     /* query, dry run only */
 #define OPT_y (1<<7)     /* yolo mode, skip dry run */
 #define OPT_v (1<<8)     /* verbose */
+#define OPT_j (1<<9)     /* parallel, file contents copied by worker threads */
+#define OPT_a (1<<10)    /* async, file contents copied via io_uring */
 
 #define DRY (1<<16)    /* dry run */
 
@@ -28,7 +30,15 @@ struct top {
 	void* ptr;
 	void* end;
 
+	uint* index;   /* open-addressing hash of struct link offsets in brk */
+	uint nslots;
+	uint nlinks;
+
 	int errors;
+
+	int dirseq;
+	struct pool* pool;
+	struct ring* ring;
 };
 
 struct atf {
@@ -44,8 +54,11 @@ struct cct {
 	struct atf src;
 	struct stat st;
 	int wrchecked;
+	int noclone;
+	int nocopyrange;
 	int nosendfile;
 	int dstatdup;
+	int seq;
 };
 
 struct link {
@@ -67,11 +80,24 @@ struct link {
 void warnat(const char* msg, struct atf* dd, int err);
 void failat(const char* msg, struct atf* dd, int err) noreturn;
 
+int pathlen(struct atf* dd);
+void makepath(char* buf, int size, struct atf* dd);
+void set_file(struct atf* to, struct atf* dd, char* buf, int size);
+void* map(long size);
+
 void run(CCT, char* dst, char* src);
 
 void copyfile(CCT);
+void transfer(CCT);
+int reflink(CCT);
 void trychown(CCT);
 
+void submit_job(CCT);
+void wait_jobs(CTX);
+
+void ring_file(CCT);
+void wait_ring(CTX);
+
 void note_ino(CCT);
 
 int link_dst(CCT);
@@ -1,7 +1,9 @@
+#include <bits/ioctl/clone.h>
 #include <sys/dents.h>
 #include <sys/file.h>
 #include <sys/fpath.h>
 #include <sys/fprop.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/splice.h>
 
@@ -17,6 +19,62 @@
 
 #define RWBUFSIZE 1024*1024
 
+/* Reflinking makes dst share extents with src, no data gets copied at all.
+   Holes get cloned as holes, so this is done for the whole file before
+   looking at sparseness. Any failure here means we should try other ways,
+   whatever the reason. */
+
+int reflink(CCT)
+{
+	int sfd = cct->src.fd;
+	int dfd = cct->dst.fd;
+
+	return sys_ioctli(dfd, FICLONE, sfd);
+}
+
+/* In-kernel copy. Depending on the fs, this may also end up being a reflink,
+   or a server-side copy for network filesystems. Older kernels refuse to do
+   it across filesystems with EXDEV, and some special files (procfs etc)
+   claim non-zero size but yield nothing. Both should fall back to sendfile.
+   Like sendfile, this uses and advances file positions. */
+
+static int copyrange(CCT, off_t* size)
+{
+	struct atf* dst = &cct->dst;
+	struct atf* src = &cct->src;
+
+	int sfd = src->fd;
+	int dfd = dst->fd;
+
+	off_t done = 0;
+	long ret = 0;
+	long run = 0x7ffff000;
+
+	if(*size < run)
+		run = *size;
+
+	while(1) {
+		if(done >= *size)
+			break;
+		if((ret = sys_copy_file_range(sfd, NULL, dfd, NULL, run, 0)) <= 0)
+			break;
+		done += ret;
+	};
+
+	if(!done && !ret)
+		return -1;
+	if(ret >= 0)
+		return 0;
+	if(done)
+		;
+	else if(ret == -EXDEV || ret == -EINVAL)
+		return -1;
+	else if(ret == -ENOSYS || ret == -EOPNOTSUPP)
+		return -1;
+
+	failat("copy_file_range", dst, ret);
+}
+
 static int sendfile(CCT, off_t* size)
 {
 	struct atf* dst = &cct->dst;
@@ -96,14 +154,22 @@ static void readwrite(CCT, off_t* size)
 	}
 }
 
-/* Sendfile may not work on a given pair of descriptors for various reasons.
-   If this happens, fall back to read/write calls.
+/* Neither copy_file_range nor sendfile may work on a given pair of descriptors,
+   for various reasons. If this happens, fall back to the next method, with
+   read/write calls being the last resort.
 
    Generally the reasons depend on directory (and the underlying fs), so if
-   sendfile fails for one file we stop using it for the whole directory. */
+   some method fails for one file we stop using it for the whole directory. */
 
 static void moveblock(CCT, off_t* size)
 {
+	if(cct->nocopyrange)
+		;
+	else if(copyrange(cct, size) >= 0)
+		return;
+	else
+		cct->nocopyrange = 1;
+
 	if(cct->nosendfile)
 		;
 	else if(sendfile(cct, size) >= 0)
@@ -124,15 +190,20 @@ static void moveblock(CCT, off_t* size)
    Sparse files are rare, so we try to skip the hole-hopping code as soon
    as it becomes clear there are likely no holes in the source file. */
 
-static void transfer(CCT)
+void transfer(CCT)
 {
 	struct stat* st = &cct->st;
-	char* rname = cct->src.name;
-	char* wname = cct->dst.name;
 	int rfd = cct->src.fd;
 	int wfd = cct->dst.fd;
 	int ret;
 
+	if(cct->noclone)
+		;
+	else if(reflink(cct) >= 0)
+		return;
+	else
+		cct->noclone = 1;
+
 	if(512*st->blocks >= st->size)
 		goto plain;
 
@@ -150,9 +221,9 @@ static void transfer(CCT)
 
 	while(1) {
 		if((ret = sys_seek(wfd, ds)) < 0)
-			fail("seek", wname, ret);
+			failat("seek", &cct->dst, ret);
 		if((ret = sys_seek(rfd, ds)) < 0)
-			fail("seek", rname, ret);
+			failat("seek", &cct->src, ret);
 
 		if((blk = de - ds) > 0)
 			moveblock(cct, &blk);
@@ -237,26 +308,45 @@ static void open_dst(CCT)
    This wastes one fd for each directory with multi-linked files in it.
    Typical open file limit in Linux is around 1024, so we should be good. */
 
+/* Trees with lots of hard links (package stores, ccache dirs) may have
+   tens of thousands of them, so struct link records are indexed by
+   (sdev, sino) in an open-addressing hash table with linear probing.
+   Slots hold record offsets from brk plus one, zero means empty.
+
+   The table lives in the same brk heap as the records. When it gets half
+   full, a new one twice the size gets allocated past the last record and
+   the old one is simply abandoned, so the total waste stays below the size
+   of the current table. */
+
+#define NSLOTS 1024
+
+static uint hash_ino(uint64_t dev, uint64_t ino)
+{
+	uint64_t h = (ino ^ (dev << 40) ^ (dev >> 24)) * 0x9E3779B97F4A7C15ULL;
+
+	return h >> 32;
+}
+
 static struct link* find_link(CCT)
 {
 	struct top* ctx = cct->top;
 	struct stat* st = &cct->st;
+	uint* index = ctx->index;
 
-	if(!ctx->brk)
+	if(!index)
 		return NULL;
 
-	char* p = ctx->brk;
-	char* e = ctx->ptr;
+	uint mask = ctx->nslots - 1;
+	uint i = hash_ino(st->dev, st->ino) & mask;
+	uint off;
 
-	while(p < e) {
-		struct link* ln = (struct link*) p;
+	while((off = index[i])) {
+		struct link* ln = ctx->brk + off - 1;
 
-		if(!ln->len)
-			break; /* wtf */
 		if(ln->sdev == st->dev && ln->sino == st->ino)
 			return ln;
 
-		p += ln->len;
+		i = (i + 1) & mask;
 	}
 
 	return NULL;
@@ -272,10 +362,8 @@ static int align4(int len)
 	return len + (4 - len%4) % 4;
 }
 
-static struct link* alloc_link(CCT, int len)
+static void* heap_alloc(struct top* ctx, long len)
 {
-	struct top* ctx = cct->top;
-
 	if(!ctx->brk) {
 		void* brk = sys_brk(0);
 		void* new = sys_brk(brk + PAGE);
@@ -293,7 +381,8 @@ static struct link* alloc_link(CCT, int len)
 
 	if(req > ctx->end) {
 		void* end = ctx->end;
-		void* new = sys_brk(end + PAGE);
+		long need = req - end;
+		void* new = sys_brk(end + need + (PAGE - need%PAGE) % PAGE);
 
 		if(brk_error(end, new))
 			return NULL;
@@ -306,6 +395,71 @@ static struct link* alloc_link(CCT, int len)
 	return ptr;
 }
 
+static void insert_slot(uint* index, uint nslots, struct link* ln, uint off)
+{
+	uint mask = nslots - 1;
+	uint i = hash_ino(ln->sdev, ln->sino) & mask;
+
+	while(index[i])
+		i = (i + 1) & mask;
+
+	index[i] = off;
+}
+
+static int grow_index(struct top* ctx)
+{
+	uint* old = ctx->index;
+	uint oldslots = ctx->nslots;
+	uint nslots = oldslots ? 2*oldslots : NSLOTS;
+	uint* index;
+	uint i;
+
+	if(!(index = heap_alloc(ctx, nslots*sizeof(*index))))
+		return -ENOMEM;
+
+	memzero(index, nslots*sizeof(*index));
+
+	for(i = 0; i < oldslots; i++) {
+		uint off = old[i];
+
+		if(off)
+			insert_slot(index, nslots, ctx->brk + off - 1, off);
+	}
+
+	ctx->index = index;
+	ctx->nslots = nslots;
+
+	return 0;
+}
+
+/* Repeated entries for the same source inode are possible if link_dst
+   failed for some reason. The first one is what find_link should keep
+   returning, so the later ones do not get indexed. */
+
+static void index_link(struct top* ctx, struct link* ln)
+{
+	uint off = (void*)ln - ctx->brk + 1;
+
+	if(2*(ctx->nlinks + 1) > ctx->nslots && grow_index(ctx) < 0)
+		return;
+
+	uint mask = ctx->nslots - 1;
+	uint i = hash_ino(ln->sdev, ln->sino) & mask;
+	uint cur;
+
+	while((cur = ctx->index[i])) {
+		struct link* ex = ctx->brk + cur - 1;
+
+		if(ex->sdev == ln->sdev && ex->sino == ln->sino)
+			return;
+
+		i = (i + 1) & mask;
+	}
+
+	ctx->index[i] = off;
+	ctx->nlinks++;
+}
+
 void note_ino(CCT)
 {
 	struct atf* dst = &cct->dst;
@@ -318,7 +472,7 @@ void note_ino(CCT)
 	int slen = strlen(name);
 	int alen = align4(linklen(slen));
 
-	if(!(ln = alloc_link(cct, alen)))
+	if(!(ln = heap_alloc(cct->top, alen)))
 		return;
 	if((ret = sys_fstat(dst->fd, &ds)) < 0)
 		goto drop;
@@ -337,6 +491,8 @@ void note_ino(CCT)
 	memcpy(ln->name, name, slen + 1);
 	ln->len = alen;
 
+	index_link(cct->top, ln);
+
 	return;
 drop:
 	cct->top->ptr = ln;
@@ -370,7 +526,10 @@ int link_dst(CCT)
 	return 1;
 }
 
-/* Entry point for all the stuff above */
+/* Entry point for all the stuff above. Everything up to and including
+   open_dst stays in the main thread, so that links get noted and checked
+   in the same order the tree gets walked in. Only the contents transfer
+   may be handed over to a worker. */
 
 void copyfile(CCT)
 {
@@ -388,13 +547,15 @@ void copyfile(CCT)
 
 	if(dst->fd < 0)
 		return;
+	if(st->nlink >= 2)
+		note_ino(cct);
 	if(!st->size)
 		return;
 
-	transfer(cct);
-
-	if(st->nlink < 2)
-		return;
-
-	note_ino(cct);
+	if(cct->top->opts & OPT_a)
+		ring_file(cct);
+	else if(cct->top->opts & OPT_j)
+		submit_job(cct);
+	else
+		transfer(cct);
 }
@@ -0,0 +1,226 @@
+#include <sys/file.h>
+
+#include <string.h>
+#include <thread.h>
+#include <util.h>
+
+#include "copy.h"
+
+/* Worker pool for copy -j. The main thread walks the tree and does all
+   the metadata work (mkdir, open, link tracking, chown), then queues
+   the pair of open fds for one of the workers to transfer the contents.
+   With several transfers in flight, the storage sees more than one
+   request at a time, which is what makes the difference on NVMe and
+   network filesystems.
+
+   Job slots come from a fixed pool. When all of them are busy, the main
+   thread waits for a worker to release one, so the number of open fds
+   stays bounded.
+
+   Errors in the workers are handled the same way as in the main thread,
+   by reporting them and terminating the whole process. */
+
+#define NWORKERS 8
+#define NJOBS (4*NWORKERS)
+#define JOBPATH 2048
+
+struct job {
+	int seq;
+	struct stat st;
+	struct atf src;
+	struct atf dst;
+	char spath[JOBPATH];
+	char dpath[JOBPATH];
+};
+
+struct worker {
+	struct pool* pool;
+	struct thread th;
+	struct top top;
+	struct cct cct;
+};
+
+struct pool {
+	struct mutex mx;
+	struct condvar more;
+	struct condvar room;
+	int done;
+
+	struct queue work;
+	struct queue free;
+	struct qslot wslots[NJOBS];
+	struct qslot fslots[NJOBS];
+
+	int nworkers;
+	struct worker workers[NWORKERS];
+	struct job jobs[NJOBS];
+};
+
+static struct job* take_job(struct pool* pl)
+{
+	void* ptr;
+
+	mutex_lock(&pl->mx);
+
+	while(queue_pop(&pl->work, &ptr) < 0) {
+		if(pl->done) {
+			ptr = NULL;
+			break;
+		}
+		cond_wait(&pl->more, &pl->mx);
+	}
+
+	mutex_unlock(&pl->mx);
+
+	return ptr;
+}
+
+static void release_job(struct pool* pl, struct job* jb)
+{
+	mutex_lock(&pl->mx);
+	queue_push(&pl->free, jb);
+	cond_signal(&pl->room);
+	mutex_unlock(&pl->mx);
+}
+
+/* Failed transfer methods are remembered per directory, and jobs from
+   the same directory tend to come in runs, so the worker keeps its flags
+   until it gets a job from some other directory. */
+
+static void run_job(struct worker* wk, struct job* jb)
+{
+	struct cct* cct = &wk->cct;
+
+	if(cct->seq != jb->seq) {
+		cct->seq = jb->seq;
+		cct->noclone = 0;
+		cct->nocopyrange = 0;
+		cct->nosendfile = 0;
+	}
+
+	cct->src = jb->src;
+	cct->dst = jb->dst;
+	memcpy(&cct->st, &jb->st, sizeof(jb->st));
+
+	transfer(cct);
+
+	sys_close(cct->src.fd);
+	sys_close(cct->dst.fd);
+}
+
+static int worker(void* arg)
+{
+	struct worker* wk = arg;
+	struct pool* pl = wk->pool;
+	struct job* jb;
+
+	while((jb = take_job(pl))) {
+		run_job(wk, jb);
+		release_job(pl, jb);
+	}
+
+	return 0;
+}
+
+/* Read/write buffers are allocated for all workers at once. The pages
+   only get used if the workers end up falling back to read/write. */
+
+static void setup_workers(CTX, struct pool* pl)
+{
+	long buflen = 1024*1024;
+	char* bufs = map(NWORKERS*buflen);
+	int i, ret = 0;
+
+	for(i = 0; i < NWORKERS; i++) {
+		struct worker* wk = &pl->workers[i];
+
+		wk->pool = pl;
+		wk->top.buf = bufs + i*buflen;
+		wk->top.len = buflen;
+		wk->cct.top = &wk->top;
+		wk->cct.seq = -1;
+
+		if((ret = thread_start(&wk->th, worker, wk)) < 0)
+			break;
+	}
+
+	if(!(pl->nworkers = i))
+		fail("cannot start threads", NULL, ret);
+}
+
+static struct pool* start_pool(CTX)
+{
+	struct pool* pl = map(sizeof(*pl));
+	int i;
+
+	queue_init(&pl->work, pl->wslots, NJOBS);
+	queue_init(&pl->free, pl->fslots, NJOBS);
+
+	for(i = 0; i < NJOBS; i++)
+		queue_push(&pl->free, &pl->jobs[i]);
+
+	setup_workers(ctx, pl);
+
+	ctx->pool = pl;
+
+	return pl;
+}
+
+static struct job* get_slot(struct pool* pl)
+{
+	void* ptr;
+
+	mutex_lock(&pl->mx);
+
+	while(queue_pop(&pl->free, &ptr) < 0)
+		cond_wait(&pl->room, &pl->mx);
+
+	mutex_unlock(&pl->mx);
+
+	return ptr;
+}
+
+static void queue_job(struct pool* pl, struct job* jb)
+{
+	mutex_lock(&pl->mx);
+	queue_push(&pl->work, jb);
+	cond_signal(&pl->more);
+	mutex_unlock(&pl->mx);
+}
+
+void submit_job(CCT)
+{
+	struct top* ctx = cct->top;
+	struct pool* pl = ctx->pool;
+	struct job* jb;
+
+	if(!pl)
+		pl = start_pool(ctx);
+
+	jb = get_slot(pl);
+
+	jb->seq = cct->seq;
+	memcpy(&jb->st, &cct->st, sizeof(jb->st));
+
+	set_file(&jb->src, &cct->src, jb->spath, sizeof(jb->spath));
+	set_file(&jb->dst, &cct->dst, jb->dpath, sizeof(jb->dpath));
+
+	queue_job(pl, jb);
+}
+
+void wait_jobs(CTX)
+{
+	struct pool* pl = ctx->pool;
+	int i;
+
+	if(!pl)
+		return;
+
+	mutex_lock(&pl->mx);
+	pl->done = 1;
+	cond_broadcast(&pl->more);
+	mutex_unlock(&pl->mx);
+
+	for(i = 0; i < pl->nworkers; i++)
+		thread_join(&pl->workers[i].th);
+}
@@ -0,0 +1,311 @@
+#include <sys/file.h>
+#include <sys/fprop.h>
+#include <sys/mman.h>
+
+#include <string.h>
+#include <uring.h>
+#include <util.h>
+
+#include "copy.h"
+
+/* io_uring backend for copy -a. Like with -j, the main thread does all
+   the metadata work in tree order, but instead of handing the open fds
+   over to threads, the contents get copied as linked read+write pairs
+   of CHUNK bytes each, and the fds are closed through the ring as well.
+
+   Small files take one chunk each, so up to NCHUNKS of them are in flight
+   at once and a single io_uring_enter submits and reaps a whole batch.
+   Large files get split, with several reads outstanding at a time.
+
+   A short read breaks the link, and the paired write completes with
+   ECANCELED. That's only possible if the file shrinks while being copied,
+   so whatever got read is written synchronously and the file gets cut
+   at that point. Short writes are finished synchronously as well.
+
+   If the ring cannot be set up (old kernel, seccomp), copy quietly falls
+   back to the synchronous code. */
+
+#define NFILES 64
+#define NCHUNKS 32
+#define CHUNK (256*1024)
+#define RINGSIZE 256
+#define JOBPATH 2048
+
+struct rfile {
+	uint64_t size;
+	uint64_t next;
+	int inflight;
+	int issuing;
+	struct atf src;
+	struct atf dst;
+	char spath[JOBPATH];
+	char dpath[JOBPATH];
+};
+
+struct chunk {
+	struct rfile* rf;
+	char* buf;
+	uint64_t off;
+	uint len;
+	int left;
+};
+
+struct ring {
+	struct uring ur;
+	int inflight;
+
+	int nfreef;
+	int nfreec;
+	struct rfile* freef[NFILES];
+	struct chunk* freec[NCHUNKS];
+
+	struct rfile files[NFILES];
+	struct chunk chunks[NCHUNKS];
+};
+
+static struct io_uring_sqe* get_sqe(struct ring* rg)
+{
+	struct io_uring_sqe* sqe;
+	int ret;
+
+	while(!(sqe = uring_sqe(&rg->ur)))
+		if((ret = uring_enter(&rg->ur, 0)) < 0)
+			fail("io_uring_enter", NULL, ret);
+
+	rg->inflight++;
+
+	return sqe;
+}
+
+static void queue_close(struct ring* rg, int fd)
+{
+	struct io_uring_sqe* sqe = get_sqe(rg);
+
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	sqe->user_data = 0;
+}
+
+static void file_done(struct ring* rg, struct rfile* rf)
+{
+	queue_close(rg, rf->src.fd);
+	queue_close(rg, rf->dst.fd);
+
+	rg->freef[rg->nfreef++] = rf;
+}
+
+static void write_sync(struct rfile* rf, char* buf, long len, uint64_t off)
+{
+	long wr;
+
+	while(len > 0) {
+		if((wr = sys_pwrite(rf->dst.fd, buf, len, off)) <= 0)
+			failat("write", &rf->dst, wr ? wr : -EIO);
+
+		buf += wr;
+		off += wr;
+		len -= wr;
+	}
+}
+
+static void read_done(struct chunk* ck, int res)
+{
+	struct rfile* rf = ck->rf;
+
+	if(res < 0)
+		failat("read", &rf->src, res);
+	if(res >= (int)ck->len)
+		return;
+
+	write_sync(rf, ck->buf, res, ck->off);
+
+	if(rf->size > ck->off + res)
+		rf->size = ck->off + res;
+	if(rf->next > rf->size)
+		rf->next = rf->size;
+
+	sys_ftruncate(rf->dst.fd, rf->size);
+}
+
+static void write_done(struct chunk* ck, int res)
+{
+	struct rfile* rf = ck->rf;
+
+	if(res == -ECANCELED)
+		return;
+	if(res < 0)
+		failat("write", &rf->dst, res);
+	if(res >= (int)ck->len)
+		return;
+
+	write_sync(rf, ck->buf + res, ck->len - res, ck->off + res);
+}
+
+static void complete(struct ring* rg, struct io_uring_cqe* cqe)
+{
+	uint64_t tag = cqe->user_data;
+	struct chunk* ck = (struct chunk*)(long)(tag & ~1ULL);
+	struct rfile* rf;
+
+	rg->inflight--;
+
+	if(!ck)
+		return; /* close, errors there are ignored like in end_file_pair */
+
+	if(tag & 1)
+		write_done(ck, cqe->res);
+	else
+		read_done(ck, cqe->res);
+
+	if(--ck->left)
+		return;
+
+	rf = ck->rf;
+	rg->freec[rg->nfreec++] = ck;
+
+	if(--rf->inflight)
+		return;
+	if(rf->issuing)
+		return;
+
+	file_done(rg, rf);
+}
+
+static void reap(struct ring* rg, int wait)
+{
+	struct io_uring_cqe* cqe;
+	int ret;
+
+	if((ret = uring_enter(&rg->ur, wait)) < 0)
+		fail("io_uring_enter", NULL, ret);
+
+	while((cqe = uring_cqe(&rg->ur))) {
+		complete(rg, cqe);
+		uring_seen(&rg->ur);
+	}
+}
+
+static void issue_chunk(struct ring* rg, struct rfile* rf, struct chunk* ck)
+{
+	struct io_uring_sqe* sqe;
+	uint64_t left = rf->size - rf->next;
+	uint len = left > CHUNK ? CHUNK : left;
+	uint64_t tag = (long)ck;
+
+	ck->rf = rf;
+	ck->off = rf->next;
+	ck->len = len;
+	ck->left = 2;
+
+	sqe = get_sqe(rg);
+	sqe->opcode = IORING_OP_READ;
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->fd = rf->src.fd;
+	sqe->addr = (long)ck->buf;
+	sqe->len = len;
+	sqe->off = ck->off;
+	sqe->user_data = tag;
+
+	sqe = get_sqe(rg);
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = rf->dst.fd;
+	sqe->addr = (long)ck->buf;
+	sqe->len = len;
+	sqe->off = ck->off;
+	sqe->user_data = tag | 1;
+
+	rf->next += len;
+	rf->inflight++;
+}
+
+static struct ring* start_ring(CTX)
+{
+	struct ring* rg = map(sizeof(*rg));
+	char* bufs;
+	int i;
+
+	if(uring_init(&rg->ur, RINGSIZE) < 0) {
+		sys_munmap(rg, sizeof(*rg));
+		ctx->opts &= ~OPT_a;
+		return NULL;
+	}
+
+	bufs = map(NCHUNKS*CHUNK);
+
+	for(i = 0; i < NFILES; i++)
+		rg->freef[i] = &rg->files[i];
+	for(i = 0; i < NCHUNKS; i++) {
+		rg->chunks[i].buf = bufs + i*CHUNK;
+		rg->freec[i] = &rg->chunks[i];
+	}
+
+	rg->nfreef = NFILES;
+	rg->nfreec = NCHUNKS;
+
+	ctx->ring = rg;
+
+	return rg;
+}
+
+/* Sparse files are left to the synchronous code, which knows how
+   to skip the holes. Reflinks are still worth a try, it's a single
+   ioctl and no data gets moved at all. */
+
+void ring_file(CCT)
+{
+	struct top* ctx = cct->top;
+	struct ring* rg = ctx->ring;
+	struct stat* st = &cct->st;
+	struct rfile* rf;
+
+	if(!rg && !(rg = start_ring(ctx)))
+		return transfer(cct);
+	if(512*st->blocks < st->size)
+		return transfer(cct);
+	if(!cct->noclone && reflink(cct) >= 0)
+		return;
+
+	cct->noclone = 1;
+
+	while(!rg->nfreef)
+		reap(rg, 1);
+
+	rf = rg->freef[--rg->nfreef];
+
+	rf->size = st->size;
+	rf->next = 0;
+	rf->inflight = 0;
+	rf->issuing = 1;
+
+	set_file(&rf->src, &cct->src, rf->spath, sizeof(rf->spath));
+	set_file(&rf->dst, &cct->dst, rf->dpath, sizeof(rf->dpath));
+
+	while(rf->next < rf->size) {
+		while(!rg->nfreec)
+			reap(rg, 1);
+
+		issue_chunk(rg, rf, rg->freec[--rg->nfreec]);
+	}
+
+	rf->issuing = 0;
+
+	if(!rf->inflight) /* all done already, possible with short reads */
+		file_done(rg, rf);
+
+	/* Submit without waiting, so that the kernel gets to work
+	   while the main thread looks for more files. */
+	reap(rg, 0);
+}
+
+void wait_ring(CTX)
+{
+	struct ring* rg = ctx->ring;
+
+	if(!rg)
+		return;
+
+	while(rg->inflight)
+		reap(rg, 1);
+
+	uring_fini(&rg->ur);
+}
@@ -7,6 +7,7 @@
 
 #include <format.h>
 #include <string.h>
+#include <thread.h>
 #include <util.h>
 
 #include "copy.h"
@@ -20,7 +21,7 @@ static int set(CCT, int opt)
 	return cct->top->opts & opt;
 }
 
-static int pathlen(struct atf* dd)
+int pathlen(struct atf* dd)
 {
 	char* name = dd->name;
 	char* dir = dd->dir;
@@ -34,7 +35,7 @@ static int pathlen(struct atf* dd)
 	return len + 1;
 }
 
-static void makepath(char* buf, int size, struct atf* dd)
+void makepath(char* buf, int size, struct atf* dd)
 {
 	char* p = buf;
 	char* e = buf + size - 1;
@@ -51,6 +52,39 @@ static void makepath(char* buf, int size, struct atf* dd)
 	*p = '\0';
 }
 
+/* For transfers that finish after the main thread has moved on.
+   The directory fds may get closed by then, so the job only gets
+   the file fds and the full paths for error messages. The fd gets
+   moved over, and closing it is up to whoever runs the job. */
+
+void set_file(struct atf* to, struct atf* dd, char* buf, int size)
+{
+	makepath(buf, size, dd);
+
+	to->at = AT_FDCWD;
+	to->dir = NULL;
+	to->name = buf;
+	to->fd = dd->fd;
+
+	dd->fd = -1;
+}
+
+/* Job slots and transfer buffers for -j and -a, allocated once
+   by the main thread and never released. */
+
+void* map(long size)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void* buf = sys_mmap(NULL, size, prot, flags, -1, 0);
+	int ret;
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	return buf;
+}
+
 void warnat(const char* msg, struct atf* dd, int err)
 {
 	char path[pathlen(dd)];
@@ -63,7 +97,7 @@ void warnat(const char* msg, struct atf* dd, int err)
 void failat(const char* msg, struct atf* dd, int err)
 {
 	warnat(msg, dd, err);
-	_exit(-1);
+	thread_quit(0xFF);
 }
 
 static void annouce(CCT)
@@ -191,7 +225,7 @@ static void dryerr(CCT, struct atf* dd, int ret)
 	warnat(NULL, dd, ret);
 
 	if(!set(cct, DRY))
-		_exit(-1);
+		thread_quit(0xFF);
 	if(set(cct, OPT_q))
 		return;
 	if(cct->top->errors++ < 10)
@@ -389,6 +423,7 @@ static void directory(CCT)
 	memzero(&next, sizeof(next));
 
 	next.top = cct->top;
+	next.seq = ++cct->top->dirseq;
 	next.dst.at = dst->fd; next.dst.dir = dpath;
 	next.src.at = src->fd; next.src.dir = spath;
 	next.src.fd = -1;
@@ -1,26 +1,46 @@
 #include <sys/file.h>
 #include <sys/fpath.h>
 #include <sys/dents.h>
+#include <sys/mman.h>
 
 #include <string.h>
 #include <printf.h>
 #include <format.h>
+#include <thread.h>
 #include <util.h>
 #include <main.h>
 
-#define OPTS "nfxdZ"
+#define OPTS "nfxdZj"
 #define OPT_n (1<<0)    /* non-recursively */
 #define OPT_f (1<<1)    /* force */
 #define OPT_x (1<<2)    /* cross fs boundaries */
 #define OPT_d (1<<3)    /* rmdir */
 #define OPT_Z (1<<4)    /* no-keep-root */
+#define OPT_j (1<<5)    /* parallel */
 
 #define DEBUFSIZE 2048
 
+#define NWORKERS 8
+#define NCHUNK 1024
+
 ERRTAG("del");
 ERRLIST(NEACCES NEBUSY NEFAULT NEIO NEISDIR NELOOP NENAMETOOLONG NENOENT
 	NENOMEM NENOTDIR NEPERM NEROFS NEINVAL NENOTEMPTY);
 
+struct pool {
+	struct mutex mx;
+	struct condvar more;
+	struct condvar done;
+	int finished;
+	int stop;
+
+	struct node* stack;
+	struct node* free;
+
+	int nthreads;
+	struct thread threads[NWORKERS];
+};
+
 struct top {
 	int opts;
 	int root;
@@ -29,6 +49,8 @@ struct top {
 	uint64_t rino;
 
 	uint64_t sdev; /* starting dir */
+
+	struct pool pool; /* for -j, started once needed */
 };
 
 struct rfn {
@@ -79,7 +101,7 @@ static void failat(CTX, FN, int err)
 
 	if(opts & OPT_f) return;
 
-	_exit(-1);
+	thread_quit(0xFF);
 }
 
 static void stat_root(CTX)
@@ -118,8 +140,9 @@ static int check_xdev(CTX, FN, int fd)
 
 	if(opts & OPT_Z)
 		;
-	else if(st.dev == ctx->rdev && st.ino == ctx->rino)
-		fail("refusing to delete root", NULL, 0);
+	else if(st.dev == ctx->rdev && st.ino == ctx->rino) {
+		thread_fail("refusing to delete root", NULL, 0);
+	}
 
 	if(at == AT_FDCWD) /* top-level invocation */
 		ctx->sdev = st.dev;
@@ -169,6 +192,304 @@ out:
 	sys_close(fd);
 };
 
+/* Parallel mode (-j). Each directory becomes a node, and worker threads
+   take nodes off a shared stack, unlink the files in them and push the
+   subdirectories back as new nodes. A node keeps its fd open and counts
+   its pending children; whoever finishes the last one removes the dir
+   itself and then checks the parent the same way.
+
+   The stack is LIFO so the workers tend to go deep before going wide,
+   which keeps the number of open directory fds close to depth times
+   the number of workers, much like in the sequential code.
+
+   Nodes do not store full paths. Those are only needed for error
+   messages, and get reconstructed from the parent links, which stay
+   valid for as long as any of the children are around. */
+
+struct node {
+	struct node* parent;
+	struct node* next;
+	int pending;
+	int at;
+	int fd;
+	char* name;
+	char nbuf[256];
+};
+
+static char* nodepath(char* p, char* e, struct node* nd)
+{
+	if(!nd)
+		return p;
+
+	p = nodepath(p, e, nd->parent);
+
+	if(nd->parent)
+		p = fmtstr(p, e, "/");
+
+	return fmtstr(p, e, nd->name);
+}
+
+static void failnode(CTX, struct node* nd, int err)
+{
+	FMTBUF(p, e, dir, 4096);
+	p = nodepath(p, e, nd->parent);
+	FMTEND(p, e);
+
+	struct rfn fn = { nd->at, nd->parent ? dir : NULL, nd->name };
+
+	failat(ctx, &fn, err);
+}
+
+/* Nodes are allocated in chunks and never returned to the system,
+   only to the free list. Must be called with the pool mutex held. */
+
+static struct node* alloc_node(struct pool* pl)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	long size = NCHUNK*sizeof(struct node);
+	struct node* nd;
+	int i, ret;
+
+	if(!pl->free) {
+		nd = sys_mmap(NULL, size, prot, flags, -1, 0);
+
+		if((ret = mmap_error(nd)))
+			thread_fail("mmap", NULL, ret);
+
+		for(i = 0; i < NCHUNK; i++) {
+			nd[i].next = pl->free;
+			pl->free = &nd[i];
+		}
+	}
+
+	nd = pl->free;
+	pl->free = nd->next;
+
+	return nd;
+}
+
+static void push_node(struct pool* pl, struct node* nd)
+{
+	nd->next = pl->stack;
+	pl->stack = nd;
+
+	cond_signal(&pl->more);
+}
+
+static void queue_subdir(struct pool* pl, struct node* parent, char* name)
+{
+	struct node* nd;
+	int len = strlen(name);
+
+	mutex_lock(&pl->mx);
+
+	nd = alloc_node(pl);
+
+	nd->parent = parent;
+	nd->pending = 1;
+	nd->at = parent->fd;
+	nd->fd = -1;
+	nd->name = nd->nbuf;
+
+	if(len > sizeof(nd->nbuf) - 1)
+		len = sizeof(nd->nbuf) - 1;
+
+	memcpy(nd->nbuf, name, len);
+	nd->nbuf[len] = '\0';
+
+	parent->pending++;
+
+	push_node(pl, nd);
+
+	mutex_unlock(&pl->mx);
+}
+
+/* The last reference to a node is dropped once its own scan and all
+   of its subdirectories are done. The dir should be empty by then. */
+
+static void release(CTX, struct node* nd)
+{
+	struct pool* pl = &ctx->pool;
+	struct node* parent;
+	int left, ret;
+
+	while(nd) {
+		mutex_lock(&pl->mx);
+		left = --nd->pending;
+		mutex_unlock(&pl->mx);
+
+		if(left)
+			return;
+
+		if(nd->fd >= 0)
+			sys_close(nd->fd);
+		if((ret = sys_unlinkat(nd->at, nd->name, AT_REMOVEDIR)) < 0)
+			failnode(ctx, nd, ret);
+
+		parent = nd->parent;
+
+		mutex_lock(&pl->mx);
+
+		nd->next = pl->free;
+		pl->free = nd;
+
+		if(!parent) {
+			pl->finished = 1;
+			cond_broadcast(&pl->done);
+		}
+
+		mutex_unlock(&pl->mx);
+
+		nd = parent;
+	}
+}
+
+static void scan(CTX, struct node* nd)
+{
+	struct pool* pl = &ctx->pool;
+	int len = DEBUFSIZE;
+	char buf[len];
+	int fd, rd, ret;
+
+	FMTBUF(p, e, dir, 4096);
+	p = nodepath(p, e, nd->parent);
+	FMTEND(p, e);
+
+	struct rfn self = { nd->at, nd->parent ? dir : NULL, nd->name };
+
+	char path[pathlen(&self)];
+	makepath(path, sizeof(path), &self);
+
+	if((fd = sys_openat(AT((&self)), O_DIRECTORY)) < 0) {
+		failat(ctx, &self, fd);
+		goto out;
+	}
+
+	nd->fd = fd;
+
+	if(check_xdev(ctx, &self, fd))
+		goto out;
+
+	struct rfn next = { fd, path, NULL };
+
+	while((rd = sys_getdents(fd, buf, len)) > 0) {
+		char* p = buf;
+		char* e = buf + rd;
+
+		while(p < e) {
+			struct dirent* de = (struct dirent*) p;
+			p += de->reclen;
+
+			if(!de->reclen)
+				break;
+			if(dotddot(de->name))
+				continue;
+
+			next.name = de->name;
+
+			if(de->type == DT_DIR)
+				;
+			else if((ret = sys_unlinkat(AT((&next)), 0)) >= 0)
+				continue;
+			else if(ret != -EISDIR) {
+				failat(ctx, &next, ret);
+				continue;
+			}
+
+			queue_subdir(pl, nd, de->name);
+		}
+	}
+out:
+	release(ctx, nd);
+}
+
+static int worker(void* arg)
+{
+	struct top* ctx = arg;
+	struct pool* pl = &ctx->pool;
+	struct node* nd;
+
+	while(1) {
+		mutex_lock(&pl->mx);
+
+		while(!(nd = pl->stack) && !pl->stop)
+			cond_wait(&pl->more, &pl->mx);
+		if(nd)
+			pl->stack = nd->next;
+
+		mutex_unlock(&pl->mx);
+
+		if(!nd) break;
+
+		scan(ctx, nd);
+	}
+
+	return 0;
+}
+
+static void start_pool(CTX)
+{
+	struct pool* pl = &ctx->pool;
+	int i, ret = 0;
+
+	for(i = 0; i < NWORKERS; i++)
+		if((ret = thread_start(&pl->threads[i], worker, ctx)) < 0)
+			break;
+
+	if(!(pl->nthreads = i))
+		fail("cannot start threads", NULL, ret);
+}
+
+static void stop_pool(CTX)
+{
+	struct pool* pl = &ctx->pool;
+	int i;
+
+	if(!pl->nthreads)
+		return;
+
+	mutex_lock(&pl->mx);
+	pl->stop = 1;
+	cond_broadcast(&pl->more);
+	mutex_unlock(&pl->mx);
+
+	for(i = 0; i < pl->nthreads; i++)
+		thread_join(&pl->threads[i]);
+}
+
+/* Top-level directories get handled one at a time, since check_xdev
+   keeps the starting device in ctx. The root node removes the directory
+   itself once everything below it is gone. */
+
+static void parallel(CTX, FN)
+{
+	struct pool* pl = &ctx->pool;
+	struct node* nd;
+
+	if(!pl->nthreads)
+		start_pool(ctx);
+
+	mutex_lock(&pl->mx);
+
+	nd = alloc_node(pl);
+
+	nd->parent = NULL;
+	nd->pending = 1;
+	nd->at = fn->at;
+	nd->fd = -1;
+	nd->name = fn->name;
+
+	pl->finished = 0;
+
+	push_node(pl, nd);
+
+	while(!pl->finished)
+		cond_wait(&pl->done, &pl->mx);
+
+	mutex_unlock(&pl->mx);
+}
+
 static void delete(CTX, FN, int type)
 {
 	int ret;
@@ -186,6 +507,8 @@ static void delete(CTX, FN, int type)
 dir:
 	if(opts & OPT_n)
 		goto rmd;
+	if(opts & OPT_j)
+		return parallel(ctx, fn);
 
 	enter(ctx, fn);
 rmd:
@@ -216,5 +539,7 @@ int main(int argc, char** argv)
 		delete(&ctx, &fn, DT_UNKNOWN);
 	}
 
+	stop_pool(&ctx);
+
 	return 0;
 }
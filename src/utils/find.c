@@ -1,13 +1,17 @@
 #include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/dents.h>
+#include <sys/fprop.h>
 
 #include <string.h>
+#include <thread.h>
 #include <format.h>
 #include <output.h>
 #include <util.h>
 #include <main.h>
 
+#include "find.h"
+
 /* This tool expects the search to return much less than complete subtree
    list, and preferably with fast output start. This sets it apart from
    some kind of ls -r | grep combo, which otherwise would have been
@@ -18,7 +22,11 @@
 
    Having DT_UNKNOWN in getdents output reduces efficiency a lot,
    as we have to stat() all entries, but the only way around it
-   is to drop sorting. */
+   is to drop sorting.
+
+   For repeated searches over the same tree, the sorted listings may be
+   kept in an index file (-c, see find_index.c). Directories whose mtime
+   has not changed get listed from there instead of being read. */
 
 ERRTAG("find");
 
@@ -40,48 +48,6 @@ ERRTAG("find");
    output, because anything under a given dir shares the same prefix
    and will get sorted exactly where the dir itself would be. */
 
-#define PAGE 4096
-
-#define OPTS "i"
-#define OPT_i (1<<0)
-
-#define MFILE 0
-#define MDIR 1
-
-struct shortent {
-	short len;
-	short pre;
-	char isdir;
-	char name[];
-};
-
-struct pattern {
-	char* name;
-	int len;
-	int where;
-};
-
-struct top {
-	int opts;
-	void* ptr;
-	void* brk;
-	struct pattern* patt;
-	int pcnt;
-	struct bufout bo;
-};
-
-struct dir {
-	struct top* tc;
-	int fd;
-	char* dir;
-	int count;
-	struct shortent* ents;
-	struct shortent** idx;
-};
-
-#define TC struct top* tc
-#define DC struct dir* dc
-
 static char dirbuf[2*PAGE];
 static char outbuf[PAGE];
 
@@ -113,12 +79,12 @@ static void* setbrk(void* old, int incr)
 	void* ptr = sys_brk(old + incr);
 
 	if(brk_error(old, ptr))
-		fail("out of memory", NULL, 0);
+		thread_fail("out of memory", NULL, 0);
 
 	return ptr;
 }
 
-static void* extend(TC, int size)
+void* extend(TC, int size)
 {
 	if(tc->brk - tc->ptr < size) {
 		int aligned = size + (PAGE - size % PAGE);
@@ -130,6 +96,33 @@ static void* extend(TC, int size)
 	return ret;
 }
 
+/* Worker threads cannot touch the brk heap, so they list directories
+   into fixed-size private buffers instead. If the listing does not fit,
+   the main thread will have to re-do it. */
+
+static void* alloc(DC, int size)
+{
+	void* ret;
+
+	if(!dc->end)
+		return extend(dc->tc, size);
+
+	if(dc->end - dc->ptr < size) {
+		dc->full = 1;
+		return NULL;
+	}
+
+	ret = dc->ptr;
+	dc->ptr += size;
+
+	return ret;
+}
+
+void* dirptr(DC)
+{
+	return dc->end ? dc->ptr : dc->tc->ptr;
+}
+
 static int pathsize(DC, char* name)
 {
 	if(dc->dir)
@@ -138,17 +131,20 @@ static int pathsize(DC, char* name)
 		return strlen(name) + 1;
 }
 
-static void enqueue(DC, char* name, int isdir)
+struct shortent* enqueue(DC, char* name, int isdir)
 {
-	struct top* tc = dc->tc;
-
 	int pathlen = pathsize(dc, name);
 	int size = sizeof(struct shortent) + pathlen;
 
-	struct shortent* se = extend(tc, size);
+	struct shortent* se;
+
+	if(!(se = alloc(dc, size)))
+		return NULL;
 
 	se->isdir = isdir;
 	se->len = size;
+	se->sub = 0;
+	se->job = NULL;
 
 	char* p = se->name;
 	char* e = p + pathlen - 1;
@@ -165,36 +161,32 @@ static void enqueue(DC, char* name, int isdir)
 	*p++ = '\0';
 
 	dc->count++;
+
+	return se;
 }
 
+/* With the index in use, all entries get listed since the next search
+   may well be for some other pattern. Matching happens on output then. */
+
 static void check_file(DC, char* name)
 {
 	struct top* tc = dc->tc;
-	int namelen = strlen(name);
-	int i;
-
-	for(i = 0; i < tc->pcnt; i++) {
-		struct pattern* p = &tc->patt[i];
-
-		if(p->len > namelen)
-			continue;
-
-		char* anchor = p->where ? name + namelen - p->len : name;
-
-		if(strncmp(anchor, p->name, p->len))
-			continue;
 
+	if(tc->ix || matches(tc, name))
 		enqueue(dc, name, MFILE);
-		break;
-	}
 }
 
 static void check_stat(DC, char* name)
 {
-	(void)dc;
-	(void)name;
+	struct stat st;
+	int flags = AT_SYMLINK_NOFOLLOW;
 
-	fail("not implemented", NULL, 0);
+	if(sys_fstatat(dc->fd, name, &st, flags) < 0)
+		check_file(dc, name);
+	else if(S_ISDIR(st.mode))
+		enqueue(dc, name, MDIR);
+	else
+		check_file(dc, name);
 }
 
 static void check_dent(DC, struct dirent* de)
@@ -210,16 +202,15 @@ static void check_dent(DC, struct dirent* de)
 		check_file(dc, name);
 }
 
-static void read_scan(DC, int fd)
+static int read_scan(DC, char* dbuf, long dblen)
 {
-	char* dir = dc->dir;
-	long dblen = sizeof(dirbuf);
+	int fd = dc->fd;
 	long ret;
 
-	dc->ents = (struct shortent*) dc->tc->ptr;
+	dc->ents = (struct shortent*) dirptr(dc);
 
-	while((ret = sys_getdents(fd, dirbuf, dblen)) > 0) {
-		void* ptr = dirbuf;
+	while((ret = sys_getdents(fd, dbuf, dblen)) > 0) {
+		void* ptr = dbuf;
 		void* end = ptr + ret;
 
 		while(ptr < end) {
@@ -237,18 +228,10 @@ static void read_scan(DC, int fd)
 		}
 
 		if(ret < dblen - PAGE)
-			return;
+			return 0;
 	}
 
-	if(ret < 0) fail("cannot read entries from", dir, ret);
-}
-
-static int cmpidx(void* a, void* b)
-{
-	struct shortent* pa = a;
-	struct shortent* pb = b;
-
-	return strcmp(pa->name, pb->name);
+	return ret;
 }
 
 struct shortent* next_shortent(struct shortent* p)
@@ -257,13 +240,18 @@ struct shortent* next_shortent(struct shortent* p)
 	return (struct shortent*)(q + p->len);
 }
 
-static void index_entries(DC)
-{
-	struct top* tc = dc->tc;
+/* All entries in a listing share the same dir/ prefix, so the sort key
+   starts past it. Otherwise qsorts() would go one level deeper for each
+   character of the prefix before getting to the names. */
 
+static void index_entries(DC, int sort)
+{
 	int nents = dc->count;
 	int size = nents * sizeof(void*);
-	dc->idx = (struct shortent**) extend(tc, size);
+	int off = offsetof(struct shortent, name);
+
+	if(!(dc->idx = (struct shortent**) alloc(dc, size)))
+		return;
 
 	struct shortent* p = dc->ents;
 	int i;
@@ -273,33 +261,73 @@ static void index_entries(DC)
 		p = next_shortent(p);
 	}
 
-	qsortp(dc->idx, nents, cmpidx);
-}
+	if(!sort || !nents)
+		return;
 
-static void scan_dir(TC, int at, char* openname, char* dirname);
+	qsorts(dc->idx, nents, off + dc->idx[0]->pre);
+}
 
-static void print_indexed(DC)
+void print_indexed(DC)
 {
 	struct top* tc = dc->tc;
 	int at = dc->fd;
 
+	if(tc->pool)
+		prefetch(dc);
+
 	for(int i = 0; i < dc->count; i++) {
 		struct shortent* se = dc->idx[i];
 
-		if(se->isdir)
-			scan_dir(tc, at, se->name + se->pre, se->name);
-		else
+		if(se->job)
+			se->sub = use_job(tc, se);
+		else if(se->isdir)
+			se->sub = scan_dir(tc, at, se->name + se->pre, se->name, se->sub);
+		else if(!tc->ix || matches(tc, se->name + se->pre))
 			outstrnl(tc, se->name);
 	}
 }
 
-static void scan_dir(TC, int at, char* openname, char* listname)
+/* Get the sorted listing of an open directory, either by reading it
+   or from the index. Called from worker threads as well, so errors
+   are returned instead of being reported. */
+
+int list_dir(DC, struct stat* st, uint old, char* dbuf, int dblen)
+{
+	struct top* tc = dc->tc;
+	int ret;
+
+	if(!tc->ix) {
+		ret = read_scan(dc, dbuf, dblen);
+		index_entries(dc, 1);
+	} else if(sys_fstat(dc->fd, st) < 0) {
+		memzero(st, sizeof(*st));
+		ret = read_scan(dc, dbuf, dblen);
+		index_entries(dc, 1);
+	} else if(cached_dir(dc, st, old)) {
+		ret = 0;
+		index_entries(dc, 0);
+	} else {
+		ret = read_scan(dc, dbuf, dblen);
+		index_entries(dc, 1);
+		match_cached(dc, old);
+	}
+
+	return ret;
+}
+
+/* The value returned is the location of the new index record for this
+   directory, and old is that of the record from the previous run. Both
+   are 0 without the index. */
+
+uint scan_dir(TC, int at, char* openname, char* listname, uint old)
 {
-	int fd;
+	struct stat st;
+	uint rec = 0;
+	int fd, ret;
 	void* ptr;
 
 	if((fd = sys_openat(at, openname, O_DIRECTORY)) < 0)
-		return;
+		return 0;
 
 	struct dir dc = {
 		.tc = tc,
@@ -312,27 +340,19 @@ static void scan_dir(TC, int at, char* openname, char* listname)
 
 	ptr = tc->ptr;
 
-	read_scan(&dc, fd);
+	if((ret = list_dir(&dc, &st, old, dirbuf, sizeof(dirbuf))) < 0)
+		thread_fail("cannot read entries from", listname, ret);
 
-	index_entries(&dc);
 	print_indexed(&dc);
 
+	if(tc->ix)
+		rec = store_dir(&dc, &st);
+
 	sys_close(fd);
 
 	tc->ptr = ptr;
-}
 
-static void prep_patterns(TC, int argc, char** argv)
-{
-	int i;
-
-	for(i = 0; i < argc; i++) {
-		char* argi = argv[i];
-		struct pattern* p = &tc->patt[i];
-		p->name = argi;
-		p->len = strlen(argi);
-		p->where = (*argi == '.');
-	}
+	return rec;
 }
 
 int main(int argc, char** argv)
@@ -340,18 +360,20 @@ int main(int argc, char** argv)
 	int opts = 0;
 	int i = 1;
 	char* start = NULL;
+	char* cache = NULL;
+	uint root, old = 0;
 
 	struct top context, *tc = &context;
-	struct pattern patt[argc];
 
 	memzero(tc, sizeof(*tc));
 
 	if(i < argc && argv[i][0] == '-')
 		opts = argbits(OPTS, argv[i++] + 1);
 
-	if(opts & OPT_i)
+	if((opts & OPT_i) && i < argc)
 		start = argv[i++];
-
+	if((opts & OPT_c) && i < argc)
+		cache = argv[i++];
 	if(i >= argc)
 		fail("need names to search", NULL, 0);
 
@@ -361,18 +383,27 @@ int main(int argc, char** argv)
 	tc->opts = opts;
 	tc->ptr = setbrk(NULL, 0);
 	tc->brk = setbrk(tc->ptr, PAGE);
-	tc->patt = patt;
-	tc->pcnt = argc;
 
 	init_output(tc);
 	prep_patterns(tc, argc, argv);
 
+	if(opts & OPT_j)
+		start_pool(tc);
+
+	if(cache)
+		old = open_index(tc, cache, start ? start : ".");
+
 	if(start)
-		scan_dir(tc, AT_FDCWD, start, start);
+		root = scan_dir(tc, AT_FDCWD, start, start, old);
 	else
-		scan_dir(tc, AT_FDCWD, ".", NULL);
+		root = scan_dir(tc, AT_FDCWD, ".", NULL, old);
 
 	fini_outout(tc);
 
+	if(cache)
+		save_index(tc, root);
+
+	stop_pool(tc);
+
 	return 0;
 }
@@ -0,0 +1,73 @@
+#define PAGE 4096
+
+#define OPTS "icjI"
+#define OPT_i (1<<0)
+#define OPT_c (1<<1)
+#define OPT_j (1<<2)
+#define OPT_I (1<<3)
+
+#define MFILE 0
+#define MDIR 1
+
+struct shortent {
+	short len;
+	short pre;
+	char isdir;
+	uint sub;
+	struct job* job;
+	char name[];
+};
+
+struct index;
+struct match;
+struct pool;
+struct job;
+
+struct top {
+	int opts;
+	void* ptr;
+	void* brk;
+	struct match* match;
+	struct bufout bo;
+	struct index* ix;
+	struct pool* pool;
+};
+
+struct dir {
+	struct top* tc;
+	int fd;
+	char* dir;
+	int count;
+	struct shortent* ents;
+	struct shortent** idx;
+
+	void* ptr;     /* private buffer, for directories listed */
+	void* end;     /* by worker threads; NULL otherwise */
+	int full;
+};
+
+#define TC struct top* tc
+#define DC struct dir* dc
+
+void* extend(TC, int size);
+void* dirptr(DC);
+
+void prep_patterns(TC, int argc, char** argv);
+int matches(TC, char* name);
+struct shortent* enqueue(DC, char* name, int isdir);
+
+int list_dir(DC, struct stat* st, uint old, char* dbuf, int dblen);
+void print_indexed(DC);
+uint scan_dir(TC, int at, char* openname, char* listname, uint old);
+
+uint open_index(TC, char* name, char* start);
+void save_index(TC, uint root);
+
+int cached_dir(DC, struct stat* st, uint old);
+void match_cached(DC, uint old);
+uint store_dir(DC, struct stat* st);
+
+void start_pool(TC);
+void stop_pool(TC);
+void prefetch(DC);
+uint use_job(TC, struct shortent* se);
@@ -0,0 +1,418 @@
+#include <sys/file.h>
+#include <sys/dents.h>
+#include <sys/fpath.h>
+#include <sys/fprop.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include <string.h>
+#include <format.h>
+#include <output.h>
+#include <util.h>
+
+#include "find.h"
+
+/* Persistent directory index for find -c. The file holds one record
+   per directory, with the complete sorted listing, and the dev, ino,
+   mtime and ctime of the directory at the time it was read. Subdirectory
+   entries point to their own records, so the old index gets walked along
+   with the tree and no lookups by path are necessary.
+
+   If a directory has the same mtime as in the index, its listing gets
+   taken from there, already sorted and with all the types known. Any
+   change in the entries updates the mtime. Trees restored by tar or
+   rsync often have lots of directories with the same mtime though, and
+   swapping two of those would not show in mtimes alone, so dev, ino and
+   ctime must match as well. Directories that do change get read again,
+   and their subdirectories get matched by name against the old listing
+   so that unchanged subtrees still come from the index.
+
+   Timestamps have limited resolution, so a directory modified shortly
+   before being read may get modified again without any visible change
+   in mtime. Records for directories with recent mtimes or ctimes are
+   stored with zero time, and always get re-read.
+
+   A new index gets built in memory during the search and replaces the
+   old one afterwards. The format is host-specific; any mismatch in the
+   header, or records pointing out of bounds, just mean a full rescan. */
+
+#define MAGIC "FNDX"
+#define VERSION 2
+
+struct ihead {
+	char magic[4];
+	uint32_t version;
+	uint32_t root;
+	uint32_t size;
+	char start[];
+};
+
+struct irec {
+	uint32_t size;
+	uint32_t count;
+	uint64_t dev;
+	uint64_t ino;
+	int64_t sec;
+	int64_t nsec;
+	int64_t csec;
+	int64_t cnsec;
+};
+
+struct ient {
+	uint32_t sub;
+	uint16_t len;
+	uint8_t isdir;
+	uint8_t pad;
+	char name[];
+};
+
+struct index {
+	char* name;
+	struct timespec now;
+
+	void* old;
+	uint oldsize;
+
+	char* buf;
+	uint size;
+	uint ptr;
+	int bad;
+};
+
+static struct index index;
+
+static int align(int len, int to)
+{
+	return len + (to - len % to) % to;
+}
+
+static void* reserve(struct index* ix, uint len)
+{
+	void* ptr;
+
+	if(ix->bad)
+		return NULL;
+
+	if(ix->ptr + len > ix->size) {
+		uint size = ix->size;
+		void* buf;
+
+		while(ix->ptr + len > size)
+			size *= 2;
+
+		buf = sys_mremap(ix->buf, ix->size, size, MREMAP_MAYMOVE);
+
+		if(mmap_error(buf)) {
+			ix->bad = 1;
+			return NULL;
+		}
+
+		ix->buf = buf;
+		ix->size = size;
+	}
+
+	ptr = ix->buf + ix->ptr;
+	ix->ptr += len;
+
+	return ptr;
+}
+
+static void load_old(struct index* ix, char* start)
+{
+	struct stat st;
+	struct ihead* hd;
+	int fd, ret;
+	void* buf;
+
+	if((fd = sys_open(ix->name, O_RDONLY)) < 0)
+		return;
+	if((ret = sys_fstat(fd, &st)) < 0)
+		goto out;
+	if(st.size < (int)sizeof(*hd) || st.size > 0x7FFFFFFF)
+		goto out;
+
+	buf = sys_mmap(NULL, st.size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if(mmap_error(buf))
+		goto out;
+
+	hd = buf;
+
+	if(memcmp(hd->magic, MAGIC, 4) || hd->version != VERSION)
+		goto unmap;
+	if(hd->size != st.size)
+		goto unmap;
+	if(strncmp(hd->start, start, st.size - sizeof(*hd)))
+		goto unmap;
+
+	ix->old = buf;
+	ix->oldsize = st.size;
+
+	goto out;
+unmap:
+	sys_munmap(buf, st.size);
+out:
+	sys_close(fd);
+}
+
+uint open_index(TC, char* name, char* start)
+{
+	struct index* ix = &index;
+	int slen = strlen(start) + 1;
+	int hlen = align(sizeof(struct ihead) + slen, 8);
+	struct ihead* hd;
+
+	tc->ix = ix;
+	ix->name = name;
+
+	sys_clock_gettime(CLOCK_REALTIME, &ix->now);
+
+	ix->size = 16*PAGE;
+	ix->buf = sys_mmap(NULL, ix->size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(mmap_error(ix->buf))
+		fail("mmap", NULL, (long)ix->buf);
+
+	hd = reserve(ix, hlen);
+
+	memcpy(hd->magic, MAGIC, 4);
+	hd->version = VERSION;
+	memcpy(hd->start, start, slen);
+
+	load_old(ix, start);
+
+	if(!ix->old)
+		return 0;
+
+	return ((struct ihead*)ix->old)->root;
+}
+
+/* Old records are used as is, but only after checking that they fit
+   within the file and their entries fit within the records. */
+
+/* Entry names get used as openat() paths, so anything that would not
+   come from getdents is taken as a sign of a damaged index. */
+
+static int bad_name(char* name)
+{
+	if(!name[0])
+		return 1;
+	if(dotddot(name))
+		return 1;
+	if(*strcbrk(name, '/'))
+		return 1;
+
+	return 0;
+}
+
+static struct irec* get_record(struct index* ix, uint off)
+{
+	struct irec* rec;
+
+	if(!off || !ix->old)
+		return NULL;
+	if(off % 8 || off + sizeof(*rec) > ix->oldsize)
+		return NULL;
+
+	rec = ix->old + off;
+
+	if(rec->size < sizeof(*rec) || rec->size > ix->oldsize - off)
+		return NULL;
+
+	void* p = (void*)(rec + 1);
+	void* e = (void*)rec + rec->size;
+	uint i;
+
+	for(i = 0; i < rec->count; i++) {
+		struct ient* en = p;
+
+		if(p + sizeof(*en) >= e)
+			return NULL;
+		if(en->len <= sizeof(*en) || en->len > e - p)
+			return NULL;
+		if(((char*)p)[en->len - 1])
+			return NULL;
+		if(bad_name(en->name))
+			return NULL;
+
+		p += en->len;
+	}
+
+	return rec;
+}
+
+static struct ient* first_entry(struct irec* rec)
+{
+	return (struct ient*)(rec + 1);
+}
+
+static struct ient* next_entry(struct ient* en)
+{
+	return (void*)en + en->len;
+}
+
+int cached_dir(DC, struct stat* st, uint old)
+{
+	struct index* ix = dc->tc->ix;
+	struct irec* rec;
+	struct ient* en;
+	uint i;
+
+	if(!(rec = get_record(ix, old)))
+		return 0;
+	if(!rec->sec && !rec->nsec)
+		return 0;
+	if(rec->sec != st->mtime.sec || rec->nsec != st->mtime.nsec)
+		return 0;
+	if(rec->csec != st->ctime.sec || rec->cnsec != st->ctime.nsec)
+		return 0;
+	if(rec->dev != st->dev || rec->ino != st->ino)
+		return 0;
+
+	dc->ents = (struct shortent*) dirptr(dc);
+
+	for(i = 0, en = first_entry(rec); i < rec->count; i++, en = next_entry(en)) {
+		struct shortent* se = enqueue(dc, en->name, en->isdir);
+
+		if(!se) break;
+
+		se->sub = en->isdir ? en->sub : 0;
+	}
+
+	return 1;
+}
+
+/* The listing in the index is sorted the same way as dc->idx,
+   so the entries can be matched in a single pass. */
+
+void match_cached(DC, uint old)
+{
+	struct index* ix = dc->tc->ix;
+	struct irec* rec;
+	struct ient* en;
+	uint j = 0;
+	int i, cmp;
+
+	if(!(rec = get_record(ix, old)))
+		return;
+
+	en = first_entry(rec);
+
+	for(i = 0; i < dc->count && j < rec->count; ) {
+		struct shortent* se = dc->idx[i];
+
+		if((cmp = strcmp(se->name + se->pre, en->name)) < 0) {
+			i++;
+			continue;
+		} else if(cmp > 0) {
+			en = next_entry(en);
+			j++;
+			continue;
+		}
+
+		if(se->isdir && en->isdir)
+			se->sub = en->sub;
+
+		i++;
+		j++;
+		en = next_entry(en);
+	}
+}
+
+static int recent(struct index* ix, struct stat* st)
+{
+	if(st->mtime.sec + 1 >= ix->now.sec)
+		return 1;
+	if(st->ctime.sec + 1 >= ix->now.sec)
+		return 1;
+
+	return 0;
+}
+
+uint store_dir(DC, struct stat* st)
+{
+	struct index* ix = dc->tc->ix;
+	uint size = sizeof(struct irec);
+	uint off = ix->ptr;
+	struct irec* rec;
+	int i;
+
+	for(i = 0; i < dc->count; i++) {
+		struct shortent* se = dc->idx[i];
+		int nlen = strlen(se->name + se->pre) + 1;
+
+		size += align(sizeof(struct ient) + nlen, 4);
+	}
+
+	size = align(size, 8);
+
+	if(!(rec = reserve(ix, size)))
+		return 0;
+
+	memzero(rec, size);
+
+	rec->size = size;
+	rec->count = dc->count;
+
+	if(!recent(ix, st)) {
+		rec->dev = st->dev;
+		rec->ino = st->ino;
+		rec->sec = st->mtime.sec;
+		rec->nsec = st->mtime.nsec;
+		rec->csec = st->ctime.sec;
+		rec->cnsec = st->ctime.nsec;
+	}
+
+	struct ient* en = first_entry(rec);
+
+	for(i = 0; i < dc->count; i++) {
+		struct shortent* se = dc->idx[i];
+		char* name = se->name + se->pre;
+		int nlen = strlen(name) + 1;
+
+		en->sub = se->isdir ? se->sub : 0;
+		en->isdir = se->isdir;
+		en->len = align(sizeof(*en) + nlen, 4);
+		memcpy(en->name, name, nlen);
+
+		en = next_entry(en);
+	}
+
+	return off;
+}
+
+void save_index(TC, uint root)
+{
+	struct index* ix = tc->ix;
+	struct ihead* hd = (struct ihead*)ix->buf;
+	char* name = ix->name;
+	int fd, ret;
+
+	if(ix->bad)
+		return warn("index too large, not saved", NULL, 0);
+
+	hd->root = root;
+	hd->size = ix->ptr;
+
+	FMTBUF(p, e, tmp, strlen(name) + 10);
+	p = fmtstr(p, e, name);
+	p = fmtstr(p, e, ".new");
+	FMTEND(p, e);
+
+	if((fd = sys_open3(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+		return warn(NULL, tmp, fd);
+
+	if((ret = writeall(fd, ix->buf, ix->ptr)) < 0)
+		goto fail;
+	if((ret = sys_rename(tmp, name)) < 0)
+		goto fail;
+
+	sys_close(fd);
+
+	return;
+fail:
+	warn(NULL, tmp, ret);
+	sys_unlinkat(AT_FDCWD, tmp, 0);
+	sys_close(fd);
+}
@@ -0,0 +1,276 @@
+#include <sys/file.h>
+
+#include <string.h>
+#include <output.h>
+#include <util.h>
+
+#include "find.h"
+
+/* Name matching for find. Plain patterns match at the start of the name,
+   or at the end if they start with a dot. Patterns with wildcards in them
+   (* ? [...]) are globs and must match the whole name.
+
+   All the prefix patterns get compiled into a single trie, and so do
+   the suffixes, reversed. Checking a name against any number of them
+   takes one walk from the start and one from the end, each no longer
+   than the name itself. Globs are expected to be few and get tried one
+   by one. With -I, both patterns and names are folded to lower case
+   (ASCII only). */
+
+struct tnode {
+	int child;
+	int next;
+	byte ch;
+	byte term;
+};
+
+struct trie {
+	struct tnode* nodes;
+	int count;
+};
+
+struct match {
+	int fold;
+	struct trie pre;
+	struct trie suf;
+	int nglobs;
+	char** globs;
+};
+
+static int fold(int c, int on)
+{
+	if(on && c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+
+	return c;
+}
+
+static int isglob(char* s)
+{
+	for(; *s; s++)
+		if(*s == '*' || *s == '?' || *s == '[')
+			return 1;
+
+	return 0;
+}
+
+static int child(struct trie* tr, int n, int c)
+{
+	struct tnode* nodes = tr->nodes;
+	int i;
+
+	for(i = nodes[n].child; i; i = nodes[i].next)
+		if(nodes[i].ch == c)
+			return i;
+
+	return 0;
+}
+
+static void insert(struct trie* tr, char* s, int len, int dir, int fc)
+{
+	struct tnode* nodes = tr->nodes;
+	char* p = dir > 0 ? s : s + len - 1;
+	int n = 0, i, k;
+
+	for(i = 0; i < len; i++, p += dir) {
+		int c = fold(*p & 0xFF, fc);
+
+		if((k = child(tr, n, c))) {
+			n = k;
+			continue;
+		}
+
+		k = tr->count++;
+
+		nodes[k].ch = c;
+		nodes[k].term = 0;
+		nodes[k].child = 0;
+		nodes[k].next = nodes[n].child;
+		nodes[n].child = k;
+
+		n = k;
+	}
+
+	nodes[n].term = 1;
+}
+
+static int walk(struct trie* tr, char* s, int len, int dir, int fc)
+{
+	struct tnode* nodes = tr->nodes;
+	char* p = dir > 0 ? s : s + len - 1;
+	int n = 0, i;
+
+	if(!tr->count)
+		return 0;
+	if(nodes[0].term)
+		return 1;
+
+	for(i = 0; i < len; i++, p += dir) {
+		if(!(n = child(tr, n, fold(*p & 0xFF, fc))))
+			return 0;
+		if(nodes[n].term)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Character class, *pp points right past the opening [.
+   On return it points past the closing ], or gets zeroed if
+   there's no closing bracket and [ should be taken literally. */
+
+static int inclass(char** pp, int c, int fc)
+{
+	char* p = *pp;
+	int neg = 0, hit = 0;
+
+	if(*p == '!' || *p == '^') {
+		neg = 1;
+		p++;
+	}
+
+	do {
+		if(!*p) {
+			*pp = NULL;
+			return 0;
+		}
+
+		int lo = fold(*p++ & 0xFF, fc);
+		int hi = lo;
+
+		if(p[0] == '-' && p[1] && p[1] != ']') {
+			hi = fold(p[1] & 0xFF, fc);
+			p += 2;
+		}
+
+		if(c >= lo && c <= hi)
+			hit = 1;
+	} while(*p != ']');
+
+	*pp = p + 1;
+
+	return hit ^ neg;
+}
+
+/* Iterative glob matching, backtracking only to the last *. */
+
+static int glob(char* pat, char* s, int fc)
+{
+	char* sp = NULL;
+	char* ss = NULL;
+	char* q;
+	int c;
+
+	while(*s) {
+		c = fold(*s & 0xFF, fc);
+
+		if(*pat == '*') {
+			sp = ++pat;
+			ss = s;
+			continue;
+		}
+
+		if(*pat == '?') {
+			pat++;
+			s++;
+			continue;
+		}
+
+		if(*pat == '[') {
+			q = pat + 1;
+
+			if(inclass(&q, c, fc)) {
+				pat = q;
+				s++;
+				continue;
+			} else if(q) {
+				goto back;
+			}
+		}
+
+		if(*pat && fold(*pat & 0xFF, fc) == c) {
+			pat++;
+			s++;
+			continue;
+		}
+back:
+		if(!sp)
+			return 0;
+
+		pat = sp;
+		s = ++ss;
+	}
+
+	while(*pat == '*')
+		pat++;
+
+	return !*pat;
+}
+
+int matches(TC, char* name)
+{
+	struct match* mt = tc->match;
+	int len = strlen(name);
+	int i;
+
+	if(walk(&mt->pre, name, len, 1, mt->fold))
+		return 1;
+	if(walk(&mt->suf, name, len, -1, mt->fold))
+		return 1;
+
+	for(i = 0; i < mt->nglobs; i++)
+		if(glob(mt->globs[i], name, mt->fold))
+			return 1;
+
+	return 0;
+}
+
+static void init_trie(TC, struct trie* tr, int size)
+{
+	tr->nodes = extend(tc, (size + 1)*sizeof(struct tnode));
+	tr->count = 0;
+}
+
+void prep_patterns(TC, int argc, char** argv)
+{
+	struct match* mt = extend(tc, sizeof(*mt));
+	int fc = tc->opts & OPT_I;
+	int npre = 0, nsuf = 0;
+	int i;
+
+	memzero(mt, sizeof(*mt));
+
+	mt->fold = fc;
+	mt->globs = extend(tc, argc*sizeof(char*));
+
+	for(i = 0; i < argc; i++) {
+		char* argi = argv[i];
+		int len = strlen(argi);
+
+		if(isglob(argi))
+			mt->globs[mt->nglobs++] = argi;
+		else if(*argi == '.')
+			nsuf += len;
+		else
+			npre += len;
+	}
+
+	init_trie(tc, &mt->pre, npre);
+	init_trie(tc, &mt->suf, nsuf);
+
+	for(i = 0; i < argc; i++) {
+		char* argi = argv[i];
+		int len = strlen(argi);
+		struct trie* tr = (*argi == '.') ? &mt->suf : &mt->pre;
+		int dir = (*argi == '.') ? -1 : 1;
+
+		if(isglob(argi))
+			continue;
+		if(!tr->count)
+			tr->count = 1; /* root */
+
+		insert(tr, argi, len, dir, fc);
+	}
+
+	tc->match = mt;
+}
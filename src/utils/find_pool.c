@@ -0,0 +1,246 @@
+#include <sys/file.h>
+#include <sys/fprop.h>
+
+#include <string.h>
+#include <output.h>
+#include <thread.h>
+#include <util.h>
+
+#include "find.h"
+
+/* Read-ahead for find -j. Output still comes from the main thread in
+   the usual order, but whenever it starts on a directory listing, the
+   subdirectories in it get queued for the workers to open, read and
+   sort. By the time the main thread gets to them, the listings should
+   be ready or at least in progress.
+
+   The queue is a stack, and the subdirectories get pushed in reverse,
+   so the workers take them in the order the main thread will need them,
+   with the deepest ones first.
+
+   Listings are made into fixed-size job buffers, and the number of jobs
+   is limited. Subdirectories that do not get a job slot, or do not fit
+   into one, are listed by the main thread itself as before. */
+
+#define NJOBS 64
+#define JOBBUF (64*1024)
+#define MAXWORKERS 16
+
+struct job {
+	struct job* next;
+	int done;
+
+	int at;
+	char* name;
+	char* path;
+	uint old;
+
+	int fd;
+	int err;
+	struct stat st;
+	struct dir dc;
+	void* buf;
+};
+
+struct pool {
+	struct top* tc;
+
+	struct mutex mx;
+	struct condvar more;
+	struct condvar done;
+	int stop;
+
+	struct job* stack;
+	struct job* free;
+
+	int nthreads;
+	struct thread threads[MAXWORKERS];
+	struct job jobs[NJOBS];
+};
+
+static void run_job(struct pool* pl, struct job* jb)
+{
+	char dbuf[2*PAGE];
+	int fd;
+
+	if((fd = sys_openat(jb->at, jb->name, O_DIRECTORY)) < 0)
+		goto out;
+
+	struct dir* dc = &jb->dc;
+
+	memzero(dc, sizeof(*dc));
+
+	dc->tc = pl->tc;
+	dc->fd = fd;
+	dc->dir = jb->path;
+	dc->ptr = jb->buf;
+	dc->end = jb->buf + JOBBUF;
+
+	jb->err = list_dir(dc, &jb->st, jb->old, dbuf, sizeof(dbuf));
+out:
+	jb->fd = fd;
+
+	mutex_lock(&pl->mx);
+	jb->done = 1;
+	cond_broadcast(&pl->done);
+	mutex_unlock(&pl->mx);
+}
+
+static int worker(void* arg)
+{
+	struct pool* pl = arg;
+	struct job* jb;
+
+	while(1) {
+		mutex_lock(&pl->mx);
+
+		while(!(jb = pl->stack) && !pl->stop)
+			cond_wait(&pl->more, &pl->mx);
+		if(jb)
+			pl->stack = jb->next;
+
+		mutex_unlock(&pl->mx);
+
+		if(!jb) break;
+
+		run_job(pl, jb);
+	}
+
+	return 0;
+}
+
+/* The pool and the job buffers come from the brk heap. Nothing below
+   them ever gets released, and only the main thread grows the heap. */
+
+void start_pool(TC)
+{
+	struct pool* pl = extend(tc, sizeof(*pl));
+	char* bufs = extend(tc, NJOBS*JOBBUF);
+	int i, n, ret = 0;
+
+	memzero(pl, sizeof(*pl));
+
+	pl->tc = tc;
+
+	for(i = NJOBS - 1; i >= 0; i--) {
+		struct job* jb = &pl->jobs[i];
+
+		jb->buf = bufs + i*JOBBUF;
+		jb->next = pl->free;
+		pl->free = jb;
+	}
+
+	if((n = thread_cpus()) < 4)
+		n = 4;
+	if(n > MAXWORKERS)
+		n = MAXWORKERS;
+
+	for(i = 0; i < n; i++)
+		if((ret = thread_start(&pl->threads[i], worker, pl)) < 0)
+			break;
+
+	if(!(pl->nthreads = i))
+		fail("cannot start threads", NULL, ret);
+
+	tc->pool = pl;
+}
+
+void stop_pool(TC)
+{
+	struct pool* pl = tc->pool;
+	int i;
+
+	if(!pl)
+		return;
+
+	mutex_lock(&pl->mx);
+	pl->stop = 1;
+	cond_broadcast(&pl->more);
+	mutex_unlock(&pl->mx);
+
+	for(i = 0; i < pl->nthreads; i++)
+		thread_join(&pl->threads[i]);
+}
+
+void prefetch(DC)
+{
+	struct pool* pl = dc->tc->pool;
+	struct shortent* se;
+	struct job* jb;
+	int i, last = -1;
+
+	mutex_lock(&pl->mx);
+
+	for(i = 0; i < dc->count && pl->free; i++) {
+		if(!(se = dc->idx[i])->isdir)
+			continue;
+
+		jb = pl->free;
+		pl->free = jb->next;
+
+		jb->done = 0;
+		jb->at = dc->fd;
+		jb->name = se->name + se->pre;
+		jb->path = se->name;
+		jb->old = se->sub;
+
+		se->job = jb;
+		last = i;
+	}
+
+	for(i = last; i >= 0; i--) {
+		if(!(jb = dc->idx[i]->job))
+			continue;
+
+		jb->next = pl->stack;
+		pl->stack = jb;
+
+		cond_signal(&pl->more);
+	}
+
+	mutex_unlock(&pl->mx);
+}
+
+static void release(struct pool* pl, struct job* jb)
+{
+	mutex_lock(&pl->mx);
+	jb->next = pl->free;
+	pl->free = jb;
+	mutex_unlock(&pl->mx);
+}
+
+uint use_job(TC, struct shortent* se)
+{
+	struct pool* pl = tc->pool;
+	struct job* jb = se->job;
+	uint rec = 0;
+
+	mutex_lock(&pl->mx);
+
+	while(!jb->done)
+		cond_wait(&pl->done, &pl->mx);
+
+	mutex_unlock(&pl->mx);
+
+	if(jb->fd < 0)
+		goto out;
+	if(jb->err < 0)
+		thread_fail("cannot read entries from", jb->path, jb->err);
+
+	if(jb->dc.full) {
+		sys_close(jb->fd);
+		release(pl, jb);
+		return scan_dir(tc, jb->at, jb->name, jb->path, jb->old);
+	}
+
+	print_indexed(&jb->dc);
+
+	if(tc->ix)
+		rec = store_dir(&jb->dc, &jb->st);
+
+	sys_close(jb->fd);
+out:
+	release(pl, jb);
+
+	return rec;
+}
@@ -3,11 +3,13 @@
 #include <sys/dents.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/statx.h>
 
 #include <format.h>
 #include <string.h>
 #include <memoff.h>
 #include <output.h>
+#include <uring.h>
 #include <util.h>
 #include <main.h>
 
@@ -18,7 +20,7 @@ ERRTAG("list");
 
 #define DT_LNK_DIR 71	/* symlink pointing to a dir, custom value */
 
-#define OPTS "acdnluy"
+#define OPTS "acdnluyq"
 #define OPT_a (1<<0)
 #define OPT_c (1<<1)
 #define OPT_d (1<<2)
@@ -26,9 +28,13 @@ ERRTAG("list");
 #define OPT_l (1<<4)
 #define OPT_u (1<<5)
 #define OPT_y (1<<6)
+#define OPT_q (1<<7)
+
+#define BATCH 64
 
 struct ent {
 	int type;
+	int statted;
 	int mode;
 	int uid;
 	int gid;
@@ -56,6 +62,9 @@ struct top {
 
 	struct ent** idx;
 
+	uint mask;
+	int nostatx;
+
 	int sizelen;
 	int uidlen;
 	int gidlen;
@@ -152,32 +161,102 @@ got:
 	return ret;
 }
 
+/* Stat info is only used for output, so the fields requested from statx
+   depend on what's going to be shown. Size is always there, mode (for
+   the +x highlight) only if the output is colored, uid and gid with -l.
+   The type gets asked for only when getdents did not provide it. */
+
+static void set_mask(CTX)
+{
+	int opts = ctx->opts;
+	uint mask = STATX_SIZE;
+
+	if(!(opts & OPT_c))
+		mask |= STATX_MODE;
+	if(opts & OPT_l)
+		mask |= STATX_MODE | STATX_UID | STATX_GID;
+
+	ctx->mask = mask;
+}
+
+static uint entry_mask(CTX, struct ent* en)
+{
+	uint mask = ctx->mask;
+
+	if(en->type == DT_UNKNOWN)
+		mask |= STATX_TYPE;
+
+	return mask;
+}
+
+static void set_stat(struct ent* en, struct statx* stx)
+{
+	en->statted = 1;
+	en->mode = stx->mode;
+	en->size = stx->size;
+	en->uid = stx->uid;
+	en->gid = stx->gid;
+
+	if(en->type == DT_UNKNOWN && (stx->mask & STATX_TYPE))
+		en->type = (stx->mode >> 12) & 017;
+}
+
+/* Kernels older than 4.11 have no statx */
+
+static int fstatat_x(int at, char* name, int flags, struct statx* stx)
+{
+	struct stat st;
+	int ret;
+
+	if((ret = sys_fstatat(at, name, &st, flags)) < 0)
+		return ret;
+
+	stx->mask = STATX_BASIC_STATS;
+	stx->mode = st.mode;
+	stx->size = st.size;
+	stx->uid = st.uid;
+	stx->gid = st.gid;
+
+	return 0;
+}
+
+static int statx(CTX, int at, char* name, int flags, uint mask, struct statx* stx)
+{
+	int ret;
+
+	if(ctx->nostatx)
+		return fstatat_x(at, name, flags, stx);
+	if((ret = sys_statx(at, name, flags, mask, stx)) != -ENOSYS)
+		return ret;
+
+	ctx->nostatx = 1;
+
+	return fstatat_x(at, name, flags, stx);
+}
+
 static void stat_entry(CTX, int at, struct ent* en)
 {
-	char* name = en->name;
 	int flags = AT_NO_AUTOMOUNT | AT_SYMLINK_NOFOLLOW;
-	struct stat st;
+	uint mask = entry_mask(ctx, en);
+	struct statx stx;
 
-	if((sys_fstatat(at, name, &st, flags)) < 0)
+	if(statx(ctx, at, en->name, flags, mask, &stx) < 0)
 		return;
 
-	en->mode = st.mode;
-	en->size = st.size;
-	en->uid = st.uid;
-	en->gid = st.gid;
+	set_stat(en, &stx);
 }
 
 static void stat_target(CTX, int at, struct ent* en)
 {
 	char* name = en->name;
 	int flags = AT_NO_AUTOMOUNT;
-	struct stat st;
+	struct statx stx;
 
 	if(en->type != DT_LNK)
 		return;
-	if(sys_fstatat(at, name, &st, flags) < 0)
+	if(statx(ctx, at, name, flags, STATX_TYPE, &stx) < 0)
 		return;
-	if(S_ISDIR(st.mode))
+	if(S_ISDIR(stx.mode))
 		en->type = DT_LNK_DIR;
 }
 
@@ -197,7 +276,9 @@ static void add_dirent(CTX, int at, struct dirent* de)
 	en->type = de->type;
 	memcpy(en->name, name, len + 1);
 
-	stat_entry(ctx, at, en);
+	if(en->type == DT_UNKNOWN)
+		stat_entry(ctx, at, en);
+
 	stat_target(ctx, at, en);
 
 	if((opts & OPT_d) && (en->type != DT_DIR && en->type != DT_LNK_DIR))
@@ -524,7 +605,6 @@ static void dump_indexed(CTX)
 	struct bufout* bo = &(ctx->bo);
 	struct ent** p = ctx->idx;
 
-	check_term_output(ctx);
 	set_max_size_len(ctx);
 
 	for(; *p; p++) {
@@ -537,14 +617,113 @@ static void dump_indexed(CTX)
 	}
 }
 
+/* The bulk of the stat calls happen after filtering and sorting, so that
+   nothing gets stat'ed just to be dropped. With -q, they go through
+   io_uring in batches, one io_uring_enter for every BATCH entries.
+
+   If io_uring_enter fails halfway through a batch, some of the requests
+   may still be in flight, with the kernel about to write into stx[].
+   There's no reliable way to wait for them at that point, so stx[] comes
+   from the heap and stays there until exit, and the remaining entries
+   get stat'ed synchronously. */
+
+static int stat_batch(CTX, struct uring* ur, struct statx* stx,
+                      struct ent** idx, int n)
+{
+	struct io_uring_sqe* sqe;
+	struct io_uring_cqe* cqe;
+	int i, ret;
+
+	for(i = 0; i < n; i++) {
+		sqe = uring_sqe(ur);
+
+		sqe->opcode = IORING_OP_STATX;
+		sqe->fd = ctx->fd;
+		sqe->addr = (long)idx[i]->name;
+		sqe->len = entry_mask(ctx, idx[i]);
+		sqe->off = (long)&stx[i];
+		sqe->opflags = AT_NO_AUTOMOUNT | AT_SYMLINK_NOFOLLOW;
+		sqe->user_data = i;
+	}
+
+	for(i = 0; i < n; ) {
+		if((ret = uring_enter(ur, n - i)) < 0)
+			return ret;
+
+		while((cqe = uring_cqe(ur))) {
+			int k = cqe->user_data;
+
+			if(cqe->res >= 0)
+				set_stat(idx[k], &stx[k]);
+
+			uring_seen(ur);
+			i++;
+		}
+	}
+
+	return 0;
+}
+
+static int stat_ring(CTX)
+{
+	struct ent** idx = ctx->idx;
+	struct ent* batch[BATCH];
+	struct statx* stx;
+	struct uring ur;
+	int n = 0, ret = 0;
+
+	if(uring_init(&ur, BATCH) < 0)
+		return 0;
+
+	stx = alloc(ctx, BATCH*sizeof(*stx) + 8);
+	stx = (struct statx*)(((long)stx + 7) & ~7L);
+
+	for(; *idx; idx++) {
+		if((*idx)->statted)
+			continue;
+
+		batch[n++] = *idx;
+
+		if(n < BATCH)
+			continue;
+		if((ret = stat_batch(ctx, &ur, stx, batch, n)) < 0)
+			break;
+
+		n = 0;
+	}
+
+	if(n && ret >= 0)
+		ret = stat_batch(ctx, &ur, stx, batch, n);
+
+	uring_fini(&ur);
+
+	return ret >= 0;
+}
+
+static void stat_entries(CTX)
+{
+	struct ent** idx = ctx->idx;
+
+	if((ctx->opts & OPT_q) && stat_ring(ctx))
+		return;
+
+	for(; *idx; idx++)
+		if(!(*idx)->statted)
+			stat_entry(ctx, ctx->fd, *idx);
+}
+
 static void list_directory(CTX)
 {
+	check_term_output(ctx);
+	set_mask(ctx);
+
 	void* ents = ctx->ptr;
 	read_whole(ctx);
 	void* eend = ctx->ptr;
 
 	index_entries(ctx, ents, eend);
 	sort_indexed(ctx);
+	stat_entries(ctx);
 	dump_indexed(ctx);
 }
 
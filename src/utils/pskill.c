@@ -1,9 +1,10 @@
 #include <sys/signal.h>
-#include <sys/dents.h>
-#include <sys/file.h>
 
 #include <string.h>
 #include <format.h>
+#include <procs.h>
+#include <mpat.h>
+#include <heap.h>
 #include <util.h>
 #include <main.h>
 
@@ -13,12 +14,11 @@ ERRLIST(NEINVAL NEPERM NESRCH NENOSYS);
 struct top {
 	char** args;
 	int argn;
-	int fd;
 	int pid;
-	int len;
 	int sig;
+	int len;
 
-	char name[64];
+	struct mpat mp;
 };
 
 #define CTX struct top* ctx
@@ -50,8 +50,6 @@ static const struct signame {
 	{ 0, "" }
 };
 
-static char cmdbuf[4096];
-
 static int sigbyname(char* name)
 {
 	const struct signame* sn;
@@ -76,156 +74,70 @@ static void kill_proc(CTX, char* arg)
 		warn("process", arg, ret);
 }
 
-static int find_by_pid(CTX, char* name)
-{
-	int i, n = ctx->argn;
-	char** args = ctx->args;
-	char* arg;
+/* All three kinds of process specs, pids, names and argv[0] basenames,
+   are looked up with the same compiled matcher. Only whole-string matches
+   count, and each spec gets used for one process at most. */
 
-	for(i = 0; i < n; i++)
-		if(!(arg = args[i]))
-			continue;
-		else if(!strcmp(arg, name))
-			return i;
-
-	return -1;
-}
-
-static int read_entry(CTX, int at, char* name)
+static int whole_match(void* data, int idx, int end)
 {
-	int fd, rd, ret;
+	struct top* ctx = data;
 
-	if((fd = sys_openat(at, name, O_RDONLY)) < 0)
-		return fd;
+	if(end != ctx->len)
+		return -1;
+	if(ctx->mp.lens[idx] != end)
+		return -1;
+	if(!ctx->args[idx])
+		return -1;
 
-	if((rd = sys_read(fd, cmdbuf, sizeof(cmdbuf))) > 0)
-		ctx->len = rd;
-
-	if((ret = sys_close(fd)) < 0)
-		fail("close", NULL, ret);
-
-	return rd;
+	return idx;
 }
 
-static int read_status(CTX, int at)
+static int find_spec(CTX, char* str, int len)
 {
-	int ret;
+	ctx->len = len;
 
-	if((ret = read_entry(ctx, at, "status")) < 0)
-		return ret;
-
-	if(ret < 6) /* Name:_ */
-		return 0;
-	if(strncmp(cmdbuf, "Name:", 5))
-		return 0;
-
-	char* p = cmdbuf + 5;
-	char* e = cmdbuf + ret;
-
-	if(*p++ != '\t')
-		return 0;
-
-	char* s = p;
-
-	for(; p < e; p++)
-		if(*p == '\n')
-			break;
-	if(p >= e)
-		return 0;
-
-	ulong len = p - s;
-
-	if(len > sizeof(ctx->name))
-		return 0;
-
-	memzero(ctx->name, sizeof(ctx->name));
-	memcpy(ctx->name, s, len);
-
-	return len;
+	return mp_scan(&ctx->mp, str, len, whole_match, ctx);
 }
 
-static int read_cmdline(CTX, int at)
+static int find_by_cmd(CTX, struct psent* ps)
 {
-	return read_entry(ctx, at, "cmdline");
-}
-
-static int find_by_name(CTX)
-{
-	int i, n = ctx->argn;
-	char** args = ctx->args;
-	char* arg;
-
-	char* name = ctx->name;
-	int size = sizeof(ctx->name);
-
-	for(i = 0; i < n; i++)
-		if(!(arg = args[i]))
-			continue;
-		else if(!strncmp(name, arg, size))
-			return i;
-
-	return -1;
-}
-
-static int find_by_cmd(CTX)
-{
-	int i, n = ctx->argn;
-	char** args = ctx->args;
-	char* arg;
-
-	char* p = cmdbuf;
-	char* e = cmdbuf + ctx->len;
+	char* c = ps_cmdline(ps);
+	char* p = c;
+	char* e = c + ps->clen;
 
 	for(; p < e; p++)
 		if(!*p) break;
 	if(p >= e)
-		return 0;
+		return -1;
 
 	char* s = p;
-	char* c = cmdbuf;
 
 	for(p = c; p < s; p++)
-		if(*p == '/') c = p;
+		if(*p == '/') c = p + 1;
 
-	char* cmd = c;
-	int len = s - c;
-
-	for(i = 0; i < n; i++)
-		if(!(arg = args[i]))
-			continue;
-		else if(!strncmp(cmd, arg, len))
-			return i;
-
-	return -1;
+	return find_spec(ctx, c, s - c);
 }
 
-static void read_proc(CTX, char* name)
+static void check_proc(CTX, struct psent* ps)
 {
-	int at = ctx->fd;
-	int fd = -1, ret;
-	char* p;
+	int ret;
 
-	if(!(p = parseint(name, &ctx->pid)) || *p)
-		return;
-	if((ret = find_by_pid(ctx, name)) >= 0)
-		goto got;
-	if((fd = sys_openat(at, name, O_DIRECTORY)) < 0)
-		return;
+	FMTBUF(p, e, pidstr, 20);
+	p = fmtint(p, e, ps->pid);
+	FMTEND(p, e);
 
-	if((ret = read_status(ctx, fd)) <= 0)
-		goto out;
-	if((ret = find_by_name(ctx)) >= 0)
+	if((ret = find_spec(ctx, pidstr, p - pidstr)) >= 0)
+		goto got;
+	if((ret = find_spec(ctx, ps->name, ps->nlen)) >= 0)
+		goto got;
+	if((ret = find_by_cmd(ctx, ps)) >= 0)
 		goto got;
 
-	if((ret = read_cmdline(ctx, fd)) <= 0)
-		goto out;
-	if((ret = find_by_cmd(ctx)) < 0)
-		goto out;
+	return;
 got:
 	ctx->args[ret] = NULL;
-	kill_proc(ctx, name);
-out:
-	if(fd >= 0) sys_close(fd);
+	ctx->pid = ps->pid;
+	kill_proc(ctx, pidstr);
 }
 
 static void report_remaining(CTX)
@@ -253,35 +165,26 @@ static void report_remaining(CTX)
 static void kill_by_name(char** args, int n, int sig)
 {
 	struct top context, *ctx = &context;
-	int fd, rd;
-	char* dir = "/proc";
-	char buf[2048];
+	struct pstab pstab, *pt = &pstab;
+	struct heap heap;
+	int i, ret;
 
 	ctx->args = args;
 	ctx->argn = n;
 	ctx->sig = sig;
 
-	if((fd = sys_open(dir, O_DIRECTORY)) < 0)
-		fail(NULL, dir, fd);
+	hinit(&heap, PAGE);
+	mp_compile(&ctx->mp, &heap, args, n);
 
-	ctx->fd = fd;
+	if((ret = ps_open(pt, &heap, PS_NAME | PS_CMDLINE)) < 0)
+		fail(NULL, "/proc", ret);
 
-	while((rd = sys_getdents(ctx->fd, buf, sizeof(buf))) > 0) {
-		void* ptr = buf;
-		void* end = buf + rd;
+	ps_scan(pt);
+	ps_close(pt);
+	ps_index(pt);
 
-		while(ptr < end) {
-			struct dirent* de = ptr;
-			ptr += de->reclen;
-
-			if(de->reclen <= 0)
-				break;
-			if(de->type != DT_DIR)
-				continue;
-
-			read_proc(ctx, de->name);
-		}
-	}
+	for(i = 0; i < pt->count; i++)
+		check_proc(ctx, pt->idx[i]);
 
 	report_remaining(ctx);
 }
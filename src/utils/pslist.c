@@ -1,54 +1,27 @@
-#include <sys/file.h>
-#include <sys/dents.h>
-#include <sys/mman.h>
 #include <sys/creds.h>
 
 #include <format.h>
-#include <printf.h>
 #include <string.h>
-#include <output.h>
+#include <procs.h>
 #include <util.h>
 #include <main.h>
 
-ERRTAG("pslist");
-
-#define OPTS "rc"
-#define OPT_r (1<<0)
-#define OPT_c (1<<1)
-
-struct top {
-	int self;
-	int opts;
-
-	void* brk;
-	void* ptr;
-	void* end;
-
-	int npatt;
-	char** patts;
-
-	char state;
-	int pid, ppid;
-	int uid, euid;
-	int gid, egid;
+#include "pslist.h"
 
-	struct bufout bo;
-};
+ERRTAG("pslist");
 
 static char outbuf[4096];
 
-#define CTX struct top* ctx __unused
-
 static void output(CTX, char* buf, int len)
 {
 	bufout(&ctx->bo, buf, len);
 }
 
-static void format_proc_status(CTX)
+static void format_proc_status(CTX, struct psent* ps)
 {
 	FMTBUF(p, e, buf, 50);
 	p = fmtstr(p, e, "\033[33m");
-	p = fmtint(p, e, ctx->pid);
+	p = fmtint(p, e, ps->pid);
 	p = fmtstr(p, e, "\033[0m");
 	FMTEND(p, e);
 
@@ -115,10 +88,10 @@ static void out_one_arg(CTX, char* arg, int len)
 		output(ctx, arg, len);
 }
 
-static void format_proc_cmdline(CTX)
+static void format_proc_cmdline(CTX, struct psent* ps)
 {
-	char* p = ctx->brk;
-	char* e = ctx->ptr;
+	char* p = ps_cmdline(ps);
+	char* e = p + ps->clen;
 	char* s = p;
 
 	while(e > p && !*(e-1))
@@ -138,231 +111,67 @@ static void format_proc_cmdline(CTX)
 	output(ctx, "\n", 1);
 }
 
-static int isspace(int c)
-{
-	return (c == ' ' || c == '\t');
-}
-
-static char* skipspace(char* p, char* e)
-{
-	for(; p < e; p++)
-		if(!isspace(*p))
-			break;
-
-	return p;
-}
-
-static void set_int(char* p, int* dst)
-{
-	(void)parseint(p, dst);
-}
-
-static void set_uids(char* p, int* uid, int* euid)
-{
-	if(!(p = parseint(p, uid)))
-		return;
-	while(*p && isspace(*p))
-		p++;
-
-	(void)parseint(p, euid);
-}
-
-static int parse_status(CTX, char* buf, int len)
-{
-	int needstate = ctx->opts & OPT_r;
-
-	char* end = buf + len;
-	char* ls;
-	char* le;
-
-	for(ls = buf; ls < end; ls = le + 1) {
-		if((le = strecbrk(ls, end, '\n')) >= end)
-			break;
-
-		char* key = ls;
-		char* val;
-
-		if((val = strecbrk(ls, le, ':')) >= le)
-			break;
-
-		*le = '\0'; *val++ = '\0';
-		val = skipspace(val, le);
-
-		if(!strcmp(key, "Pid"))
-			set_int(val, &ctx->pid);
-		else if(!strcmp(key, "PPid"))
-			set_int(val, &ctx->ppid);
-		else if(!strcmp(key, "Uid"))
-			set_uids(val, &ctx->uid, &ctx->euid);
-		else if(!strcmp(key, "Gid"))
-			set_uids(val, &ctx->gid, &ctx->egid);
-		else if(needstate && !strcmp(key, "State"))
-			ctx->state = *val;
-	}
-
-	return 0;
-}
-
-static int read_proc_status(CTX, int at)
+static int check_proc_info(struct pstab* pt, struct psent* ps)
 {
-	char buf[512];
-	int fd, rd;
-
-	if((fd = sys_openat(at, "status", O_RDONLY)) < 0)
-		return fd;
-	if((rd = sys_read(fd, buf, sizeof(buf))) < 0)
-		return rd;
-
-	sys_close(fd);
+	struct top* ctx = pt->data;
 
-	return parse_status(ctx, buf, rd);
-}
-
-static int check_proc_info(CTX)
-{
-	if(ctx->pid < 0 || ctx->ppid < 0)
+	if(ps->pid == 2 || ps->ppid == 2)
 		return -1;
-	if(ctx->pid == 2 || ctx->ppid == 2)
-		return -1;
-	if(ctx->pid == ctx->self)
+	if(ps->pid == ctx->self)
 		return -1;
 
-	if((ctx->opts & OPT_r) && ctx->state != 'R')
+	if((ctx->opts & OPT_r) && ps->state != 'R')
 		return -1;
 
 	return 0;
 }
 
-static int check_proc_cmdline(CTX, char* pidstr)
-{
-	int i, n = ctx->npatt;
-	char** patts = ctx->patts;
-
-	if(!n) return 0;
-
-	char* cmd = ctx->brk;
-	char* end = ctx->ptr;
-	int len = end - cmd;
-
-	if(ctx->opts & OPT_c)
-		len = strnlen(cmd, len);
-
-	for(i = 0; i < n; i++)
-		if(!strcmp(patts[i], pidstr))
-			return 0;
-		else if(strnstr(cmd, patts[i], len))
-			return 0;
-
-	return -1;
-}
+/* Patterns match anywhere within the command line, or the whole pid.
+   Both checks go through the same compiled matcher, so the cost does
+   not depend much on the number of patterns. */
 
-static void reset_proc_data(CTX)
+static int whole_match(void* data, int idx, int end)
 {
-	ctx->state = 0;
+	struct top* ctx = data;
 
-	ctx->pid = -1;
-	ctx->ppid = -1;
+	if(end != ctx->plen)
+		return -1;
+	if(ctx->mp.lens[idx] != end)
+		return -1;
 
-	ctx->ptr = ctx->brk;
+	return idx;
 }
 
-static int read_proc_cmdline(CTX, int at)
+static int check_proc_cmdline(CTX, struct psent* ps)
 {
-	int fd, rd;
-	void* buf = ctx->ptr;
-	int len = ctx->end - buf;
+	struct mpat* mp = &ctx->mp;
 
-	if((fd = sys_openat(at, "cmdline", O_RDONLY)) < 0)
-		return fd;
+	if(!ctx->npatt) return 0;
 
-	while(1) {
-		rd = sys_read(fd, buf, len);
+	char* cmd = ps_cmdline(ps);
+	int len = ps->clen;
 
-		if(rd > 0)
-			ctx->ptr += rd;
-		if(rd < len)
-			break;
-
-		void* old = ctx->end;
-		void* new = sys_brk(old + PAGE);
-
-		if((rd = brk_error(old, new)) < 0)
-			break;
-
-		ctx->end = new;
-		buf = ctx->ptr;
-		len = new - buf;
-	}
-
-	if(rd < 0)
-		ctx->ptr = ctx->brk;
-
-	sys_close(fd);
-
-	return rd;
-}
-
-static void read_proc(CTX, int at, char* pidstr)
-{
-	int fd;
-
-	if((fd = sys_openat(at, pidstr, O_DIRECTORY)) < 0)
-		return;
-
-	reset_proc_data(ctx);
-
-	if(read_proc_status(ctx, fd) < 0)
-		goto out;
-	if(check_proc_info(ctx))
-		goto out;
-	if(read_proc_cmdline(ctx, fd) < 0)
-		goto out;
-	if(check_proc_cmdline(ctx, pidstr))
-		goto out;
-
-	format_proc_status(ctx);
-	format_proc_cmdline(ctx);
-out:
-	sys_close(fd);
-}
-
-static int isdigit(int c)
-{
-	return (c >= '0' && c <= '9');
-}
-
-static void read_proc_list(CTX)
-{
-	int fd, rd;
-	char* dir = "/proc";
-	char buf[2048];
+	if(ctx->opts & OPT_c)
+		len = strnlen(cmd, len);
 
-	if((fd = sys_open(dir, O_DIRECTORY)) < 0)
-		fail(NULL, dir, fd);
+	if(mp_scan(mp, cmd, len, NULL, NULL) >= 0)
+		return 0;
 
-	while((rd = sys_getdents(fd, buf, sizeof(buf))) > 0) {
-		void* ptr = buf;
-		void* end = buf + rd;
+	FMTBUF(p, e, pidstr, 20);
+	p = fmtint(p, e, ps->pid);
+	FMTEND(p, e);
 
-		while(ptr < end) {
-			struct dirent* de = ptr;
-			ptr += de->reclen;
+	ctx->plen = p - pidstr;
 
-			if(de->reclen <= 0)
-				break;
-			if(de->type != DT_DIR)
-				continue;
-			if(!isdigit(de->name[0]))
-				continue;
+	if(mp_scan(mp, pidstr, ctx->plen, whole_match, ctx) >= 0)
+		return 0;
 
-			read_proc(ctx, fd, de->name);
-		}
-	}
+	return -1;
 }
 
 /* Normally this tool must scan the whole /proc directory, but if it gets
-   called with pids only, doing so is unnecessary and it can just open
-   relevant /proc/$pid directories directly. */
+   called with pids only, doing so is unnecessary and it can just load
+   relevant /proc/$pid entries directly. */
 
 static int need_whole_list(CTX)
 {
@@ -377,30 +186,48 @@ static int need_whole_list(CTX)
 	return !n;
 }
 
-static void read_selected_pids(CTX)
+static void read_selected_pids(CTX, struct pstab* pt)
 {
 	int i, n = ctx->npatt;
-	char* dir = "/proc";
-	int fd;
-
-	if((fd = sys_open(dir, O_DIRECTORY)) < 0)
-		fail(NULL, dir, fd);
 
 	for(i = 0; i < n; i++)
-		read_proc(ctx, fd, ctx->patts[i]);
+		(void)ps_load(pt, ctx->patts[i]);
 }
 
-static void init_cmdmem(CTX)
+static void read_proc_table(CTX, struct pstab* pt)
 {
-	void* brk = sys_brk(NULL);
-	void* end = sys_brk(brk + PAGE);
+	int fields = PS_STATE | PS_PPID | PS_CMDLINE;
+	int ret;
+
+	if((ret = ps_open(pt, &ctx->hp, fields)) < 0)
+		fail(NULL, "/proc", ret);
 
-	if(brk_error(brk, end))
-		fail("cannot initialize heap", NULL, 0);
+	pt->filter = check_proc_info;
+	pt->data = ctx;
 
-	ctx->brk = brk;
-	ctx->ptr = brk;
-	ctx->end = end;
+	if(need_whole_list(ctx))
+		ps_scan(pt);
+	else
+		read_selected_pids(ctx, pt);
+
+	ps_close(pt);
+	ps_index(pt);
+}
+
+static void dump_proc_table(CTX, struct pstab* pt)
+{
+	int i, n = pt->count;
+	struct psent** idx = pt->idx;
+
+	for(i = 0; i < n; i++) {
+		struct psent* ps = idx[i];
+
+		if(check_proc_cmdline(ctx, ps))
+			continue;
+
+		format_proc_status(ctx, ps);
+		format_proc_cmdline(ctx, ps);
+	}
 }
 
 static void init_output(CTX)
@@ -415,10 +242,30 @@ static void fini_output(CTX)
 	bufoutflush(&ctx->bo);
 }
 
+static int interval_arg(int argc, char** argv, int i)
+{
+	char* arg;
+	char* p;
+	int n;
+
+	if(i >= argc)
+		fail("-w needs an interval", NULL, 0);
+	if(i + 1 < argc)
+		fail("too many arguments", NULL, 0);
+
+	arg = argv[i];
+
+	if(!(p = parseint(arg, &n)) || *p || n <= 0)
+		fail("invalid interval", arg, 0);
+
+	return n;
+}
+
 int main(int argc, char** argv)
 {
 	int i = 1;
 	struct top context, *ctx = &context;
+	struct pstab pstab, *pt = &pstab;
 
 	memzero(ctx, sizeof(*ctx));
 
@@ -426,16 +273,21 @@ int main(int argc, char** argv)
 		ctx->opts = argbits(OPTS, argv[i++] + 1);
 
 	ctx->self = sys_getpid();
+
+	hinit(&ctx->hp, PAGE);
+
+	if(ctx->opts & OPT_w)
+		watch(ctx, interval_arg(argc, argv, i));
+
 	ctx->npatt = argc - i;
 	ctx->patts = argv + i;
 
-	init_cmdmem(ctx);
+	mp_compile(&ctx->mp, &ctx->hp, ctx->patts, ctx->npatt);
+
 	init_output(ctx);
 
-	if(need_whole_list(ctx))
-		read_proc_list(ctx);
-	else
-		read_selected_pids(ctx);
+	read_proc_table(ctx, pt);
+	dump_proc_table(ctx, pt);
 
 	fini_output(ctx);
 
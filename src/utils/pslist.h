@@ -0,0 +1,25 @@
+#include <output.h>
+#include <heap.h>
+#include <mpat.h>
+
+#define OPTS "rcw"
+#define OPT_r (1<<0)
+#define OPT_c (1<<1)
+#define OPT_w (1<<2)
+
+struct top {
+	int self;
+	int opts;
+
+	int npatt;
+	char** patts;
+	struct mpat mp;
+	int plen;
+
+	struct heap hp;
+	struct bufout bo;
+};
+
+#define CTX struct top* ctx __unused
+
+void watch(CTX, int interval) noreturn;
@@ -0,0 +1,537 @@
+#include <bits/ioctl/tty.h>
+#include <sys/file.h>
+#include <sys/dents.h>
+#include <sys/ioctl.h>
+#include <sys/rlimit.h>
+#include <sys/sched.h>
+#include <sys/time.h>
+
+#include <format.h>
+#include <procs.h>
+#include <string.h>
+#include <util.h>
+
+#include "pslist.h"
+
+/* Top-like mode, pslist -w interval. Unlike the snapshot mode, this one
+   keeps /proc/$pid/stat and /proc/$pid/statm open for each process it
+   has seen, and re-reads them with pread at offset 0 on every tick.
+   The kernel generates the contents anew for each read from offset 0,
+   so a process costs two syscalls per tick once it's known.
+
+   The state kept between ticks lives in a hash table keyed by pid.
+   Each tick builds a new table, moving the entries for the processes
+   that are still there from the old one. Whatever remains in the old
+   table afterwards belongs to processes that have exited, and gets
+   their fds closed.
+
+   With thousands of processes, two fds per each may well run over
+   RLIMIT_NOFILE even after raising the soft limit as far as it goes.
+   A few fds are always left free, and processes that do not get to
+   keep their fds open are sampled with plain open-read-close instead.
+   Kernel threads are not shown, so their entries are kept without fds,
+   only to avoid looking at them again.
+
+   The reading and parsing is done by ps_sample() from lib/procs. All
+   memory comes from the heap. The two tables take turns being current,
+   and the one left over from the last tick gets reused unless the pid
+   count has outgrown it.
+
+   CPU usage is the difference in utime+stime between two ticks, which
+   the kernel reports in USER_HZ units. USER_HZ is 100 on all arches
+   Linux supports, regardless of the kernel's internal HZ. */
+
+#define NSLOTS 1024
+#define FIELDS (PS_NAME | PS_STATE | PS_PPID | PS_TIMES | PS_RSS)
+#define USER_HZ 100
+#define OUTBUF (64*1024)
+#define SPAREFDS 16
+
+struct slot {
+	int pid;
+	int statfd;
+	int statmfd;
+	char kthread;
+	char state;
+	uint64_t ticks;
+	long rss;
+	int dcpu;
+	long drss;
+	char name[32];
+};
+
+struct watch {
+	struct top* top;
+	struct pstab pt;
+	struct psent* ps;
+	int maxfd;
+
+	struct slot* slots;
+	uint nslots;
+	uint count;
+
+	struct slot* prev;
+	uint nprev;
+
+	struct slot* spare;
+	uint nspare;
+
+	struct slot** sorted;
+	uint sortlen;
+	uint nshown;
+
+	struct timespec last;
+	long elapsed; /* ms */
+	int rows;
+};
+
+#define WCT struct watch* wc
+
+static uint hash_pid(int pid)
+{
+	return (uint)pid * 2654435761U;
+}
+
+static struct slot* find_slot(struct slot* slots, uint nslots, int pid)
+{
+	uint mask = nslots - 1;
+	uint i = hash_pid(pid) & mask;
+	struct slot* sl;
+
+	while((sl = &slots[i])->pid) {
+		if(sl->pid == pid)
+			return sl;
+
+		i = (i + 1) & mask;
+	}
+
+	return sl;
+}
+
+static void alloc_table(WCT, uint nslots)
+{
+	struct top* ctx = wc->top;
+	long size = nslots*sizeof(struct slot);
+
+	if(wc->spare && wc->nspare >= nslots) {
+		wc->slots = wc->spare;
+		nslots = wc->nspare;
+		wc->spare = NULL;
+		wc->nspare = 0;
+	} else {
+		wc->slots = halloc(&ctx->hp, size);
+	}
+
+	memzero(wc->slots, nslots*sizeof(struct slot));
+
+	wc->nslots = nslots;
+	wc->count = 0;
+}
+
+static void release_table(WCT, struct slot* slots, uint nslots)
+{
+	if(nslots <= wc->nspare)
+		return;
+
+	wc->spare = slots;
+	wc->nspare = nslots;
+}
+
+static void grow_table(WCT)
+{
+	struct slot* old = wc->slots;
+	uint i, n = wc->nslots;
+
+	alloc_table(wc, 2*n);
+
+	for(i = 0; i < n; i++) {
+		struct slot* sl = &old[i];
+
+		if(sl->pid <= 0)
+			continue;
+
+		*find_slot(wc->slots, wc->nslots, sl->pid) = *sl;
+		wc->count++;
+	}
+
+	release_table(wc, old, n);
+}
+
+static struct slot* insert(WCT, int pid)
+{
+	struct slot* sl;
+
+	if(2*(wc->count + 1) > wc->nslots)
+		grow_table(wc);
+
+	sl = find_slot(wc->slots, wc->nslots, pid);
+	wc->count++;
+
+	return sl;
+}
+
+static int sample(WCT, struct slot* sl, int fresh)
+{
+	struct psent* ps = wc->ps;
+	long nlen;
+	int ret;
+
+	ps->pid = sl->pid;
+
+	if((ret = ps_sample(&wc->pt, ps, sl->statfd, sl->statmfd)) < 0)
+		return ret;
+
+	if((nlen = ps->nlen) > (long)sizeof(sl->name) - 1)
+		nlen = sizeof(sl->name) - 1;
+
+	memcpy(sl->name, ps->name, nlen);
+	sl->name[nlen] = '\0';
+
+	sl->state = ps->state;
+
+	if(ps->ppid == 2 || sl->pid == 2)
+		sl->kthread = 1;
+	if(sl->kthread)
+		return 0;
+
+	sl->dcpu = fresh ? 0 : ps->ticks - sl->ticks;
+	sl->drss = fresh ? 0 : ps->rss - sl->rss;
+	sl->ticks = ps->ticks;
+	sl->rss = ps->rss;
+
+	return 0;
+}
+
+static void close_slot(struct slot* sl)
+{
+	if(sl->statfd >= 0)
+		sys_close(sl->statfd);
+	if(sl->statmfd >= 0)
+		sys_close(sl->statmfd);
+
+	sl->statfd = -1;
+	sl->statmfd = -1;
+}
+
+static int keep_open(WCT, int pid, char* name)
+{
+	int fd = ps_openat(&wc->pt, pid, name);
+
+	if(fd == -EMFILE || fd == -ENFILE)
+		return -1;
+	if(fd < wc->maxfd)
+		return fd;
+
+	sys_close(fd);
+
+	return -1;
+}
+
+/* The first sample tells whether it's a kernel thread, so the fds
+   only get opened after that. */
+
+static int open_slot(WCT, struct slot* sl)
+{
+	int fd;
+
+	sl->statfd = -1;
+	sl->statmfd = -1;
+
+	if(sample(wc, sl, 1) < 0)
+		return -ESRCH;
+	if(sl->kthread)
+		return 0;
+
+	if((fd = keep_open(wc, sl->pid, "stat")) < -1)
+		return fd;
+
+	sl->statfd = fd;
+
+	if((fd = keep_open(wc, sl->pid, "statm")) < -1)
+		return fd;
+
+	sl->statmfd = fd;
+
+	return 0;
+}
+
+/* New entries get moved from the previous table if they were there.
+   The old slot gets marked with pid -1, which keeps the probe chains
+   intact for the lookups that follow. */
+
+static void check_proc(WCT, char* pidstr)
+{
+	struct slot *sl, *ps;
+	int pid;
+	char* p;
+
+	if(!(p = parseint(pidstr, &pid)) || *p)
+		return;
+	if(pid == wc->top->self)
+		return;
+
+	sl = insert(wc, pid);
+	ps = find_slot(wc->prev, wc->nprev, pid);
+
+	if(!ps->pid) {
+		memzero(sl, sizeof(*sl));
+		sl->pid = pid;
+
+		if(open_slot(wc, sl) >= 0)
+			return;
+	} else {
+		*sl = *ps;
+		ps->pid = -1;
+
+		if(sl->kthread)
+			return;
+		if(sample(wc, sl, 0) >= 0)
+			return;
+	}
+
+	close_slot(sl);
+	sl->pid = -1;
+}
+
+static void close_exited(WCT)
+{
+	struct slot* prev = wc->prev;
+	uint i, n = wc->nprev;
+
+	for(i = 0; i < n; i++)
+		if(prev[i].pid > 0)
+			close_slot(&prev[i]);
+
+	release_table(wc, prev, n);
+}
+
+static void scan_procs(WCT)
+{
+	char buf[2048];
+	int fd = wc->pt.fd;
+	int ret, rd;
+
+	wc->prev = wc->slots;
+	wc->nprev = wc->nslots;
+
+	alloc_table(wc, wc->nprev);
+
+	if((ret = sys_seek(fd, 0)) < 0)
+		fail("seek", "/proc", ret);
+
+	while((rd = sys_getdents(fd, buf, sizeof(buf))) > 0) {
+		void* ptr = buf;
+		void* end = buf + rd;
+
+		while(ptr < end) {
+			struct dirent* de = ptr;
+			ptr += de->reclen;
+
+			if(de->reclen <= 0)
+				break;
+			if(de->type != DT_DIR)
+				continue;
+			if(de->name[0] < '0' || de->name[0] > '9')
+				continue;
+
+			check_proc(wc, de->name);
+		}
+	}
+
+	close_exited(wc);
+}
+
+static void update_clock(WCT)
+{
+	struct timespec ts, *last = &wc->last;
+
+	sys_clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	long ms = (ts.sec - last->sec)*1000 + (ts.nsec - last->nsec)/1000000;
+
+	wc->elapsed = ms > 0 ? ms : 1;
+	*last = ts;
+}
+
+static int cmp_slots(void* pa, void* pb)
+{
+	struct slot* a = pa;
+	struct slot* b = pb;
+
+	if(a->dcpu != b->dcpu)
+		return a->dcpu > b->dcpu ? -1 : 1;
+	if(a->rss != b->rss)
+		return a->rss > b->rss ? -1 : 1;
+
+	return a->pid < b->pid ? -1 : a->pid > b->pid;
+}
+
+static void sort_slots(WCT)
+{
+	struct top* ctx = wc->top;
+	struct slot* slots = wc->slots;
+	uint i, j = 0, n = wc->nslots;
+
+	/* count never exceeds nslots/2, see insert() */
+
+	if(wc->count > wc->sortlen) {
+		wc->sortlen = n/2;
+		wc->sorted = halloc(&ctx->hp, wc->sortlen*sizeof(void*));
+	}
+
+	for(i = 0; i < n; i++) {
+		struct slot* sl = &slots[i];
+
+		if(sl->pid <= 0 || sl->kthread)
+			continue;
+		if((ctx->opts & OPT_r) && sl->state != 'R')
+			continue;
+
+		wc->sorted[j++] = sl;
+	}
+
+	qsortp(wc->sorted, j, cmp_slots);
+
+	wc->nshown = j;
+}
+
+static char* fmt_delta(char* p, char* e, long pages)
+{
+	if(!pages)
+		return p;
+
+	if(pages > 0) {
+		p = fmtchar(p, e, '+');
+	} else {
+		p = fmtchar(p, e, '-');
+		pages = -pages;
+	}
+
+	return fmtsize(p, e, pages*PAGE);
+}
+
+static char* fmt_cpu(char* p, char* e, WCT, struct slot* sl)
+{
+	long pct10 = sl->dcpu*(10*100*1000/USER_HZ)/wc->elapsed;
+
+	p = fmtlong(p, e, pct10/10);
+	p = fmtchar(p, e, '.');
+	p = fmtlong(p, e, pct10 % 10);
+
+	return p;
+}
+
+static void draw_slot(WCT, struct bufout* bo, struct slot* sl)
+{
+	char* q;
+
+	FMTBUF(p, e, buf, 100);
+
+	p = fmtpad(p, e, 7, fmtint(q = p, e, sl->pid));
+	p = fmtpad(p, e, 7, fmt_cpu(q = p, e, wc, sl));
+	p = fmtpad(p, e, 8, fmtsize(q = p, e, sl->rss*PAGE));
+	p = fmtpad(p, e, 8, fmt_delta(q = p, e, sl->drss));
+	p = fmtstr(p, e, " ");
+	p = fmtchar(p, e, sl->state);
+	p = fmtstr(p, e, " ");
+	p = fmtstr(p, e, sl->name);
+
+	FMTENL(p, e);
+
+	bufout(bo, buf, p - buf);
+}
+
+static void get_rows(WCT)
+{
+	struct winsize ws;
+
+	if(sys_ioctl(STDOUT, TIOCGWINSZ, &ws) < 0)
+		wc->rows = 0;
+	else
+		wc->rows = ws.row;
+}
+
+static void redraw(WCT)
+{
+	struct top* ctx = wc->top;
+	struct bufout* bo = &ctx->bo;
+	uint i, n = wc->nshown;
+	char* clear = "\033[H\033[J";
+	char* header = "    PID   CPU%     RSS    dRSS S NAME\n";
+
+	get_rows(wc);
+
+	if(wc->rows > 2 && n > (uint)wc->rows - 2)
+		n = wc->rows - 2;
+
+	bufout(bo, clear, strlen(clear));
+	bufout(bo, header, strlen(header));
+
+	for(i = 0; i < n; i++)
+		draw_slot(wc, bo, wc->sorted[i]);
+
+	bufoutflush(bo);
+}
+
+static void raise_nofile(WCT)
+{
+	struct rlimit rl;
+
+	wc->maxfd = 0;
+
+	if(sys_prlimit(0, RLIMIT_NOFILE, NULL, &rl) < 0)
+		return;
+
+	if(rl.cur < rl.max) {
+		rl.cur = rl.max;
+
+		if(sys_prlimit(0, RLIMIT_NOFILE, &rl, NULL) < 0)
+			(void)sys_prlimit(0, RLIMIT_NOFILE, NULL, &rl);
+	}
+
+	if(rl.cur > 1024*1024)
+		rl.cur = 1024*1024;
+
+	wc->maxfd = rl.cur - SPAREFDS;
+}
+
+static void init_watch(CTX, WCT)
+{
+	int ret;
+	long size = sizeof(struct psent) + PS_NAMEMAX + 1;
+
+	memzero(wc, sizeof(*wc));
+
+	if((ret = ps_open(&wc->pt, &ctx->hp, FIELDS)) < 0)
+		fail(NULL, "/proc", ret);
+
+	wc->top = ctx;
+	wc->ps = halloc(&ctx->hp, (size + 7) & ~7);
+
+	raise_nofile(wc);
+
+	alloc_table(wc, NSLOTS);
+	sys_clock_gettime(CLOCK_MONOTONIC, &wc->last);
+
+	ctx->bo.fd = STDOUT;
+	ctx->bo.buf = halloc(&ctx->hp, OUTBUF);
+	ctx->bo.len = OUTBUF;
+}
+
+void watch(CTX, int interval)
+{
+	struct watch context, *wc = &context;
+	struct timespec ts = { interval, 0 };
+
+	init_watch(ctx, wc);
+	scan_procs(wc);
+
+	while(1) {
+		sys_nanosleep(&ts, NULL);
+
+		update_clock(wc);
+		scan_procs(wc);
+		sort_slots(wc);
+		redraw(wc);
+	}
+}
@@ -1,11 +1,10 @@
-#include <sys/file.h>
-#include <sys/dents.h>
-#include <sys/mman.h>
 #include <sys/creds.h>
 
 #include <format.h>
 #include <string.h>
 #include <output.h>
+#include <procs.h>
+#include <heap.h>
 #include <util.h>
 #include <main.h>
 
@@ -18,8 +17,6 @@ ERRTAG("pstree");
 #define SET_mark (1<<8)
 
 struct proc {
-	ushort len; /* of the whole structure, incl. name[] */
-
 	int pid;
 	int ppid;
 	int uid;
@@ -32,7 +29,7 @@ struct proc {
 
 	int mark;
 
-	char name[];
+	char* name;
 };
 
 struct trec {
@@ -48,259 +45,84 @@ struct trec {
 struct top {
 	int opts;
 
-	void* brk;
-	void* ptr;
-	void* end;
-
 	int nprocs;
-	struct proc** procs;
+	struct proc* procs;
 
+	struct heap hp;
 	struct bufout bo;
 };
 
 #define CTX struct top* ctx
 
-static void init_heap(CTX)
-{
-	void* brk = sys_brk(0);
-
-	ctx->brk = brk;
-	ctx->ptr = brk;
-	ctx->end = brk;
-}
-
-static void* alloc(CTX, int len)
-{
-	void* ret = ctx->ptr;
-	void* end = ctx->end;
-	void* ptr = ret + len;
-
-	if(ptr > end) {
-		void* new = sys_brk(end + pagealign(ptr - end));
-
-		if(new <= end)
-			fail("cannot allocate memory", NULL, 0);
+/* The tree is built over a copy of the snapshot records, with links
+   stored as indexes into top.procs[]. The snapshot index is in pid order,
+   so each parent can be found with a binary search, and going through
+   the entries backwards and prepending each one to its parent's list
+   of children leaves the lists in pid order as well. */
 
-		ctx->end = new;
-	};
-
-	ctx->ptr = ptr;
-
-	return ret;
-}
-
-/* Proc entries are read into a growing heap (as structs proc),
-   then the heap is indexed.
-
-   The status files, /proc/$$/status, contain lots of stuff we
-   don't need, and all we need is always near the top of the file,
-   so only a 512-byte head is read. */
-
-static void index_entries(CTX, void* ptr, void* end)
+static int skip_self(struct pstab* pt, struct psent* ps)
 {
-	int nprocs = ctx->nprocs;
-	struct proc** idx = alloc(ctx, nprocs*sizeof(void*));
-	int i = 0;
-
-	while(ptr < end) {
-		struct proc* ps = ptr;
-		ptr += ps->len;
-
-		if(!ps->len || i >= nprocs)
-			fail("corrupt proc index", NULL, 0);
+	int* self = pt->data;
 
-		idx[i++] = ps;
-	}
-
-	ctx->procs = idx;
+	return ps->pid == *self;
 }
 
-static int isspace(int c)
+static void read_proc_table(CTX, struct pstab* pt)
 {
-	return (c == ' ' || c == '\t');
-}
+	int fields = PS_NAME | PS_PPID | PS_UIDS;
+	int self = sys_getpid();
+	int ret;
 
-static char* skipspace(char* p, char* e)
-{
-	for(; p < e; p++)
-		if(!isspace(*p))
-			break;
+	if((ret = ps_open(pt, &ctx->hp, fields)) < 0)
+		fail(NULL, "/proc", ret);
 
-	return p;
-}
+	pt->filter = skip_self;
+	pt->data = &self;
 
-static void set_int(char* p, int* dst)
-{
-	(void)parseint(p, dst);
+	ps_scan(pt);
+	ps_close(pt);
+	ps_index(pt);
 }
 
-static void set_uids(char* p, int* uid, int* euid)
+static void build_ps_tree(CTX, struct pstab* pt)
 {
-	if(!(p = parseint(p, uid)))
-		return;
-	while(*p && isspace(*p))
-		p++;
-
-	(void)parseint(p, euid);
-}
+	int i, nprocs = pt->count;
+	struct psent** idx = pt->idx;
+	struct proc* procs = halloc(&ctx->hp, nprocs*sizeof(*procs));
+	int mark = (ctx->opts & SET_mark ? 0 : 2);
 
-static void parse_status(CTX, char* buf, int len)
-{
-	char* end = buf + len;
-	char* ls;
-	char* le;
-
-	char* name = NULL;
-	int pid = 0, ppid = 0, euid = 0, uid = 0;
-
-	for(ls = buf; ls < end; ls = le + 1) {
-		if((le = strecbrk(ls, end, '\n')) >= end)
-			break;
-
-		char* key = ls;
-		char* val;
-
-		if((val = strecbrk(ls, le, ':')) >= le)
-			break;
-
-		*le = '\0'; *val++ = '\0';
-		val = skipspace(val, le);
-
-		if(!strcmp(key, "Name"))
-			name = val;
-		else if(!strcmp(key, "Pid"))
-			set_int(val, &pid);
-		else if(!strcmp(key, "PPid"))
-			set_int(val, &ppid);
-		else if(!strcmp(key, "Uid"))
-			set_uids(val, &uid, &euid);
+	for(i = 0; i < nprocs; i++) {
+		struct psent* pe = idx[i];
+		struct proc* ps = &procs[i];
+
+		ps->pid = pe->pid;
+		ps->ppid = pe->ppid;
+		ps->uid = pe->uid;
+		ps->euid = pe->euid;
+		ps->name = pe->name;
+
+		ps->pidx = -1;
+		ps->ridx = -1;
+		ps->didx = -1;
+		ps->mark = mark;
 	}
 
-	if(!name) return;
-
-	int nlen = strlen(name);
-	int plen = sizeof(struct proc) + nlen + 1;
-	struct proc* ps = alloc(ctx, plen);
-
-	ps->len = plen;
-	ps->pid = pid;
-	ps->ppid = ppid;
-	ps->uid = uid;
-	ps->euid = euid;
-
-	ps->pidx = -1;
-	ps->ridx = -1;
-	ps->didx = -1;
-	ps->mark = (ctx->opts & SET_mark ? 0 : 2);
+	for(i = nprocs - 1; i >= 0; i--) {
+		struct proc* ps = &procs[i];
+		int pi = ps_find(pt, ps->ppid);
 
-	memcpy(ps->name, name, nlen + 1);
-
-	ctx->nprocs++;
-}
-
-static void read_proc_status(CTX, int at, char* pstr)
-{
-	char buf[512];
-	int fd, rd;
-
-	FMTBUF(p, e, path, 40);
-	p = fmtstr(p, e, pstr);
-	p = fmtstr(p, e, "/status");
-	FMTEND(p, e);
-
-	if((fd = sys_openat(at, path, O_RDONLY)) < 0)
-		return;
-	if((rd = sys_read(fd, buf, sizeof(buf))) < 0)
-		return;
-
-	sys_close(fd);
-
-	return parse_status(ctx, buf, rd);
-}
-
-static int isdigit(int c)
-{
-	return (c >= '0' && c <= '9');
-}
-
-static void read_proc_list(CTX)
-{
-	int fd, rd;
-	char* dir = "/proc";
-	char buf[2048];
-
-	if((fd = sys_open(dir, O_DIRECTORY)) < 0)
-		fail(NULL, dir, fd);
-
-	FMTBUF(p, e, self, 50);
-	p = fmtint(p, e, sys_getpid());
-	FMTEND(p, e);
-
-	void* ptr = ctx->ptr;
-
-	while((rd = sys_getdents(fd, buf, sizeof(buf))) > 0) {
-		void* ptr = buf;
-		void* end = buf + rd;
+		if(pi < 0 || pi == i)
+			continue;
 
-		while(ptr < end) {
-			struct dirent* de = ptr;
-			ptr += de->reclen;
+		struct proc* pp = &procs[pi];
 
-			if(de->reclen <= 0)
-				break;
-			if(de->type != DT_DIR)
-				continue;
-			if(!isdigit(de->name[0]))
-				continue;
-			if(!strcmp(de->name, self))
-				continue;
-
-			read_proc_status(ctx, fd, de->name);
-		}
+		ps->pidx = pi;
+		ps->didx = pp->ridx;
+		pp->ridx = i;
 	}
 
-	void* end = ctx->ptr;
-
-	sys_close(fd);
-
-	index_entries(ctx, ptr, end);
-}
-
-/* The proc data comes with (pid, ppid) pairs from which a full tree
-   must be built. The following is an awful awful O(n^2) algorithm.
-
-   The entries are already sorted by pid, no need to sort them again
-   or disturb their order. */
-
-static void build_ps_tree(CTX)
-{
-	int nprocs = ctx->nprocs;
-	struct proc** idx = ctx->procs;
-
-	for(int i = 0; i < nprocs; i++) {
-		struct proc* psi = idx[i];
-		struct proc* chi = NULL;
-		int pid = psi->pid;
-		int ridx = -1;
-
-		for(int j = 0; j < nprocs; j++) {
-			struct proc* psj = idx[j];
-
-			if(psj->ppid != pid)
-				continue;
-
-			psj->pidx = i;
-
-			if(ridx < 0)
-				ridx = j;
-			if(chi)
-				chi->didx = j;
-
-			chi = psj;
-		}
-
-		psi->ridx = ridx;
-	}
+	ctx->nprocs = nprocs;
+	ctx->procs = procs;
 }
 
 /* Selective output, only show nodes with given names and
@@ -310,11 +132,11 @@ static void build_ps_tree(CTX)
 
 static void mark_descendants(CTX, struct proc* parent)
 {
-	struct proc** idx = ctx->procs;
+	struct proc* idx = ctx->procs;
 	int ci = parent->ridx;
 
 	while(ci >= 0) {
-		struct proc* ps = idx[ci];
+		struct proc* ps = &idx[ci];
 
 		if(!ps->mark) {
 			ps->mark = 1;
@@ -327,7 +149,7 @@ static void mark_descendants(CTX, struct proc* parent)
 
 static void mark_matched(CTX, struct proc* root)
 {
-	struct proc** idx = ctx->procs;
+	struct proc* idx = ctx->procs;
 	struct proc* ps = root;
 
 	ps->mark = 2;
@@ -337,7 +159,7 @@ static void mark_matched(CTX, struct proc* root)
 
 		if(i < 0) break;
 
-		ps = idx[i];
+		ps = &idx[i];
 
 		if(ps->mark) break;
 
@@ -353,14 +175,14 @@ static void mark_matched(CTX, struct proc* root)
 static void find_mark_matching(CTX, char* name)
 {
 	int i, nprocs = ctx->nprocs;
-	struct proc** idx = ctx->procs;
+	struct proc* idx = ctx->procs;
 
 	int pid;
 	char* p;
 
 	if((p = parseint(name, &pid)) && !*p) {
 		for(i = 0; i < nprocs; i++) {
-			struct proc* ps = idx[i];
+			struct proc* ps = &idx[i];
 			if(ps->pid == pid) {
 				mark_matched(ctx, ps);
 				break;
@@ -370,7 +192,7 @@ static void find_mark_matching(CTX, char* name)
 		int nlen = strlen(name);
 
 		for(i = 0; i < nprocs; i++) {
-			struct proc* ps = idx[i];
+			struct proc* ps = &idx[i];
 			if(!strncmp(name, ps->name, nlen))
 				mark_matched(ctx, ps);
 		}
@@ -379,14 +201,14 @@ static void find_mark_matching(CTX, char* name)
 
 static void trim_subtree(CTX, int pi)
 {
-	struct proc** idx = ctx->procs;
-	struct proc* pp = idx[pi];
+	struct proc* idx = ctx->procs;
+	struct proc* pp = &idx[pi];
 
 	int i = pp->ridx;
 	int last = -1;
 
 	while(i >= 0) {
-		struct proc* ps = idx[i];
+		struct proc* ps = &idx[i];
 
 		if(!ps->mark)
 			goto next;
@@ -394,7 +216,7 @@ static void trim_subtree(CTX, int pi)
 		if(last < 0)
 			pp->ridx = i;
 		else
-			idx[last]->didx = i;
+			idx[last].didx = i;
 
 		last = i;
 
@@ -405,7 +227,7 @@ static void trim_subtree(CTX, int pi)
 	}
 
 	if(last >= 0)
-		idx[last]->didx = -1;
+		idx[last].didx = -1;
 	else
 		pp->ridx = -1;
 }
@@ -413,10 +235,10 @@ static void trim_subtree(CTX, int pi)
 static void trim_unmarked_branches(CTX)
 {
 	int i, nprocs = ctx->nprocs;
-	struct proc** idx = ctx->procs;
+	struct proc* idx = ctx->procs;
 
 	for(i = 0; i < nprocs; i++) {
-		struct proc* ps = idx[i];
+		struct proc* ps = &idx[i];
 
 		if(ps->ppid)
 			continue;
@@ -531,7 +353,7 @@ static void dump_rec(CTX, struct trec* tp, int pi)
 	prep_tree_rec(tr, tp, pref, sizeof(pref));
 
 	while(pi >= 0) {
-		struct proc* ps = ctx->procs[pi];
+		struct proc* ps = &ctx->procs[pi];
 		int didx = ps->didx;
 		int ridx = ps->ridx;
 
@@ -548,7 +370,7 @@ static void dump_rec(CTX, struct trec* tp, int pi)
 static void dump_top(CTX, int pi)
 {
 	struct bufout* bo = &ctx->bo;
-	struct proc* ps = ctx->procs[pi];
+	struct proc* ps = &ctx->procs[pi];
 
 	struct trec tr = {
 		.buf = "",
@@ -567,10 +389,10 @@ static void dump_top(CTX, int pi)
 static void dump_kernel(CTX)
 {
 	int i, nprocs = ctx->nprocs;
-	struct proc** idx = ctx->procs;
+	struct proc* idx = ctx->procs;
 
 	for(i = 1; i < nprocs; i++)
-		if(!idx[i]->ppid)
+		if(!idx[i].ppid)
 			dump_top(ctx, i);
 }
 
@@ -582,7 +404,7 @@ static void dump_proc_list(CTX)
 	bo->fd = STDOUT;
 	bo->ptr = 0;
 	bo->len = len;
-	bo->buf = alloc(ctx, len);
+	bo->buf = halloc(&ctx->hp, len);
 
 	if(ctx->opts & OPT_k)
 		dump_kernel(ctx);
@@ -598,6 +420,7 @@ int main(int argc, char** argv)
 {
 	int i = 1;
 	struct top context, *ctx = &context;
+	struct pstab pstab, *pt = &pstab;
 
 	memzero(ctx, sizeof(*ctx));
 
@@ -606,11 +429,11 @@ int main(int argc, char** argv)
 	if(i < argc)
 		ctx->opts |= SET_mark;
 
-	init_heap(ctx);
+	hinit(&ctx->hp, PAGE);
 
-	read_proc_list(ctx);
+	read_proc_table(ctx, pt);
 
-	build_ps_tree(ctx);
+	build_ps_tree(ctx, pt);
 
 	only_leave_named(ctx, argc - i, argv + i);
 
@@ -1,15 +1,22 @@
 #include <bits/ioctl/fstrim.h>
 #include <sys/file.h>
+#include <sys/futex.h>
 #include <sys/ioctl.h>
 #include <sys/sync.h>
+#include <sys/time.h>
 
+#include <format.h>
+#include <string.h>
+#include <thread.h>
+#include <heap.h>
 #include <util.h>
 #include <main.h>
 
-#define OPTS "fdt"
+#define OPTS "fdta"
 #define OPT_f (1<<0) /* syncfs */
 #define OPT_d (1<<1) /* datasync */
 #define OPT_t (1<<2) /* fstrim */
+#define OPT_a (1<<3) /* syncfs all mounts */
 
 ERRTAG("sync");
 ERRLIST(NEBADF NEIO NEROFS NEINVAL NEACCES NENOENT NEFAULT NEFBIG NEINTR
@@ -112,6 +119,361 @@ static void fstrim(int argc, char** argv, int i)
 		fail(NULL, name, ret);
 }
 
+/* Parallel syncfs for all mounted filesystems, sync -a [timeout].
+
+   With sync(2), one slow device (USB stick, dead NFS server) holds up
+   everything else and there's no telling which one it was. Here each
+   filesystem gets its own thread doing syncfs, and the time it took
+   gets reported per mountpoint.
+
+   The threads are spawned so that they do not keep the process around
+   once the main thread decides to quit. A syncfs stuck in uninterruptible
+   wait cannot be cancelled in any way, but with a timeout, sync reports
+   whatever is still pending and exits, leaving the stuck threads behind.
+   Those must not hold anything the caller may be waiting on, so each
+   thread closes its copies of the standard fds before doing anything.
+
+   The first mount of a filesystem may well be a file bind mount, say
+   /etc/resolv.conf in a container, so the mountpoints get opened with
+   no O_DIRECTORY. syncfs works on any fd within the filesystem.
+
+   Bind mounts of the same filesystem only get synced once, and virtual
+   filesystems with nothing to sync get skipped. autofs must be skipped
+   in particular, opening its mountpoints would trigger mounts. */
+
+struct mount {
+	struct thread th;
+	int* left;
+	char* path;
+	char* dev;
+	char* msg;
+	int done;
+	int ret;
+	long usec;
+};
+
+struct syncall {
+	struct heap hp;
+	int count;
+	struct mount* mounts;
+	int left;
+	int failed;
+};
+
+static const char* const pseudofs[] = {
+	"autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs",
+	"debugfs", "devpts", "devtmpfs", "efivarfs", "fusectl", "hugetlbfs",
+	"mqueue", "nsfs", "proc", "pstore", "ramfs", "rpc_pipefs",
+	"securityfs", "selinuxfs", "sysfs", "tmpfs", "tracefs"
+};
+
+static long elapsed(struct timespec* t0, struct timespec* t1)
+{
+	return (t1->sec - t0->sec)*1000000 + (t1->nsec - t0->nsec)/1000;
+}
+
+static int mount_done(struct mount* mt, int ret)
+{
+	mt->ret = ret;
+
+	__atomic_store_n(&mt->done, 1, __ATOMIC_RELEASE);
+
+	if(!__atomic_sub_fetch(mt->left, 1, __ATOMIC_ACQ_REL))
+		sys_futex(mt->left, FUTEX_WAKE, 1, NULL);
+
+	return 0;
+}
+
+static int sync_mount(void* arg)
+{
+	struct mount* mt = arg;
+	int fd, ret, flags = O_RDONLY | O_NONBLOCK | O_NOCTTY;
+	struct timespec t0, t1;
+
+	sys_close(STDIN);
+	sys_close(STDOUT);
+	sys_close(STDERR);
+
+	sys_clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	if((fd = sys_open(mt->path, flags)) < 0) {
+		ret = fd;
+	} else {
+		ret = sys_syncfs(fd);
+		sys_close(fd);
+	}
+
+	sys_clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	mt->usec = elapsed(&t0, &t1);
+
+	return mount_done(mt, ret);
+}
+
+static void read_mountinfo(struct syncall* sa, char** buf, char** end)
+{
+	char* name = "/proc/self/mountinfo";
+	struct heap* hp = &sa->hp;
+	int fd, rd;
+
+	if((fd = sys_open(name, O_RDONLY)) < 0)
+		fail(NULL, name, fd);
+
+	hinit(hp, 4*PAGE);
+
+	*buf = hp->ptr;
+
+	while(1) {
+		hextend(hp, PAGE);
+
+		if((rd = sys_read(fd, hp->ptr, hp->end - hp->ptr)) < 0)
+			fail("read", name, rd);
+		if(!rd)
+			break;
+
+		hp->ptr += rd;
+	}
+
+	*end = hp->ptr;
+
+	sys_close(fd);
+}
+
+/* Mountpoints in mountinfo have spaces and such escaped as \ooo. */
+
+static void unescape(char* s)
+{
+	char* p = s;
+	char* q = s;
+
+	for(; *p; p++) {
+		if(p[0] == '\\' && p[1] && p[2] && p[3]) {
+			*q++ = ((p[1] - '0') << 6) | ((p[2] - '0') << 3) | (p[3] - '0');
+			p += 3;
+		} else {
+			*q++ = *p;
+		}
+	}
+
+	*q = '\0';
+}
+
+static int split(char* line, char** parts, int n)
+{
+	char* p = line;
+	char* q;
+	int i;
+
+	for(i = 0; i < n; i++) {
+		parts[i] = p;
+
+		if(!*(q = strcbrk(p, ' ')))
+			break;
+
+		*q = '\0';
+		p = q + 1;
+	}
+
+	return (i < n - 1) ? -1 : 0;
+}
+
+/* 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+
+   The number of optional fields before "-" varies, so the line gets
+   split in two at " - " first. */
+
+static int skip_fs(char* rest)
+{
+	char* type = rest;
+	uint i;
+
+	*strcbrk(type, ' ') = '\0';
+
+	for(i = 0; i < ARRAY_SIZE(pseudofs); i++)
+		if(!strcmp(type, pseudofs[i]))
+			return 1;
+
+	return 0;
+}
+
+static int seen_dev(struct syncall* sa, char* dev)
+{
+	int i;
+
+	for(i = 0; i < sa->count; i++)
+		if(!strcmp(sa->mounts[i].dev, dev))
+			return 1;
+
+	return 0;
+}
+
+static void add_mount(struct syncall* sa, char* line)
+{
+	char* parts[5];
+	char* rest;
+
+	if(!(rest = strstr(line, " - ")))
+		return;
+
+	*rest = '\0';
+	rest += 3;
+
+	if(split(line, parts, 5))
+		return;
+	if(skip_fs(rest))
+		return;
+	if(seen_dev(sa, parts[2]))
+		return;
+
+	struct mount* mt = &sa->mounts[sa->count++];
+
+	memzero(mt, sizeof(*mt));
+
+	mt->dev = parts[2];
+	mt->path = parts[4];
+	mt->left = &sa->left;
+
+	unescape(mt->path);
+}
+
+static void scan_mounts(struct syncall* sa)
+{
+	char *buf, *end, *p, *q;
+	int lines = 0;
+
+	read_mountinfo(sa, &buf, &end);
+
+	for(p = buf; p < end; p++)
+		if(*p == '\n')
+			lines++;
+
+	sa->mounts = halloc(&sa->hp, lines*sizeof(struct mount));
+
+	for(p = buf; p < end; p = q + 1) {
+		if((q = strecbrk(p, end, '\n')) >= end)
+			break;
+
+		*q = '\0';
+
+		add_mount(sa, p);
+	}
+}
+
+static void start_syncs(struct syncall* sa)
+{
+	int i, n = sa->count;
+
+	sa->left = n;
+
+	for(i = 0; i < n; i++) {
+		struct mount* mt = &sa->mounts[i];
+		int ret;
+
+		if((ret = thread_spawn(&mt->th, sync_mount, mt)) >= 0)
+			continue;
+
+		/* syncing it here would not be subject to the timeout */
+		mt->msg = "spawn";
+		mount_done(mt, ret);
+	}
+}
+
+static void wait_syncs(struct syncall* sa, int timeout)
+{
+	struct timespec now, end, ts;
+	int left;
+
+	sys_clock_gettime(CLOCK_MONOTONIC, &end);
+	end.sec += timeout;
+
+	while((left = __atomic_load_n(&sa->left, __ATOMIC_ACQUIRE)) > 0) {
+		struct timespec* tp = NULL;
+
+		if(timeout) {
+			long usec;
+
+			sys_clock_gettime(CLOCK_MONOTONIC, &now);
+
+			if((usec = elapsed(&now, &end)) <= 0)
+				break;
+
+			ts.sec = usec / 1000000;
+			ts.nsec = (usec % 1000000)*1000;
+			tp = &ts;
+		}
+
+		sys_futex(&sa->left, FUTEX_WAIT, left, tp);
+	}
+}
+
+static char* fmt_usec(char* p, char* e, long usec)
+{
+	long ms = usec / 1000;
+
+	p = fmtlong(p, e, ms);
+	p = fmtchar(p, e, '.');
+	p = fmtlong(p, e, (usec % 1000) / 100);
+	p = fmtstr(p, e, "ms");
+
+	return p;
+}
+
+static void report_mount(struct syncall* sa, struct mount* mt)
+{
+	int done = __atomic_load_n(&mt->done, __ATOMIC_ACQUIRE);
+	char* q;
+
+	if(done && mt->ret < 0) {
+		warn(mt->msg, mt->path, mt->ret);
+		sa->failed = 1;
+		return;
+	}
+
+	FMTBUF(p, e, buf, 100);
+
+	if(done) {
+		p = fmtpad(p, e, 10, fmt_usec(q = p, e, mt->usec));
+	} else {
+		p = fmtpad(p, e, 10, fmtstr(q = p, e, "timeout"));
+		sa->failed = 1;
+	}
+
+	p = fmtstr(p, e, "  ");
+	FMTEND(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+	writeall(STDOUT, mt->path, strlen(mt->path));
+	writeall(STDOUT, "\n", 1);
+}
+
+static void syncall(int argc, char** argv, int i)
+{
+	struct syncall context, *sa = &context;
+	int timeout = 0;
+	char* p;
+
+	if(i < argc) {
+		char* arg = argv[i++];
+
+		if(!(p = parseint(arg, &timeout)) || *p || timeout < 0)
+			fail("invalid timeout", arg, 0);
+	}
+	if(i < argc)
+		fail("too many arguments", NULL, 0);
+
+	memzero(sa, sizeof(*sa));
+
+	scan_mounts(sa);
+	start_syncs(sa);
+	wait_syncs(sa, timeout);
+
+	for(i = 0; i < sa->count; i++)
+		report_mount(sa, &sa->mounts[i]);
+
+	if(sa->failed)
+		_exit(0xFF);
+}
+
 int main(int argc, char** argv)
 {
 	int i = 1;
@@ -128,6 +490,8 @@ int main(int argc, char** argv)
 		fdatasync(argc, argv, i);
 	else if(opts == OPT_f)
 		syncfs(argc, argv, i);
+	else if(opts == OPT_a)
+		syncall(argc, argv, i);
 
 	return 0;
 }
@@ -0,0 +1,221 @@
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include <format.h>
+#include <string.h>
+#include <util.h>
+#include <lzma.h>
+#include <main.h>
+
+/* Decoding throughput for a set of .lz files, typically a whole set
+   of kernel modules:
+
+       luzbench $(find /lib/modules -name '*.ko.lz')
+
+   All files are mmaped and decoded in memory the same way modprobe
+   does it (see src/kmod/common_zip.c), first with the generic bit-at
+   -a-time decoder and then with the default one which uses the fast
+   path. The generic one is lib/lzma.c built with LZMA_NOFAST, see
+   Makefile. Each set is decoded repeatedly until the total run time
+   exceeds MINTIME. */
+
+ERRTAG("luzbench");
+
+#define MINTIME 500*1000*1000 /* ns */
+
+struct lzin {
+	byte* raw;
+	long rawlen;
+	long outlen;
+};
+
+struct lzma* lzma_create_slow(void* buf, int len);
+int lzma_inflate_slow(struct lzma* lz);
+
+struct decoder {
+	char* name;
+	struct lzma* (*create)(void* buf, int len);
+	int (*inflate)(struct lzma* lz);
+};
+
+static const struct decoder decoders[] = {
+	{ "generic", lzma_create_slow, lzma_inflate_slow },
+	{ "fast",    lzma_create,      lzma_inflate      }
+};
+
+static int64_t now(void)
+{
+	struct timespec ts;
+	int ret;
+
+	if((ret = sys_clock_gettime(CLOCK_MONOTONIC, &ts)) < 0)
+		fail("clock_gettime", NULL, ret);
+
+	return ts.sec*1000000000LL + ts.nsec;
+}
+
+static uint64_t get_long_at(byte* at)
+{
+	uint64_t ret = 0;
+
+	for(int i = 7; i >= 0; i--)
+		ret = (ret << 8) | at[i];
+
+	return ret;
+}
+
+static void map_input(struct lzin* li, char* name)
+{
+	struct stat st;
+	int fd, ret;
+
+	if((fd = sys_open(name, O_RDONLY)) < 0)
+		fail(NULL, name, fd);
+	if((ret = sys_fstat(fd, &st)) < 0)
+		fail("stat", name, ret);
+	if(st.size < 6 + 20)
+		fail("file too short:", name, 0);
+
+	void* buf = sys_mmap(NULL, st.size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", name, ret);
+
+	sys_close(fd);
+
+	if(memcmp(buf, "LZIP\x01", 5))
+		fail("not a lzip file:", name, 0);
+	if(get_long_at(buf + st.size - 8) != (uint64_t)st.size)
+		fail("multi-member lzip files not supported:", name, 0);
+
+	li->raw = buf;
+	li->rawlen = st.size;
+	li->outlen = get_long_at(buf + st.size - 16);
+}
+
+static void* map_output(long size)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void* buf;
+	int ret;
+
+	buf = sys_mmap(NULL, pagealign(size), prot, flags, -1, 0);
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	return buf;
+}
+
+static void decode(const struct decoder* dc, struct lzin* li, byte* out)
+{
+	byte state[LZMA_SIZE];
+	struct lzma* lz;
+	int ret;
+
+	if(!(lz = dc->create(state, sizeof(state))))
+		fail("LZMA buffer error", NULL, 0);
+
+	lz->srcbuf = li->raw;
+	lz->srcptr = li->raw + 7;
+	lz->srchwm = li->raw + li->rawlen - 20;
+	lz->srcend = li->raw + li->rawlen - 20;
+
+	lz->dstbuf = out;
+	lz->dstptr = out;
+	lz->dsthwm = out + li->outlen;
+	lz->dstend = out + li->outlen;
+
+	if((ret = dc->inflate(lz)) != LZMA_STREAM_END)
+		fail("inflate", dc->name, ret);
+	if(lz->dstptr != lz->dstend)
+		fail("output size mismatch with", dc->name, 0);
+}
+
+static void report(const struct decoder* dc, long total, long runs, int64_t ns)
+{
+	FMTBUF(p, e, buf, 200);
+	char* q;
+
+	q = fmtstr(p, e, dc->name);
+	p = fmtpadr(p, e, 10, q);
+
+	q = fmti64(p, e, ns/runs/1000);
+	p = fmtpad(p, e, 10, q);
+	p = fmtstr(p, e, " us/set");
+
+	q = fmti64(p, e, (int64_t)total*runs*1000/ns);
+	p = fmtpad(p, e, 8, q);
+	p = fmtstr(p, e, " MB/s");
+
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+}
+
+static int64_t run(const struct decoder* dc, struct lzin* li, int n, byte* out, long total)
+{
+	int64_t t0 = now(), ns;
+	long runs = 0;
+
+	do {
+		for(int i = 0; i < n; i++)
+			decode(dc, &li[i], out);
+		runs++;
+	} while((ns = now() - t0) < MINTIME);
+
+	report(dc, total, runs, ns);
+
+	return ns/runs;
+}
+
+static void summary(int n, long rawtotal, long total, int64_t slow, int64_t fast)
+{
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtint(p, e, n);
+	p = fmtstr(p, e, " files, ");
+	p = fmtlong(p, e, rawtotal);
+	p = fmtstr(p, e, " bytes in, ");
+	p = fmtlong(p, e, total);
+	p = fmtstr(p, e, " bytes out, speedup x");
+	p = fmti64(p, e, slow/fast);
+	p = fmtstr(p, e, ".");
+	p = fmti64(p, e, (slow*100/fast) % 100);
+
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+}
+
+int main(int argc, char** argv)
+{
+	int n = argc - 1;
+	struct lzin li[n];
+	long rawtotal = 0, total = 0, max = 0;
+	int64_t ns[ARRAY_SIZE(decoders)];
+
+	if(n < 1)
+		fail("no input files", NULL, 0);
+
+	for(int i = 0; i < n; i++) {
+		map_input(&li[i], argv[i+1]);
+
+		rawtotal += li[i].rawlen;
+		total += li[i].outlen;
+
+		if(li[i].outlen > max)
+			max = li[i].outlen;
+	}
+
+	byte* out = map_output(max);
+
+	for(uint i = 0; i < ARRAY_SIZE(decoders); i++)
+		ns[i] = run(&decoders[i], li, n, out, total);
+
+	summary(n, rawtotal, total, ns[0], ns[1]);
+
+	return 0;
+}
@@ -0,0 +1,255 @@
+#include <sys/sched.h>
+#include <sys/creds.h>
+
+#include <thread.h>
+#include <main.h>
+#include <util.h>
+
+ERRTAG("thread");
+
+/* Worker threads may not call fail(), so they only leave their results
+   in memory and the checks are all done by the main thread. */
+
+#define NTHREADS 4
+#define NLOOPS 20000
+#define NITEMS 100000
+
+static struct thread threads[NTHREADS];
+
+static void start(int i, int (*fn)(void*), void* arg)
+{
+	int ret;
+
+	if((ret = thread_start(&threads[i], fn, arg)) < 0)
+		fail("thread_start", NULL, ret);
+}
+
+static void start_all(int (*fn)(void*), void* arg)
+{
+	int i;
+
+	for(i = 0; i < NTHREADS; i++)
+		start(i, fn, arg);
+}
+
+static void join_all(void)
+{
+	int i, ret;
+
+	for(i = 0; i < NTHREADS; i++)
+		if((ret = thread_join(&threads[i])) < 0)
+			fail("thread_join", NULL, ret);
+}
+
+/* Plain spawn and join. Each thread writes its own slot. */
+
+static int marks[NTHREADS];
+
+static int mark(void* arg)
+{
+	int* ptr = arg;
+
+	*ptr = 1;
+
+	return 0;
+}
+
+static void test_spawn(void)
+{
+	int i;
+
+	for(i = 0; i < NTHREADS; i++)
+		start(i, mark, &marks[i]);
+
+	join_all();
+
+	for(i = 0; i < NTHREADS; i++)
+		if(!marks[i])
+			fail("thread did not run", NULL, 0);
+}
+
+/* Detached variant, same thing but each thread is a process of its own.
+   Joining must still work, and the threads must not share the pid. */
+
+static int pids[NTHREADS];
+
+static int mark_pid(void* arg)
+{
+	int* ptr = arg;
+
+	*ptr = sys_getpid();
+
+	return 0;
+}
+
+static void test_detached(void)
+{
+	int i, ret, self = sys_getpid();
+
+	for(i = 0; i < NTHREADS; i++)
+		if((ret = thread_spawn(&threads[i], mark_pid, &pids[i])) < 0)
+			fail("thread_spawn", NULL, ret);
+
+	join_all();
+
+	for(i = 0; i < NTHREADS; i++)
+		if(!pids[i] || pids[i] == self)
+			fail("spawned thread has wrong pid", NULL, 0);
+}
+
+/* Non-atomic increments of a shared counter, only correct
+   if the mutex actually excludes other threads. */
+
+static struct mutex lock;
+static volatile long counter;
+
+static int increment(void* arg)
+{
+	int i;
+
+	(void)arg;
+
+	for(i = 0; i < NLOOPS; i++) {
+		mutex_lock(&lock);
+		counter = counter + 1;
+		if(!(i % 1000)) sys_sched_yield();
+		mutex_unlock(&lock);
+	}
+
+	return 0;
+}
+
+static void test_mutex(void)
+{
+	start_all(increment, NULL);
+	join_all();
+
+	if(counter != NTHREADS*NLOOPS)
+		fail("mutex counter mismatch", NULL, 0);
+	if(mutex_trylock(&lock))
+		fail("mutex left locked", NULL, 0);
+
+	mutex_unlock(&lock);
+}
+
+/* One token passed around in turns, each thread waiting on
+   the condition variable until it's its turn. */
+
+static struct condvar turn;
+static int current;
+static int rounds[NTHREADS];
+
+static int take_turns(void* arg)
+{
+	int id = (int*)arg - rounds;
+	int i;
+
+	for(i = 0; i < 100; i++) {
+		mutex_lock(&lock);
+
+		while(current % NTHREADS != id)
+			cond_wait(&turn, &lock);
+
+		rounds[id]++;
+		current++;
+
+		cond_broadcast(&turn);
+		mutex_unlock(&lock);
+	}
+
+	return 0;
+}
+
+static void test_condvar(void)
+{
+	int i;
+
+	for(i = 0; i < NTHREADS; i++)
+		start(i, take_turns, &rounds[i]);
+
+	join_all();
+
+	if(current != 100*NTHREADS)
+		fail("condvar turn count mismatch", NULL, 0);
+	for(i = 0; i < NTHREADS; i++)
+		if(rounds[i] != 100)
+			fail("condvar rounds mismatch", NULL, 0);
+}
+
+/* Two producers and two consumers over a small queue. Every item
+   is pushed once, so the sum of popped values must match exactly. */
+
+static struct qslot slots[64];
+static struct queue queue;
+static long produced;
+static long consumed;
+static long popsum[NTHREADS];
+
+static int produce(void* arg)
+{
+	long i, base = (long)arg;
+
+	for(i = 1; i <= NITEMS; i++)
+		while(queue_push(&queue, (void*)(base + i)) < 0)
+			sys_sched_yield();
+
+	__atomic_fetch_add(&produced, NITEMS, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static int consume(void* arg)
+{
+	long* sum = arg;
+	void* ptr;
+
+	while(1) {
+		if(queue_pop(&queue, &ptr) >= 0) {
+			*sum += (long)ptr;
+			__atomic_fetch_add(&consumed, 1, __ATOMIC_RELAXED);
+		} else if(__atomic_load_n(&consumed, __ATOMIC_ACQUIRE) >= 2*NITEMS) {
+			break;
+		} else {
+			sys_sched_yield();
+		}
+	}
+
+	return 0;
+}
+
+static void test_queue(void)
+{
+	long total, expect;
+	int ret;
+
+	if((ret = queue_init(&queue, slots, ARRAY_SIZE(slots))) < 0)
+		fail("queue_init", NULL, ret);
+	if(queue_init(&queue, slots, 3) != -EINVAL)
+		fail("queue_init accepts bad size", NULL, 0);
+
+	start(0, produce, (void*)0L);
+	start(1, produce, (void*)1000000L);
+	start(2, consume, &popsum[0]);
+	start(3, consume, &popsum[1]);
+
+	join_all();
+
+	total = popsum[0] + popsum[1];
+	expect = 2*((long)NITEMS*(NITEMS + 1)/2) + 1000000L*NITEMS;
+
+	if(produced != 2*NITEMS || consumed != 2*NITEMS)
+		fail("queue item count mismatch", NULL, 0);
+	if(total != expect)
+		fail("queue checksum mismatch", NULL, 0);
+}
+
+int main(noargs)
+{
+	test_spawn();
+	test_detached();
+	test_mutex();
+	test_condvar();
+	test_queue();
+
+	return 0;
+}
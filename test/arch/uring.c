@@ -0,0 +1,104 @@
+#include <sys/file.h>
+
+#include <string.h>
+#include <uring.h>
+#include <main.h>
+#include <util.h>
+
+ERRTAG("uring");
+
+/* Open, read and close a file through the ring, and check the data
+   against a plain read. Mostly to catch struct layout mistakes. */
+
+static char* name = "uring.c";
+static char ring[1024];
+static char sync[1024];
+
+static struct io_uring_cqe* wait_cqe(struct uring* ur)
+{
+	struct io_uring_cqe* cqe;
+	int ret;
+
+	while(!(cqe = uring_cqe(ur)))
+		if((ret = uring_enter(ur, 1)) < 0)
+			fail("io_uring_enter", NULL, ret);
+
+	return cqe;
+}
+
+static int complete(struct uring* ur, uint64_t tag)
+{
+	struct io_uring_cqe* cqe = wait_cqe(ur);
+	int res = cqe->res;
+
+	if(cqe->user_data != tag)
+		fail("unexpected user_data", NULL, 0);
+
+	uring_seen(ur);
+
+	return res;
+}
+
+static int read_sync(void)
+{
+	int fd, rd;
+
+	if((fd = sys_open(name, O_RDONLY)) < 0)
+		fail(NULL, name, fd);
+	if((rd = sys_read(fd, sync, sizeof(sync))) < 0)
+		fail("read", name, rd);
+
+	sys_close(fd);
+
+	return rd;
+}
+
+int main(noargs)
+{
+	struct uring ur;
+	struct io_uring_sqe* sqe;
+	int fd, rd, ret;
+
+	if((ret = uring_init(&ur, 8)) == -ENOSYS || ret == -EPERM) {
+		warn("not supported, skipping", NULL, 0);
+		return 0;
+	} else if(ret < 0) {
+		fail("uring_init", NULL, ret);
+	}
+
+	sqe = uring_sqe(&ur);
+	sqe->opcode = IORING_OP_OPENAT;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (long)name;
+	sqe->opflags = O_RDONLY;
+	sqe->user_data = 1;
+
+	if((fd = complete(&ur, 1)) < 0)
+		fail("openat", name, fd);
+
+	sqe = uring_sqe(&ur);
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (long)ring;
+	sqe->len = sizeof(ring);
+	sqe->off = 0;
+	sqe->user_data = 2;
+
+	if((rd = complete(&ur, 2)) < 0)
+		fail("read", name, rd);
+
+	sqe = uring_sqe(&ur);
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	sqe->user_data = 3;
+
+	if((ret = complete(&ur, 3)) < 0)
+		fail("close", name, ret);
+
+	if(rd != read_sync() || memcmp(ring, sync, rd))
+		fail("data mismatch", NULL, 0);
+
+	uring_fini(&ur);
+
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include <crypto/sha256.h>
+#include <crypto/shahw.h>
 #include <string.h>
 #include <printf.h>
 #include <util.h>
@@ -52,15 +53,21 @@ static void test(struct test* tp)
 	uint8_t* key = tp->key;
 	uint8_t* hash = tp->hash;
 	uint8_t temp[32];
+	uint8_t soft[32];
 
 	hmac_sha256(temp, key, klen, input, inlen);
 
-	if(!memcmp(hash, temp, 20))
+	sha_hwmask(0);
+	hmac_sha256(soft, key, klen, input, inlen);
+	sha_hwmask(~0);
+
+	if(!memcmp(hash, temp, 20) && !memcmp(hash, soft, 20))
 		return;
 
 	tracef("FAIL %s\n", tp->input);
 	dump(hash);
 	dump(temp);
+	dump(soft);
 
 	_exit(0xFF);
 }
@@ -1,4 +1,5 @@
 #include <crypto/pbkdf2.h>
+#include <crypto/shahw.h>
 #include <printf.h>
 #include <string.h>
 #include <util.h>
@@ -24,6 +25,10 @@ static void compare(const char* F, int L, uint8_t* got, uint8_t* exp, int len)
 	uint8_t X[dklen]; \
 	pbkdf2_sha1(X, dklen, P, plen, S, slen, c); \
 	compare(__FILE__, __LINE__, X, D, dklen); \
+	sha_hwmask(0); \
+	pbkdf2_sha1(X, dklen, P, plen, S, slen, c); \
+	sha_hwmask(~0); \
+	compare(__FILE__, __LINE__, X, D, dklen); \
 }
 
 int main(void)
@@ -38,13 +38,19 @@ static void compare(const char* F, int L, uint8_t* got, uint8_t* exp, int len)
 	_exit(0xFF);
 }
 
+static int threads;
+
 static int scrypt(void* D, int dlen, void* P, int plen, void* S, int slen,
                   int n, int r, int p)
 {
 	struct scrypt sc;
 	void* brk = (void*)sys_brk(0);
-	long mem = scrypt_init(&sc, n, r, p);
-	void* end = (void*)sys_brk(brk + mem);
+	long mem;
+	void* end;
+
+	scrypt_init(&sc, n, r, p);
+	mem = scrypt_threads(&sc, threads);
+	end = (void*)sys_brk(brk + mem);
 
 	if(end < brk + n) {
 		printf("cannot allocate memory\n");
@@ -69,7 +75,7 @@ static int scrypt(void* D, int dlen, void* P, int plen, void* S, int slen,
 	compare(__FILE__, __LINE__, X, D, dklen); \
 }
 
-int main(void)
+static void run_tests(void)
 {
 	TEST("", "", 16, 1, 1, q(
 		0x77, 0xd6, 0x57, 0x62, 0x38, 0x65, 0x7b, 0x20,
@@ -109,6 +115,15 @@ int main(void)
 		0x37, 0x30, 0x40, 0x49, 0xe8, 0xa9, 0x52, 0xfb,
 		0xcb, 0xf4, 0x5c, 0x6f, 0xa7, 0x7a, 0x41, 0xa4));
 #endif
+}
+
+int main(void)
+{
+	threads = 1;
+	run_tests();
+
+	threads = 4;
+	run_tests();
 
 	return 0;
 }
@@ -1,4 +1,5 @@
 #include <crypto/sha1.h>
+#include <crypto/shahw.h>
 #include <string.h>
 #include <printf.h>
 #include <util.h>
@@ -24,10 +25,15 @@ static int printable(char* msg)
 static void test(char* msg, uint8_t hash[20])
 {
 	uint8_t temp[20];
+	uint8_t soft[20];
 
 	sha1(temp, msg, strlen(msg));
 
-	if(!memcmp(hash, temp, 20))
+	sha_hwmask(0);
+	sha1(soft, msg, strlen(msg));
+	sha_hwmask(~0);
+
+	if(!memcmp(hash, temp, 20) && !memcmp(hash, soft, 20))
 		return;
 
 	if(!printable(msg))
@@ -37,6 +43,7 @@ static void test(char* msg, uint8_t hash[20])
 
 	dump(hash);
 	dump(temp);
+	dump(soft);
 
 	_exit(0xFF);
 }
@@ -1,4 +1,5 @@
 #include <crypto/sha256.h>
+#include <crypto/shahw.h>
 #include <string.h>
 #include <printf.h>
 #include <util.h>
@@ -25,10 +26,15 @@ static int printable(char* msg)
 static void test(char* msg, uint8_t hash[32])
 {
 	uint8_t temp[32];
+	uint8_t soft[32];
 
 	sha256(temp, msg, strlen(msg));
 
-	if(!memcmp(hash, temp, 20))
+	sha_hwmask(0);
+	sha256(soft, msg, strlen(msg));
+	sha_hwmask(~0);
+
+	if(!memcmp(hash, temp, 20) && !memcmp(hash, soft, 20))
 		return;
 
 	if(!printable(msg))
@@ -38,6 +44,7 @@ static void test(char* msg, uint8_t hash[32])
 
 	dump("exp", hash);
 	dump("got", temp);
+	dump("soft", soft);
 
 	_exit(0xFF);
 }
@@ -123,6 +123,29 @@ int test_padding(void)
 	return ret;
 }
 
+int test_hexline(void)
+{
+	char buf[256];
+	char* p = buf;
+	char* e = buf + sizeof(buf) - 5;
+	int ret = 0;
+
+	char data[] = "ABC\x00\x01\x7F\x80\xFF 0123456~\t";
+
+	TEST(fmthexline, "00000010   41 42 43 00 01 7F 80 FF  20 30 31 32 33 34 35 36"
+	                 "   ABC..... 0123456\n", 0x10, data, 16);
+	TEST(fmthexline, "00000000   7E 09                                           "
+	                 "   ~.\n", 0, data + 16, 2);
+	TEST(fmthexline, "0123456780   41                                              "
+	                 "   A\n", 0x123456780ULL, data, 1);
+
+	e = buf + 12;
+
+	TEST(fmthexline, "FFFFFFF0   4", 0xFFFFFFF0, data, 16);
+
+	return ret;
+}
+
 int main(void)
 {
 	int ret = 0;
@@ -130,6 +153,7 @@ int main(void)
 	ret |= test_basic_types();
 	ret |= test_buf_cliping();
 	ret |= test_padding();
+	ret |= test_hexline();
 
 	return ret;
 }
@@ -0,0 +1,23 @@
+#include <sys/mman.h>
+
+#include <string.h>
+#include <util.h>
+
+#include "guard.h"
+
+char* guarded(int fill)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	char* buf = sys_mmap(NULL, 2*PAGE, prot, flags, -1, 0);
+	int ret;
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+	if((ret = sys_mprotect(buf + PAGE, PAGE, PROT_NONE)) < 0)
+		fail("mprotect", NULL, ret);
+
+	memset(buf, fill, PAGE);
+
+	return buf;
+}
@@ -0,0 +1,5 @@
+/* Two pages, the second one inaccessible, the first one filled with
+   the given byte. Data placed right at the end of the first page
+   catches any reads past its end that would cross into the next page. */
+
+char* guarded(int fill);
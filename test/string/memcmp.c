@@ -1,6 +1,14 @@
+#include <sys/mman.h>
+
+
 #include <format.h>
 #include <string.h>
 #include <util.h>
+#include <main.h>
+
+#include "guard.h"
+
+ERRTAG("memcmp");
 
 #define EQ 0
 #define LT -1
@@ -46,7 +54,7 @@ static int test(char* file, int line, int op, void* a, void* b, int n)
 #define TEST(op, a, b, n) \
 	ret |= test(__FILE__, __LINE__, op, a, b, n)
 
-int main(void)
+int main(noargs)
 {
 	int ret = 0;
 
@@ -56,5 +64,35 @@ int main(void)
 
 	TEST(GT, "\xFF",  "\x00", 1);
 
+	char a[100], b[100], c[101];
+	int i, j, n;
+
+	for(i = 0; i < 100; i++)
+		a[i] = b[i] = c[i+1] = i + 1;
+
+	for(i = 0; i < 16; i++)
+		for(n = 0; n < 64; n++) {
+			TEST(EQ, a + i, b + i, n);
+			TEST(EQ, a + i, a + i, n);
+			TEST(EQ, a + i, c + i + 1, n);
+			for(j = 0; j < n; j++) {
+				b[i + j] = 0xFF;
+				TEST(LT, a + i, b + i, n);
+				TEST(GT, b + i, a + i, n);
+				b[i + j] = i + j + 1;
+			}
+		}
+
+	char* page = guarded('x');
+	char* end = page + PAGE;
+
+	for(n = 0; n < 64; n++) {
+		TEST(EQ, end - n, end - n, n);
+		TEST(EQ, end - n, page, n);
+	}
+
+	end[-1] = 'y';
+	TEST(GT, end - 20, page, 20);
+
 	return ret;
 }
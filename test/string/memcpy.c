@@ -0,0 +1,73 @@
+#include <format.h>
+#include <string.h>
+#include <util.h>
+
+/* Every combination of source and destination alignment and a range
+   of lengths, checked against a plain byte-by-byte copy. Bytes around
+   the destination must remain intact. */
+
+#define SIZE 200
+
+static char src[SIZE];
+static char dst[SIZE];
+static char ref[SIZE];
+
+static int report(char* file, int line, int so, int dof, int n)
+{
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": ");
+	p = fmtstr(p, e, "FAIL src+");
+	p = fmtint(p, e, so);
+	p = fmtstr(p, e, " dst+");
+	p = fmtint(p, e, dof);
+	p = fmtstr(p, e, " len ");
+	p = fmtint(p, e, n);
+
+	FMTENL(p, e);
+
+	writeall(STDERR, buf, p - buf);
+
+	return -1;
+}
+
+static int test(char* file, int line, int so, int dof, int n)
+{
+	int i;
+
+	for(i = 0; i < SIZE; i++) {
+		src[i] = i + 1;
+		dst[i] = ref[i] = -1;
+	}
+	for(i = 0; i < n; i++)
+		ref[dof + i] = src[so + i];
+
+	if(memcpy(dst + dof, src + so, n) != dst + dof)
+		return report(file, line, so, dof, n);
+	if(memcmp(dst, ref, SIZE))
+		return report(file, line, so, dof, n);
+
+	return 0;
+}
+
+#define TEST(so, dof, n) \
+	ret |= test(__FILE__, __LINE__, so, dof, n)
+
+int main(void)
+{
+	int ret = 0;
+
+	for(int so = 0; so < 16; so++)
+		for(int dof = 0; dof < 16; dof++)
+			for(int n = 0; n < 100; n++)
+				TEST(so, dof, n);
+
+	TEST(0, 0, SIZE);
+	TEST(1, 0, SIZE - 1);
+	TEST(0, 1, SIZE - 1);
+
+	return ret;
+}
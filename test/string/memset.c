@@ -0,0 +1,59 @@
+#include <format.h>
+#include <string.h>
+#include <util.h>
+
+/* Unaligned starts and a range of lengths, checked against
+   a plain byte-by-byte fill. */
+
+#define SIZE 200
+
+static char dst[SIZE];
+static char ref[SIZE];
+
+static int test(char* file, int line, int off, int c, int n)
+{
+	int i;
+
+	for(i = 0; i < SIZE; i++)
+		dst[i] = ref[i] = i + 1;
+	for(i = 0; i < n; i++)
+		ref[off + i] = c;
+
+	if(memset(dst + off, c, n) == dst + off && !memcmp(dst, ref, SIZE))
+		return 0;
+
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": ");
+	p = fmtstr(p, e, "FAIL off ");
+	p = fmtint(p, e, off);
+	p = fmtstr(p, e, " len ");
+	p = fmtint(p, e, n);
+
+	FMTENL(p, e);
+
+	writeall(STDERR, buf, p - buf);
+
+	return -1;
+}
+
+#define TEST(off, c, n) \
+	ret |= test(__FILE__, __LINE__, off, c, n)
+
+int main(void)
+{
+	int ret = 0;
+
+	for(int off = 0; off < 16; off++)
+		for(int n = 0; n < 100; n++)
+			TEST(off, 0xA5, n);
+
+	TEST(0, 0, SIZE);
+	TEST(3, 0xFF, SIZE - 3);
+	TEST(5, 0x100 + 'x', 50);
+
+	return ret;
+}
@@ -0,0 +1,78 @@
+#include <sys/mman.h>
+
+#include <format.h>
+#include <string.h>
+#include <util.h>
+#include <main.h>
+
+#include "guard.h"
+
+ERRTAG("nonzero");
+
+static int test(char* file, int line, int exp, void* a, int n)
+{
+	int res = nonzero(a, n);
+
+	if(!!res == exp)
+		return 0;
+
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": FAIL ");
+	p = fmtstr(p, e, exp ? "missed non-zero byte" : "false non-zero");
+
+	FMTENL(p, e);
+
+	writeall(STDERR, buf, p - buf);
+
+	return -1;
+}
+
+#define TEST(exp, a, n) \
+	ret |= test(__FILE__, __LINE__, exp, a, n)
+
+int main(noargs)
+{
+	int ret = 0;
+	char buf[200];
+	int i, j, n;
+
+	memzero(buf, sizeof(buf));
+
+	for(i = 0; i < 16; i++)
+		for(n = 0; n < 100; n++) {
+			TEST(0, buf + i, n);
+
+			for(j = 0; j < n; j++) {
+				buf[i + j] = 0x80;
+				TEST(1, buf + i, n);
+				buf[i + j] = 0;
+			}
+
+			buf[i + n] = 1;
+			TEST(0, buf + i, n);
+			buf[i + n] = 0;
+
+			if(!i) continue;
+
+			buf[i - 1] = 1;
+			TEST(0, buf + i, n);
+			buf[i - 1] = 0;
+		}
+
+	char* page = guarded(0);
+	char* end = page + PAGE;
+
+	for(n = 0; n < 64; n++)
+		TEST(0, end - n, n);
+
+	end[-1] = 1;
+	TEST(1, end - 37, 37);
+	TEST(1, page, PAGE);
+	TEST(0, page, PAGE - 1);
+
+	return ret;
+}
@@ -0,0 +1,79 @@
+#include <sys/mman.h>
+
+
+#include <format.h>
+#include <string.h>
+#include <util.h>
+#include <main.h>
+
+#include "guard.h"
+
+ERRTAG("strchr");
+
+static int test(char* file, int line, char* str, int c, char* exp)
+{
+	char* res = strchr(str, c);
+
+	if(res == exp)
+		return 0;
+
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": ");
+	p = fmtstr(p, e, "FAIL exp ");
+	p = exp ? fmtlong(p, e, exp - str) : fmtstr(p, e, "NULL");
+	p = fmtstr(p, e, " got ");
+	p = res ? fmtlong(p, e, res - str) : fmtstr(p, e, "NULL");
+
+	FMTENL(p, e);
+
+	writeall(STDERR, buf, p - buf);
+
+	return -1;
+}
+
+#define TEST(str, c, exp) \
+	ret |= test(__FILE__, __LINE__, str, c, exp)
+
+int main(noargs)
+{
+	int ret = 0;
+	char* s = "abcabc";
+	char* h = "\xEE\xEF";
+	char str[100];
+	int i, n;
+
+	TEST(s, 'a', s);
+	TEST(s, 'c', s + 2);
+	TEST(s, 'z', NULL);
+	TEST("", 'a', NULL);
+	TEST(h, 0xEF, h + 1);
+	TEST(h, (char)0xEF, h + 1);
+
+	memset(str, 'a', sizeof(str));
+
+	for(i = 0; i < 16; i++)
+		for(n = 0; n < 64; n++) {
+			str[i + n] = 'b';
+			str[i + n + 1] = '\0';
+			TEST(str + i, 'b', str + i + n);
+			TEST(str + i, 'c', NULL);
+			str[i + n] = 'a';
+			str[i + n + 1] = 'a';
+		}
+
+	char* page = guarded('x');
+	char* end = page + PAGE;
+
+	end[-1] = '\0';
+
+	for(n = 1; n < 64; n++) {
+		TEST(end - 1 - n, 'z', NULL);
+		TEST(end - 1 - n, 'x', end - 1 - n);
+	}
+
+	return ret;
+}
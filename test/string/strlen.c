@@ -1,6 +1,14 @@
+#include <sys/mman.h>
+
+
 #include <format.h>
 #include <string.h>
 #include <util.h>
+#include <main.h>
+
+#include "guard.h"
+
+ERRTAG("strlen");
 
 static int test(char* file, int line, char* str, int exp)
 {
@@ -30,13 +38,32 @@ static int test(char* file, int line, char* str, int exp)
 #define TEST(str, exp) \
 	ret |= test(__FILE__, __LINE__, str, exp)
 
-int main(void)
+int main(noargs)
 {
 	int ret = 0;
+	char str[100];
+	int i, n;
 
 	TEST("", 0);
 	TEST("a", 1);
 	TEST("abc", 3);
 
+	memset(str, 'a', sizeof(str));
+
+	for(i = 0; i < 16; i++)
+		for(n = 0; n < 64; n++) {
+			str[i + n] = '\0';
+			TEST(str + i, n);
+			str[i + n] = 'a';
+		}
+
+	char* page = guarded('x');
+	char* end = page + PAGE;
+
+	for(n = 0; n < 64; n++) {
+		end[-1] = '\0';
+		TEST(end - 1 - n, n);
+	}
+
 	return ret;
 }
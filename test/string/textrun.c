@@ -0,0 +1,146 @@
+#include <format.h>
+#include <string.h>
+#include <util.h>
+#include <main.h>
+
+ERRTAG("textrun");
+
+/* Both functions get checked against plain bytewise scans over buffers
+   with runs of all lengths at all alignments, and over pseudo-random
+   data with every byte value in it. */
+
+static int printable(uint8_t c)
+{
+	return (c >= 0x20 && c < 0x7F) || c == '\t';
+}
+
+static char* ref_end(char* p, char* e)
+{
+	for(; p < e; p++)
+		if(!printable(*p))
+			break;
+
+	return p;
+}
+
+static char* ref_find(char* p, char* e, long min)
+{
+	char* q;
+
+	for(; p < e; p = q + 1) {
+		if(!printable(*p)) {
+			q = p;
+			continue;
+		}
+
+		q = ref_end(p, e);
+
+		if(q - p >= min || q >= e)
+			return p;
+	}
+
+	return e;
+}
+
+static int report(char* file, int line, char* what, long got, long exp)
+{
+	FMTBUF(p, e, buf, 200);
+
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": FAIL ");
+	p = fmtstr(p, e, what);
+	p = fmtstr(p, e, " at ");
+	p = fmtlong(p, e, got);
+	p = fmtstr(p, e, " expected ");
+	p = fmtlong(p, e, exp);
+
+	FMTENL(p, e);
+
+	writeall(STDERR, buf, p - buf);
+
+	return -1;
+}
+
+/* Walks through all the runs in [p, e) the way strings does. */
+
+static int test(char* file, int line, char* p, char* e, long min)
+{
+	char* s = p;
+	char *exp, *got;
+
+	while(s < e) {
+		exp = ref_find(s, e, min);
+		got = textfind(s, e, min);
+
+		if(got != exp)
+			return report(file, line, "textfind", got - p, exp - p);
+		if(got >= e)
+			break;
+
+		exp = ref_end(got, e);
+		got = textend(got, e);
+
+		if(got != exp)
+			return report(file, line, "textend", got - p, exp - p);
+
+		s = got + 1;
+	}
+
+	return 0;
+}
+
+#define TEST(p, e, min) \
+	if((ret |= test(__FILE__, __LINE__, p, e, min))) return ret
+
+static int test_runs(void)
+{
+	char buf[200];
+	int i, n, min, ret = 0;
+
+	for(i = 0; i < 16; i++)
+		for(n = 0; n < 40; n++) {
+			memzero(buf, sizeof(buf));
+			memset(buf + i + 3, 'x', n);
+
+			if(n > 2)
+				buf[i + 4] = '\t';
+
+			for(min = 1; min < 20; min++) {
+				TEST(buf + i, buf + sizeof(buf), min);
+				TEST(buf + i, buf + i + 3 + n, min);
+				TEST(buf + i + 4, buf + i + 3 + n, min);
+			}
+		}
+
+	return ret;
+}
+
+static int test_random(void)
+{
+	char buf[4096];
+	uint32_t x = 12345;
+	int i, min, ret = 0;
+
+	for(i = 0; i < (int)sizeof(buf); i++) {
+		x = x*1103515245 + 12345;
+		buf[i] = x >> 16;
+	}
+
+	for(min = 1; min < 8; min++)
+		for(i = 0; i < 64; i++)
+			TEST(buf + i, buf + sizeof(buf) - i, min);
+
+	return ret;
+}
+
+int main(noargs)
+{
+	int ret = 0;
+
+	ret |= test_runs();
+	ret |= test_random();
+
+	return ret;
+}
@@ -0,0 +1,105 @@
+#include <sys/mman.h>
+
+#include <format.h>
+#include <string.h>
+#include <heap.h>
+#include <util.h>
+#include <main.h>
+
+ERRTAG("hpool");
+
+static void failure(char* file, int line, char* msg)
+{
+	FMTBUF(p, e, buf, 200);
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": FAIL ");
+	p = fmtstr(p, e, msg);
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+
+	_exit(0xFF);
+}
+
+#define CHECK(cond) \
+	if(!(cond)) failure(__FILE__, __LINE__, #cond)
+
+static struct hpool pool, *hp = &pool;
+
+static void test_reuse(void)
+{
+	void* a = hpalloc(hp, 10);
+	void* b = hpalloc(hp, 20);
+	void* c = hpalloc(hp, 100);
+
+	CHECK(a && b && c);
+	CHECK(a != b && b != c);
+	CHECK(!((long)a & 7) && !((long)b & 7) && !((long)c & 7));
+
+	memset(a, 'a', 10);
+	memset(b, 'b', 20);
+	memset(c, 'c', 100);
+
+	hpfree(hp, a);
+
+	void* d = hpalloc(hp, 16);
+
+	CHECK(d == a);            /* same class, reused */
+	CHECK(hpalloc(hp, 100) != c);
+
+	hpfree(hp, b);
+	hpfree(hp, d);
+}
+
+static void test_trim(void)
+{
+	void* base = hp->hp.ptr;
+	void* ptrs[100];
+	int i;
+
+	for(i = 0; i < 100; i++) {
+		CHECK((ptrs[i] = hpalloc(hp, 1000)));
+		memset(ptrs[i], i, 1000);
+	}
+
+	CHECK(hp->hp.end - base >= 100*1000);
+
+	/* freeing from the head leaves the tail in place */
+	for(i = 0; i < 99; i++)
+		hpfree(hp, ptrs[i]);
+
+	CHECK(hp->hp.ptr > ptrs[99]);
+
+	for(i = 0; i < 99; i++)
+		CHECK(hpalloc(hp, 1000) != ptrs[99]);
+	for(i = 0; i < 99; i++)
+		hpfree(hp, ptrs[i]);
+
+	/* now the whole tail is free and gets dropped */
+	hpfree(hp, ptrs[99]);
+
+	CHECK(hp->hp.ptr == base);
+	CHECK(hp->hp.end - hp->hp.ptr < 5*PAGE);
+	CHECK(sys_brk(NULL) == hp->hp.end);
+}
+
+static void test_limits(void)
+{
+	CHECK(hpalloc(hp, 1L << 30) == NULL);
+	CHECK(hpalloc(hp, 0) != NULL);
+
+	hpfree(hp, NULL);
+}
+
+int main(noargs)
+{
+	hpinit(hp);
+
+	test_reuse();
+	test_trim();
+	test_limits();
+
+	return 0;
+}
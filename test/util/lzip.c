@@ -0,0 +1,123 @@
+#include <sys/file.h>
+#include <sys/fprop.h>
+#include <sys/mman.h>
+
+#include <format.h>
+#include <string.h>
+#include <lzma.h>
+#include <lzip.h>
+#include <util.h>
+#include <main.h>
+
+ERRTAG("lzip");
+
+/* Multi-member round trip: write several lzip members back to back
+   into a memfd, then unpack the whole thing with several threads. */
+
+#define MEMBERS 7
+#define MSIZE (100*1000)
+#define LEVEL 1
+
+static void failure(char* msg, int ret)
+{
+	FMTBUF(p, e, buf, 200);
+	p = fmtstr(p, e, "FAIL ");
+	p = fmtstr(p, e, msg);
+	p = fmtstr(p, e, " ret ");
+	p = fmtint(p, e, ret);
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+
+	_exit(0xFF);
+}
+
+static void* map(long size)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void* buf = sys_mmap(NULL, size, prot, flags, -1, 0);
+	int ret;
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	return buf;
+}
+
+static void fill_input(byte* buf, long size)
+{
+	uint seed = 1;
+
+	/* short runs of repeated bytes, compressible but not trivially so */
+	for(long i = 0; i < size; i++) {
+		if(!(i % 8))
+			seed = seed*1103515245 + 12345;
+
+		buf[i] = 'a' + (seed >> 16) % 16;
+	}
+}
+
+static void write_member(int fd, byte* data, long size)
+{
+	struct lzip lp;
+	long wsize = LZIP_SIZE(LEVEL);
+	void* ws = map(wsize);
+	int ret;
+
+	if((ret = lzip_start(&lp, fd, ws, wsize, LEVEL)) < 0)
+		failure("lzip_start", ret);
+	if((ret = lzip_write(&lp, data, size)) < 0)
+		failure("lzip_write", ret);
+	if((ret = lzip_finish(&lp)) < 0)
+		failure("lzip_finish", ret);
+
+	sys_munmap(ws, wsize);
+}
+
+int main(noargs)
+{
+	long size = MEMBERS*MSIZE;
+	byte* input = map(size);
+	byte* output = map(size);
+	uint64_t osize;
+	struct stat st;
+	int i, fd, ret;
+
+	fill_input(input, size);
+
+	if((fd = sys_memfd_create("lzip", 0)) < 0)
+		fail("memfd_create", NULL, fd);
+
+	for(i = 0; i < MEMBERS; i++)
+		write_member(fd, input + i*MSIZE, MSIZE);
+
+	if((ret = sys_fstat(fd, &st)) < 0)
+		fail("stat", NULL, ret);
+
+	void* raw = sys_mmap(NULL, st.size, PROT_READ, MAP_SHARED, fd, 0);
+
+	if((ret = mmap_error(raw)))
+		fail("mmap", NULL, ret);
+
+	if((ret = lzip_scan(raw, st.size, &osize)))
+		failure("lzip_scan", ret);
+	if(osize != (uint64_t)size)
+		failure("total size", osize);
+	if((ret = lzip_inflate(raw, st.size, output, size, 4)))
+		failure("lzip_inflate", ret);
+	if(memcmp(input, output, size))
+		failure("data mismatch", 0);
+
+	/* a flipped bit in one of the members must not go unnoticed */
+
+	byte* copy = map(st.size);
+
+	memcpy(copy, raw, st.size);
+	copy[st.size/2] ^= 0x10;
+
+	if(!lzip_inflate(copy, st.size, output, size, 4))
+		failure("corruption not detected", 0);
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+#include <sys/mman.h>
+
+#include <format.h>
+#include <string.h>
+#include <lzma.h>
+#include <util.h>
+#include <main.h>
+
+ERRTAG("lzma");
+
+/* Round-trip check for the compressor: deflate some data in chunks,
+   inflate it back in one go and compare.
+
+   The encoder window is twice the dictionary size, 2M at level 1, and
+   slides once it fills up. BIGSIZE is past that, so the last case gets
+   to slide the window and keep matching across the shift. */
+
+#define SIZE (1<<20)
+#define BIGSIZE (3<<20)
+
+static char* words[] = {
+	"alpha ", "beta ", "gamma ", "delta ", "epsilon\n",
+	"zeta ", "eta ", "theta ", "iota ", "kappa\n"
+};
+
+static void failure(char* msg, int level, int ret)
+{
+	FMTBUF(p, e, buf, 200);
+	p = fmtstr(p, e, "FAIL ");
+	p = fmtstr(p, e, msg);
+	p = fmtstr(p, e, " level ");
+	p = fmtint(p, e, level);
+	p = fmtstr(p, e, " ret ");
+	p = fmtint(p, e, ret);
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+
+	_exit(0xFF);
+}
+
+static void* map(long size)
+{
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void* buf = sys_mmap(NULL, size, prot, flags, -1, 0);
+	int ret;
+
+	if((ret = mmap_error(buf)))
+		fail("mmap", NULL, ret);
+
+	return buf;
+}
+
+static void fill_input(byte* buf, long size)
+{
+	uint seed = 12345;
+	byte* p = buf;
+	byte* e = buf + size;
+
+	/* mostly text-like, with a stretch of noise in the middle */
+	while(p < e) {
+		seed = seed*1103515245 + 12345;
+
+		if(p - buf > size/2 && p - buf < size/2 + 4096) {
+			*p++ = seed >> 16;
+			continue;
+		}
+
+		char* w = words[(seed >> 16) % ARRAY_SIZE(words)];
+		long wl = strlen(w);
+
+		if(wl > e - p) wl = e - p;
+
+		memcpy(p, w, wl);
+		p += wl;
+	}
+}
+
+static long compress(byte* src, long size, byte* dst, long dlen, int level)
+{
+	long wsize = LZMA_DEFLATE_SIZE(level);
+	void* ws = map(wsize);
+	struct lzma* lz;
+	long chunk = 10000;
+	long off = 0;
+	int ret;
+
+	if(!(lz = lzma_deflate_create(ws, wsize, level)))
+		failure("create", level, 0);
+
+	lz->dstbuf = dst;
+	lz->dstptr = dst;
+	lz->dsthwm = dst + dlen - 4096;
+	lz->dstend = dst + dlen;
+
+	while(off < size) {
+		long left = size - off;
+		long len = left < chunk ? left : chunk;
+
+		lz->srcbuf = src + off;
+		lz->srcptr = src + off;
+		lz->srchwm = src + off + len;
+		lz->srcend = src + off + len;
+
+		if((ret = lzma_deflate(lz)) != LZMA_NEED_INPUT)
+			failure("deflate", level, ret);
+		if(lz->srcptr != lz->srcend)
+			failure("input not consumed", level, 0);
+
+		off += len;
+	}
+
+	if((ret = lzma_finish(lz)) != LZMA_STREAM_END)
+		failure("finish", level, ret);
+
+	long len = lz->dstptr - (void*)dst;
+
+	sys_munmap(ws, wsize);
+
+	return len;
+}
+
+static void decompress(byte* src, long len, byte* dst, long size, int level)
+{
+	byte buf[LZMA_SIZE];
+	struct lzma* lz;
+	int ret;
+
+	if(!(lz = lzma_create(buf, sizeof(buf))))
+		failure("inflate create", level, 0);
+
+	/* the first byte of the range coder output is always 0 */
+	lz->srcbuf = src;
+	lz->srcptr = src + 1;
+	lz->srchwm = src + len;
+	lz->srcend = src + len;
+
+	lz->dstbuf = dst;
+	lz->dstptr = dst;
+	lz->dsthwm = dst + size;
+	lz->dstend = dst + size;
+
+	if((ret = lzma_inflate(lz)) != LZMA_STREAM_END)
+		failure("inflate", level, ret);
+	if(lz->dstptr != lz->dstend)
+		failure("output size", level, 0);
+}
+
+/* lzma_inflate() only takes the fast path with at least FASTIN (64)
+   bytes of input past srcptr. Here the input window alternates between
+   63 bytes, which leaves the generic path only and stops after every
+   symbol, and 4K, which lets decode_fast() run for a while. Both paths
+   must decode the same stream the same way, and pick up the state the
+   other one left. */
+
+static void decompress_mixed(byte* src, long len, byte* dst, long size, int level)
+{
+	byte buf[LZMA_SIZE];
+	byte* end = src + len;
+	struct lzma* lz;
+	int ret, i = 0;
+
+	if(!(lz = lzma_create(buf, sizeof(buf))))
+		failure("inflate create", level, 0);
+
+	lz->srcbuf = src;
+	lz->srcptr = src + 1;
+
+	lz->dstbuf = dst;
+	lz->dstptr = dst;
+	lz->dsthwm = dst + size;
+	lz->dstend = dst + size;
+
+	do {
+		byte* ptr = lz->srcptr;
+		long win = (i++ & 1) ? 4096 : 63;
+		long hwm = (win > 63) ? win/2 : 0;
+
+		lz->srchwm = end - ptr > hwm ? ptr + hwm : end;
+		lz->srcend = end - ptr > win ? ptr + win : end;
+	} while((ret = lzma_inflate(lz)) == LZMA_NEED_INPUT);
+
+	if(ret != LZMA_STREAM_END)
+		failure("mixed inflate", level, ret);
+	if(lz->dstptr != lz->dstend)
+		failure("mixed output size", level, 0);
+}
+
+static void roundtrip(byte* input, long size, int level)
+{
+	byte* packed = map(2*size);
+	byte* output = map(size);
+	long len;
+
+	len = compress(input, size, packed, 2*size, level);
+
+	if(len <= 0 || len >= size/2)
+		failure("compression ratio", level, len);
+
+	decompress(packed, len, output, size, level);
+
+	if(memcmp(input, output, size))
+		failure("data mismatch", level, 0);
+
+	memzero(output, size);
+	decompress_mixed(packed, len, output, size, level);
+
+	if(memcmp(input, output, size))
+		failure("mixed data mismatch", level, 0);
+
+	sys_munmap(packed, 2*size);
+	sys_munmap(output, size);
+}
+
+int main(noargs)
+{
+	byte* input = map(BIGSIZE);
+
+	fill_input(input, BIGSIZE);
+
+	roundtrip(input, SIZE, 1);
+	roundtrip(input, SIZE, 5);
+	roundtrip(input, SIZE, 9);
+	roundtrip(input, BIGSIZE, 1);
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+#include <format.h>
+#include <string.h>
+#include <heap.h>
+#include <mpat.h>
+#include <util.h>
+#include <main.h>
+
+ERRTAG("mpat");
+
+static void failure(char* file, int line, char* msg)
+{
+	FMTBUF(p, e, buf, 200);
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": FAIL ");
+	p = fmtstr(p, e, msg);
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+
+	_exit(0xFF);
+}
+
+#define CHECK(cond) \
+	if(!(cond)) failure(__FILE__, __LINE__, #cond)
+
+static struct heap heap, *hp = &heap;
+
+static int scan(struct mpat* mp, char* str)
+{
+	return mp_scan(mp, str, strlen(str), NULL, NULL);
+}
+
+/* Reference result for the first match: earliest end, then the longest
+   pattern ending there, then the lowest index. */
+
+static int naive(char** patts, int n, char* str)
+{
+	int len = strlen(str);
+	int end, pl, i;
+
+	for(end = 0; end <= len; end++)
+		for(pl = end; pl >= 0; pl--)
+			for(i = 0; i < n; i++) {
+				if((int)strlen(patts[i]) != pl)
+					continue;
+				if(!memcmp(str + end - pl, patts[i], pl))
+					return i;
+			}
+
+	return -1;
+}
+
+static void test_basic(void)
+{
+	char* patts[] = { "he", "she", "his", "hers" };
+	struct mpat mp;
+
+	mp_compile(&mp, hp, patts, 4);
+
+	CHECK(scan(&mp, "ushers") == 1);
+	CHECK(scan(&mp, "ahis") == 2);
+	CHECK(scan(&mp, "hxrs") == -1);
+	CHECK(scan(&mp, "") == -1);
+	CHECK(scan(&mp, "xhe") == 0);
+}
+
+struct all {
+	int count;
+	int idx[16];
+	int end[16];
+};
+
+static int collect(void* data, int idx, int end)
+{
+	struct all* al = data;
+
+	al->idx[al->count] = idx;
+	al->end[al->count] = end;
+	al->count++;
+
+	return -1;
+}
+
+static void test_all(void)
+{
+	char* patts[] = { "hers", "he", "she", "e", "he" };
+	struct mpat mp;
+	struct all al;
+
+	mp_compile(&mp, hp, patts, 5);
+	memzero(&al, sizeof(al));
+
+	CHECK(mp_scan(&mp, "shers", 5, collect, &al) == -1);
+	CHECK(al.count == 5);
+	CHECK(al.idx[0] == 2 && al.end[0] == 3); /* she */
+	CHECK(al.idx[1] == 1 && al.end[1] == 3); /* he, via dict link */
+	CHECK(al.idx[2] == 4 && al.end[2] == 3); /* he again */
+	CHECK(al.idx[3] == 3 && al.end[3] == 3); /* e */
+	CHECK(al.idx[4] == 0 && al.end[4] == 5); /* hers */
+}
+
+static void test_special(void)
+{
+	char* patts[] = { NULL, "a\377b", "" };
+	char buf[] = { 'x', 0, 'a', (char)0377, 'b' };
+	struct mpat mp;
+
+	mp_compile(&mp, hp, patts, 2);
+
+	CHECK(mp_scan(&mp, buf, sizeof(buf), NULL, NULL) == 1);
+	CHECK(mp_scan(&mp, buf, sizeof(buf) - 1, NULL, NULL) == -1);
+
+	mp_compile(&mp, hp, patts, 3);
+
+	CHECK(scan(&mp, "") == 2);
+}
+
+static void test_random(void)
+{
+	static char pool[16][8];
+	char* patts[16];
+	char str[64];
+	uint seed = 1;
+	int i, j, k;
+
+	for(k = 0; k < 200; k++) {
+		int n = 1 + k % 16;
+		struct mpat mp;
+
+		for(i = 0; i < n; i++) {
+			int len = 1 + (seed = seed*1103515245 + 12345) % 5;
+
+			for(j = 0; j < len; j++)
+				pool[i][j] = 'a' + (seed = seed*1103515245 + 12345) % 3;
+
+			pool[i][len] = '\0';
+			patts[i] = pool[i];
+		}
+
+		for(j = 0; j < (int)sizeof(str) - 1; j++)
+			str[j] = 'a' + (seed = seed*1103515245 + 12345) % 4;
+
+		str[j] = '\0';
+
+		void* ptr = hp->ptr;
+
+		mp_compile(&mp, hp, patts, n);
+
+		CHECK(scan(&mp, str) == naive(patts, n, str));
+
+		hp->ptr = ptr;
+	}
+}
+
+int main(noargs)
+{
+	hinit(hp, 4096);
+
+	test_basic();
+	test_all();
+	test_special();
+	test_random();
+
+	return 0;
+}
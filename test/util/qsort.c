@@ -73,6 +73,73 @@ static void test(char* file, int line, int idx[], int n)
 	failure(file, line, A, n);
 }
 
+/* Larger inputs, checked for order and for the number of comparisons
+   which must stay within a small multiple of n log n regardless of
+   the initial ordering. */
+
+#define BIG 20000
+
+static int bigdata[BIG];
+static int* bigidx[BIG];
+static long ncmp;
+
+static int cmpcount(void* pa, void* pb)
+{
+	ncmp++;
+	return cmp(pa, pb);
+}
+
+static long nlogn(int n)
+{
+	long log = 0;
+
+	for(int k = n; k > 1; k >>= 1)
+		log++;
+
+	return n*log;
+}
+
+static void fill(char mode, int n)
+{
+	uint32_t x = 1;
+
+	for(int i = 0; i < n; i++) {
+		x = x*1103515245 + 12345;
+
+		if(mode == 'r')        /* random */
+			bigdata[i] = x >> 8;
+		else if(mode == 'd')   /* random, lots of duplicates */
+			bigdata[i] = (x >> 8) % 10;
+		else if(mode == 's')   /* sorted */
+			bigdata[i] = i;
+		else if(mode == 'v')   /* reverse sorted */
+			bigdata[i] = n - i;
+		else if(mode == 'e')   /* all equal */
+			bigdata[i] = 7;
+		else                    /* organ pipe */
+			bigdata[i] = i < n/2 ? i : n - i;
+
+		bigidx[i] = &bigdata[i];
+	}
+}
+
+static void test_big(char* file, int line, char mode, int n)
+{
+	fill(mode, n);
+
+	ncmp = 0;
+
+	qsortp(bigidx, n, cmpcount);
+
+	if(check_order(bigidx, n))
+		failure(file, line, bigidx, 10);
+	if(ncmp > 3*nlogn(n))
+		failure(file, line, bigidx, 0);
+}
+
+#define BIGTEST(mode, n) \
+	test_big(__FILE__, __LINE__, mode, n)
+
 #define TEST(type, ...) \
 {\
 	int X[] = { __VA_ARGS__ }; \
@@ -110,5 +177,13 @@ int main(void)
 	TEST(20, 19, 18, 17, 16, 15, 14, 13, 12, 11,
 	     10,  9,  8,  7,  6,  5,  4,  3,  2,  1);
 
+	BIGTEST('r', 100);
+	BIGTEST('r', BIG);
+	BIGTEST('d', BIG);
+	BIGTEST('s', BIG);
+	BIGTEST('v', BIG);
+	BIGTEST('e', BIG);
+	BIGTEST('o', BIG);
+
 	return 0;
 }
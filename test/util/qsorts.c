@@ -0,0 +1,100 @@
+#include <format.h>
+#include <string.h>
+#include <util.h>
+
+/* qsorts must produce exactly the same order as qsortp with strcmp
+   on the same field. Names share long prefixes to exercise deeper
+   radix levels, and some of them are duplicates. */
+
+struct ent {
+	short len;
+	char isdir;
+	char name[];
+};
+
+#define N 5000
+#define NAMELEN 24
+
+static char store[N][sizeof(struct ent) + NAMELEN];
+static struct ent* A[N];
+static struct ent* B[N];
+
+static int cmp_ent(void* pa, void* pb)
+{
+	struct ent* a = pa;
+	struct ent* b = pb;
+
+	return strcmp(a->name, b->name);
+}
+
+static void noreturn failure(char* file, int line, int i)
+{
+	FMTBUF(p, e, buf, 200);
+	p = fmtstr(p, e, file);
+	p = fmtstr(p, e, ":");
+	p = fmtint(p, e, line);
+	p = fmtstr(p, e, ": FAIL at ");
+	p = fmtint(p, e, i);
+	p = fmtstr(p, e, " ");
+	p = fmtstr(p, e, A[i]->name);
+	p = fmtstr(p, e, " vs ");
+	p = fmtstr(p, e, B[i]->name);
+	FMTENL(p, e);
+
+	writeall(STDOUT, buf, p - buf);
+
+	_exit(0xFF);
+}
+
+static void fill(int n, int alpha)
+{
+	uint32_t x = 12345;
+
+	for(int i = 0; i < n; i++) {
+		struct ent* en = (struct ent*)store[i];
+		int len;
+
+		x = x*1103515245 + 12345;
+		len = (x >> 16) % (NAMELEN - 1);
+
+		for(int k = 0; k < len; k++) {
+			x = x*1103515245 + 12345;
+			en->name[k] = k < 4 ? "lib-"[k] : 'a' + (x >> 16) % alpha;
+		}
+
+		if(i % 7 == 3)
+			en->name[len/2] = 0xC3; /* high-bit bytes */
+
+		en->name[len] = '\0';
+
+		A[i] = B[i] = en;
+	}
+}
+
+static void test(char* file, int line, int n, int alpha)
+{
+	fill(n, alpha);
+
+	qsorts(A, n, offsetof(struct ent, name));
+	qsortp(B, n, cmp_ent);
+
+	for(int i = 0; i < n; i++)
+		if(strcmp(A[i]->name, B[i]->name))
+			failure(file, line, i);
+}
+
+#define TEST(n, alpha) \
+	test(__FILE__, __LINE__, n, alpha)
+
+int main(void)
+{
+	TEST(0, 26);
+	TEST(1, 26);
+	TEST(10, 26);
+	TEST(100, 26);
+	TEST(N, 26);
+	TEST(N, 2);
+	TEST(N, 1);
+
+	return 0;
+}